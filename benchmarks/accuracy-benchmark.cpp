@@ -0,0 +1,610 @@
+/*
+Audio Sync Analyzer - Delay accuracy regression suite
+Copyright (C) 2025
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+*/
+
+// Plants known delays in speech and music clips, impairs the targets, and
+// runs every engine variant over the same trials.  Each row reports how many
+// results cleared the correlation threshold, the error distribution of those
+// results, how many of them were gross errors, and the time per measurement.
+//
+// Clips are synthetic by default: a formant-filtered pulse train in syllables
+// and pauses for speech, harmonic notes over a bass line and hi-hats for music.
+// --wav adds a recording at --rate, downmixed to mono.  Scenarios impair the
+// target on top of a fractional delay: white noise at 10 dB SNR, an EQ that
+// boosts the low mids and cuts the highs, 100 ppm of clock drift, and all three
+// at once.  The EQ's own group delay, a few tenths of a millisecond in the
+// bandpass, counts as error.
+//
+// --baseline compares every row with a golden file and exits with 1 when a row
+// regressed; --write-baseline records a new one.  The golden file holds trial
+// counts, so a row fails as soon as it passes one trial fewer or makes one more
+// gross error than recorded; it must be compared at the --trials it was
+// recorded with.
+// Times are reported but never compared.  Random numbers come straight from
+// mt19937, whose output the standard fixes, so the trials and the golden file
+// are the same with every standard library.  Built twice, once with
+// SYNC_NO_SIMD, so the scalar kernels are checked against the same file.
+//
+//   accuracy-benchmark [--trials 24] [--window 1000] [--lag 500] [--rate 48000]
+//                      [--wav file] [--baseline file] [--write-baseline file]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "lag-search.h"
+#include "offline-analysis.h"
+#include "sync-engine.h"
+
+// Half-width of the windowed-sinc interpolator used for delays and drift
+#define SINC_TAPS 16
+// Samples the target's EQ runs before the window starts, so its transient is gone
+#define EQ_WARMUP 4096u
+#define CLIP_SECONDS 12u
+// A result that cleared the threshold but is further off than this is a gross error
+#define GROSS_ERROR_MS 1.0
+// How far the p95 error may grow before a row counts as a regression; counts
+// of passed trials and gross errors have no tolerance
+#define TOLERANCE_P95_FACTOR 1.5
+#define TOLERANCE_P95_MS 0.01
+
+typedef std::chrono::steady_clock bench_clock;
+
+struct suite_options {
+	size_t trials = 24;
+	uint32_t window_ms = 1000;
+	uint32_t lag_ms = 500;
+	uint32_t rate = 48000;
+	std::vector<std::string> wav_paths;
+	std::string baseline_path;
+	std::string write_path;
+};
+
+struct clip {
+	std::string name;
+	std::vector<float> samples;
+};
+
+struct scenario {
+	const char *name;
+	// Target SNR in dB; 0 adds no noise
+	double snr_db;
+	bool eq;
+	double drift_ppm;
+};
+
+static const struct scenario g_scenarios[] = {
+	{"clean", 0.0, false, 0.0},   {"noise", 10.0, false, 0.0},  {"eq", 0.0, true, 0.0},
+	{"drift", 0.0, false, 100.0}, {"all", 10.0, true, 100.0},
+};
+
+struct variant {
+	const char *name;
+	bool coarse_search;
+	enum spectral_weighting weighting;
+};
+
+static const struct variant g_variants[] = {
+	{"baseline", false, WEIGHTING_NONE},
+	{"decimated", true, WEIGHTING_NONE},
+	{"phat", false, WEIGHTING_PHAT},
+};
+
+// One reference window and its impaired target, with the delay planted at the window's centre
+struct trial {
+	std::vector<float> ref;
+	std::vector<float> tgt;
+	double delay_samples;
+};
+
+// What one clip, scenario and variant scored; also a line of the golden file
+struct row_result {
+	size_t trials = 0;
+	// Trials over the threshold, and those of them more than GROSS_ERROR_MS off
+	size_t ok = 0;
+	size_t gross = 0;
+	double median_ms = 0.0;
+	double p95_ms = 0.0;
+	double max_ms = 0.0;
+	double us_per_measure = 0.0;
+};
+
+static double row_pct(size_t count, size_t trials)
+{
+	return trials ? 100.0 * (double)count / (double)trials : 0.0;
+}
+
+// Uniform in (0, 1) and standard normal, the same on every platform
+static double uniform(std::mt19937 *rng)
+{
+	return ((double)(*rng)() + 0.5) / 4294967296.0;
+}
+
+static double gaussian(std::mt19937 *rng)
+{
+	const double u = uniform(rng);
+	const double v = uniform(rng);
+	return sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * v);
+}
+
+static bool parse_options(int argc, char **argv, struct suite_options *opt)
+{
+	for (int i = 1; i + 1 < argc; i += 2) {
+		const char *key = argv[i];
+		const char *value = argv[i + 1];
+		if (!strcmp(key, "--trials"))
+			opt->trials = std::max<size_t>(1, strtoull(value, nullptr, 10));
+		else if (!strcmp(key, "--window"))
+			opt->window_ms = (uint32_t)std::max(1, atoi(value));
+		else if (!strcmp(key, "--lag"))
+			opt->lag_ms = (uint32_t)std::max(1, atoi(value));
+		else if (!strcmp(key, "--rate"))
+			opt->rate = (uint32_t)std::max(8000, atoi(value));
+		else if (!strcmp(key, "--wav"))
+			opt->wav_paths.push_back(value);
+		else if (!strcmp(key, "--baseline"))
+			opt->baseline_path = value;
+		else if (!strcmp(key, "--write-baseline"))
+			opt->write_path = value;
+		else
+			return false;
+	}
+	return (argc % 2) == 1;
+}
+
+static const char *kernel_name()
+{
+#if defined(LAG_SEARCH_SSE2)
+	return "sse2";
+#elif defined(LAG_SEARCH_NEON)
+	return "neon";
+#else
+	return "scalar";
+#endif
+}
+
+static void normalize_rms(std::vector<float> *samples, double rms)
+{
+	double sum = 0.0;
+	for (float v : *samples)
+		sum += (double)v * v;
+	const double current = sqrt(sum / (double)std::max<size_t>(samples->size(), 1));
+	if (current <= 0.0)
+		return;
+	const float gain = (float)(rms / current);
+	for (float &v : *samples)
+		v *= gain;
+}
+
+// Two-pole resonator with unit gain at its centre frequency
+struct resonator {
+	double a1 = 0.0, a2 = 0.0, gain = 0.0;
+	double y1 = 0.0, y2 = 0.0;
+};
+
+static void resonator_tune(struct resonator *r, double freq, double bandwidth, uint32_t rate)
+{
+	const double radius = exp(-M_PI * bandwidth / (double)rate);
+	r->a1 = 2.0 * radius * cos(2.0 * M_PI * freq / (double)rate);
+	r->a2 = -radius * radius;
+	r->gain = 1.0 - radius;
+}
+
+static double resonator_run(struct resonator *r, double x)
+{
+	const double y = r->gain * x + r->a1 * r->y1 + r->a2 * r->y2;
+	r->y2 = r->y1;
+	r->y1 = y;
+	return y;
+}
+
+// Syllables of 120-300 ms with a gliding pitch and their own vowel, some led
+// by a fricative, grouped into words with pauses between them
+static std::vector<float> speech_clip(size_t frames, uint32_t rate, std::mt19937 *rng)
+{
+	static const double vowels[][2] = {{730, 1090}, {270, 2290}, {530, 1840}, {570, 840}, {300, 870}, {660, 1720}};
+	std::vector<float> out(frames, 0.0f);
+	struct resonator formants[3];
+	double phase = 0.0;
+	double hiss_prev = 0.0;
+
+	size_t pos = 0;
+	while (pos < frames) {
+		if (uniform(rng) < 0.2)
+			pos += (size_t)((0.15 + 0.25 * uniform(rng)) * rate);
+		const size_t length = (size_t)((0.12 + 0.18 * uniform(rng)) * rate);
+		const size_t fricative = uniform(rng) < 0.3 ? (size_t)(0.06 * rate) : 0;
+		const double *vowel = vowels[(size_t)(uniform(rng) * 6.0)];
+		resonator_tune(&formants[0], vowel[0], 80.0, rate);
+		resonator_tune(&formants[1], vowel[1], 120.0, rate);
+		resonator_tune(&formants[2], 2500.0, 200.0, rate);
+		const double f0_start = 100.0 + 60.0 * uniform(rng);
+		const double f0_end = f0_start * (0.8 + 0.4 * uniform(rng));
+
+		for (size_t i = 0; i < fricative + length && pos < frames; ++i, ++pos) {
+			double v = 0.0;
+			if (i < fricative) {
+				const double hiss = gaussian(rng);
+				v = 0.3 * (hiss - hiss_prev) * sin(M_PI * (double)i / (double)fricative);
+				hiss_prev = hiss;
+			} else {
+				const double t = (double)(i - fricative) / (double)length;
+				phase += (f0_start + (f0_end - f0_start) * t) / (double)rate;
+				const double pulse = phase >= 1.0 ? 1.0 : 0.0;
+				phase -= std::floor(phase);
+				const double excitation = pulse + 0.02 * gaussian(rng);
+				v = resonator_run(&formants[0], excitation) +
+				    0.6 * resonator_run(&formants[1], excitation) +
+				    0.3 * resonator_run(&formants[2], excitation);
+				v *= sin(M_PI * t);
+			}
+			out[pos] = (float)v;
+		}
+	}
+	normalize_rms(&out, 0.1);
+	return out;
+}
+
+// A pentatonic melody of decaying five-harmonic notes, a bass note every two
+// melody notes and a hi-hat on every beat
+static std::vector<float> music_clip(size_t frames, uint32_t rate, std::mt19937 *rng)
+{
+	static const int scale[] = {0, 2, 4, 7, 9, 12, 14, 16, 19, 21, 24};
+	const size_t steps = sizeof(scale) / sizeof(scale[0]);
+	std::vector<float> out(frames, 0.0f);
+	const size_t beat = rate / 4;
+
+	size_t pos = 0;
+	size_t note = 0;
+	double bass_freq = 55.0;
+	while (pos < frames) {
+		const size_t length = (size_t)((0.2 + 0.2 * uniform(rng)) * rate);
+		const double freq = 220.0 * pow(2.0, scale[(size_t)(uniform(rng) * steps)] / 12.0);
+		if (note++ % 2 == 0)
+			bass_freq = 55.0 * pow(2.0, scale[(size_t)(uniform(rng) * 6.0)] / 12.0);
+		for (size_t i = 0; i < length && pos + i < frames; ++i) {
+			const double t = (double)i / (double)rate;
+			double v = 0.0;
+			for (int k = 1; k <= 5; ++k)
+				v += sin(2.0 * M_PI * freq * k * t) / k;
+			v *= exp(-t / 0.3);
+			v += 0.5 * sin(2.0 * M_PI * bass_freq * (double)(pos + i) / (double)rate);
+			out[pos + i] = (float)v;
+		}
+		pos += length;
+	}
+	for (size_t hit = 0; hit < frames; hit += beat) {
+		const size_t length = std::min<size_t>(rate / 50, frames - hit);
+		double prev = 0.0;
+		for (size_t i = 0; i < length; ++i) {
+			const double n = gaussian(rng);
+			out[hit + i] += (float)(0.4 * (n - prev) * exp(-(double)i / (0.004 * rate)));
+			prev = n;
+		}
+	}
+	normalize_rms(&out, 0.1);
+	return out;
+}
+
+static double sinc_tap(double x)
+{
+	if (std::fabs(x) < 1e-12)
+		return 1.0;
+	const double window = 0.5 + 0.5 * cos(M_PI * x / (SINC_TAPS + 1));
+	return window * sin(M_PI * x) / (M_PI * x);
+}
+
+// Band-limited value of `source` at fractional position p
+static double sample_at(const std::vector<float> &source, double p)
+{
+	const double base = std::ceil(p);
+	const double frac = base - p;
+	const ptrdiff_t b = (ptrdiff_t)base;
+	double v = 0.0;
+	for (int k = -SINC_TAPS; k <= SINC_TAPS; ++k)
+		v += source[(size_t)(b - k)] * sinc_tap((double)k - frac);
+	return v;
+}
+
+// RBJ cookbook biquad, run in double
+struct biquad {
+	double b0, b1, b2, a1, a2;
+	double x1 = 0.0, x2 = 0.0, y1 = 0.0, y2 = 0.0;
+};
+
+static struct biquad peaking_eq(double freq, double q, double gain_db, uint32_t rate)
+{
+	const double a = pow(10.0, gain_db / 40.0);
+	const double w = 2.0 * M_PI * freq / (double)rate;
+	const double alpha = sin(w) / (2.0 * q);
+	const double a0 = 1.0 + alpha / a;
+	struct biquad f;
+	f.b0 = (1.0 + alpha * a) / a0;
+	f.b1 = -2.0 * cos(w) / a0;
+	f.b2 = (1.0 - alpha * a) / a0;
+	f.a1 = -2.0 * cos(w) / a0;
+	f.a2 = (1.0 - alpha / a) / a0;
+	return f;
+}
+
+static struct biquad high_shelf(double freq, double gain_db, uint32_t rate)
+{
+	const double a = pow(10.0, gain_db / 40.0);
+	const double w = 2.0 * M_PI * freq / (double)rate;
+	const double alpha = sin(w) / 2.0 * sqrt(2.0);
+	const double c = cos(w);
+	const double root = 2.0 * sqrt(a) * alpha;
+	const double a0 = (a + 1.0) - (a - 1.0) * c + root;
+	struct biquad f;
+	f.b0 = a * ((a + 1.0) + (a - 1.0) * c + root) / a0;
+	f.b1 = -2.0 * a * ((a - 1.0) + (a + 1.0) * c) / a0;
+	f.b2 = a * ((a + 1.0) + (a - 1.0) * c - root) / a0;
+	f.a1 = 2.0 * ((a - 1.0) - (a + 1.0) * c) / a0;
+	f.a2 = ((a + 1.0) - (a - 1.0) * c - root) / a0;
+	return f;
+}
+
+static double biquad_run(struct biquad *f, double x)
+{
+	const double y = f->b0 * x + f->b1 * f->x1 + f->b2 * f->x2 - f->a1 * f->y1 - f->a2 * f->y2;
+	f->x2 = f->x1;
+	f->x1 = x;
+	f->y2 = f->y1;
+	f->y1 = y;
+	return y;
+}
+
+// The target is the source delayed by d samples at the window's centre,
+// tgt(t) = src(t - d), so a positive delay means the target lags.  Drift
+// stretches the target's timeline around that centre.
+static void make_trial(const std::vector<float> &source, const struct scenario *sc, size_t frames, uint32_t rate,
+		       double max_delay, std::mt19937 *rng, struct trial *t)
+{
+	const double span = frames + EQ_WARMUP;
+	const double stretch = sc->drift_ppm * 1e-6;
+	const size_t margin = (size_t)std::ceil(max_delay + std::fabs(stretch) * span) + EQ_WARMUP + SINC_TAPS + 2;
+	const size_t start = margin + (size_t)(uniform(rng) * (double)(source.size() - frames - 2 * margin));
+	t->delay_samples = max_delay * (2.0 * uniform(rng) - 1.0);
+	t->ref.assign(source.begin() + (ptrdiff_t)start, source.begin() + (ptrdiff_t)(start + frames));
+
+	struct biquad low_mid = peaking_eq(300.0, 1.0, 10.0, rate);
+	struct biquad top = high_shelf(1200.0, -10.0, rate);
+	std::vector<double> tgt((size_t)span);
+	const double centre = (double)EQ_WARMUP + 0.5 * (double)frames;
+	for (size_t n = 0; n < tgt.size(); ++n) {
+		const double offset = (double)n - centre;
+		const double p = (double)start + 0.5 * frames + offset * (1.0 + stretch) - t->delay_samples;
+		double v = sample_at(source, p);
+		if (sc->eq)
+			v = biquad_run(&top, biquad_run(&low_mid, v));
+		tgt[n] = v;
+	}
+
+	double noise = 0.0;
+	if (sc->snr_db > 0.0) {
+		double sum = 0.0;
+		for (size_t n = EQ_WARMUP; n < tgt.size(); ++n)
+			sum += tgt[n] * tgt[n];
+		noise = sqrt(sum / (double)frames) * pow(10.0, -sc->snr_db / 20.0);
+	}
+	t->tgt.resize(frames);
+	for (size_t n = 0; n < frames; ++n)
+		t->tgt[n] = (float)(tgt[EQ_WARMUP + n] + (noise > 0.0 ? noise * gaussian(rng) : 0.0));
+}
+
+static double percentile(std::vector<double> values, double p)
+{
+	if (values.empty())
+		return 0.0;
+	// Nearest rank
+	std::sort(values.begin(), values.end());
+	const size_t rank = (size_t)std::ceil(p * (double)values.size());
+	return values[std::min(std::max<size_t>(rank, 1), values.size()) - 1];
+}
+
+static struct row_result run_variant(const struct variant *v, const struct suite_options *opt,
+				     const std::vector<struct trial> &trials)
+{
+	struct sync_engine engine;
+	// No pool: one target per measurement, timed on one thread
+	sync_engine_init(&engine, opt->rate, nullptr, nullptr);
+
+	struct sync_engine_settings settings;
+	settings.window_ms = opt->window_ms;
+	settings.max_lag_ms = opt->lag_ms;
+	settings.corr_threshold = 0.3f;
+	settings.coarse_search = v->coarse_search;
+	settings.taper = TAPER_HANN;
+	settings.weighting = v->weighting;
+	settings.debug = false;
+
+	const size_t frames = ms_to_samples(opt->window_ms, opt->rate);
+	struct correlation_workspace ws;
+	struct target_workspace tws;
+	struct measurement_sample out;
+
+	std::vector<double> errors;
+	size_t gross = 0;
+	double total_ns = 0.0;
+	// The first trial sizes the workspaces and is measured again untimed
+	for (size_t i = 0; i <= trials.size(); ++i) {
+		const struct trial &t = trials[i == 0 ? 0 : i - 1];
+		const float *target = t.tgt.data();
+		const bench_clock::time_point start = bench_clock::now();
+		sync_engine_measure(&engine, &settings, &ws, &tws, t.ref.data(), &target, 1, frames, &out);
+		const bench_clock::duration elapsed = bench_clock::now() - start;
+		if (i == 0)
+			continue;
+
+		total_ns += (double)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+		if (!out.success)
+			continue;
+		const double error_ms = std::fabs(out.delay_ms - t.delay_samples * 1000.0 / (double)opt->rate);
+		errors.push_back(error_ms);
+		if (error_ms > GROSS_ERROR_MS)
+			++gross;
+	}
+
+	struct row_result r;
+	r.trials = trials.size();
+	r.ok = errors.size();
+	r.gross = gross;
+	r.median_ms = percentile(errors, 0.5);
+	r.p95_ms = percentile(errors, 0.95);
+	r.max_ms = errors.empty() ? 0.0 : *std::max_element(errors.begin(), errors.end());
+	r.us_per_measure = total_ns / (double)trials.size() / 1000.0;
+	return r;
+}
+
+// Golden rows keyed "clip scenario variant"
+static bool read_baseline(const char *path, std::map<std::string, struct row_result> *rows)
+{
+	FILE *f = fopen(path, "r");
+	if (!f)
+		return false;
+	char line[512];
+	while (fgets(line, sizeof(line), f)) {
+		char clip_name[128], scenario_name[64], variant_name[64];
+		struct row_result r;
+		if (line[0] == '#' || sscanf(line, "%127s %63s %63s %zu %zu %zu %lf", clip_name, scenario_name,
+					     variant_name, &r.ok, &r.gross, &r.trials, &r.p95_ms) != 7)
+			continue;
+		(*rows)[std::string(clip_name) + " " + scenario_name + " " + variant_name] = r;
+	}
+	fclose(f);
+	return true;
+}
+
+// One trial fewer over the threshold, one more gross error or a wider error tail all count
+static bool regressed(const struct row_result *r, const struct row_result *golden)
+{
+	return r->ok < golden->ok || r->gross > golden->gross ||
+	       r->p95_ms > golden->p95_ms * TOLERANCE_P95_FACTOR + TOLERANCE_P95_MS;
+}
+
+int main(int argc, char **argv)
+{
+	struct suite_options opt;
+	if (!parse_options(argc, argv, &opt)) {
+		fprintf(stderr,
+			"usage: %s [--trials n] [--window ms] [--lag ms] [--rate hz] [--wav file]...\n"
+			"       [--baseline file] [--write-baseline file]\n",
+			argv[0]);
+		return 1;
+	}
+
+	const size_t clip_frames = (size_t)CLIP_SECONDS * opt.rate;
+	std::mt19937 clip_rng(12345);
+	std::vector<struct clip> clips;
+	clips.push_back({"speech", speech_clip(clip_frames, opt.rate, &clip_rng)});
+	clips.push_back({"music", music_clip(clip_frames, opt.rate, &clip_rng)});
+	for (const std::string &path : opt.wav_paths) {
+		struct wav_file wav;
+		std::string error;
+		if (!wav_open(&wav, path.c_str(), &error)) {
+			fprintf(stderr, "Could not read %s: %s\n", path.c_str(), error.c_str());
+			return 1;
+		}
+		if (wav.sample_rate != opt.rate) {
+			fprintf(stderr, "%s is at %u Hz; pass --rate %u\n", path.c_str(), wav.sample_rate,
+				wav.sample_rate);
+			wav_close(&wav);
+			return 1;
+		}
+		struct clip c;
+		c.name = path.substr(path.find_last_of("/\\") + 1);
+		c.samples.resize((size_t)wav.frames);
+		wav_read(&wav, CAPTURE_CHANNEL_MIX, 0, c.samples.size(), c.samples.data());
+		wav_close(&wav);
+		clips.push_back(c);
+	}
+
+	std::map<std::string, struct row_result> golden;
+	if (!opt.baseline_path.empty() && !read_baseline(opt.baseline_path.c_str(), &golden)) {
+		fprintf(stderr, "Could not read %s\n", opt.baseline_path.c_str());
+		return 1;
+	}
+	for (const auto &row : golden) {
+		if (row.second.trials != opt.trials) {
+			fprintf(stderr, "%s was recorded with --trials %zu\n", opt.baseline_path.c_str(),
+				row.second.trials);
+			return 1;
+		}
+	}
+	FILE *out = nullptr;
+	if (!opt.write_path.empty()) {
+		out = fopen(opt.write_path.c_str(), "w");
+		if (!out) {
+			fprintf(stderr, "Could not write %s\n", opt.write_path.c_str());
+			return 1;
+		}
+		fprintf(out, "# accuracy-benchmark --trials %zu --window %u --lag %u --rate %u\n", opt.trials,
+			opt.window_ms, opt.lag_ms, opt.rate);
+		fprintf(out, "# clip scenario variant ok gross trials p95_err_ms\n");
+	}
+
+	const size_t frames = ms_to_samples(opt.window_ms, opt.rate);
+	// Planted delays stay inside the searched range and leave most of the window overlapping
+	const double max_delay = std::min(0.8 * (double)ms_to_samples(opt.lag_ms, opt.rate), 0.25 * (double)frames);
+
+	printf("kernels=%s trials=%zu window=%u lag=%u rate=%u gross>%.1fms\n", kernel_name(), opt.trials,
+	       opt.window_ms, opt.lag_ms, opt.rate, GROSS_ERROR_MS);
+	printf("%-12s %-6s %-10s %6s %10s %10s %10s %7s %10s\n", "clip", "case", "variant", "ok%", "median ms",
+	       "p95 ms", "max ms", "gross%", "us/measure");
+
+	size_t regressions = 0;
+	for (size_t ci = 0; ci < clips.size(); ++ci) {
+		const struct clip &c = clips[ci];
+		if (c.samples.size() < frames + 2 * ((size_t)max_delay + EQ_WARMUP + SINC_TAPS) + (size_t)opt.rate) {
+			printf("%-12s  too short\n", c.name.c_str());
+			continue;
+		}
+		for (size_t si = 0; si < sizeof(g_scenarios) / sizeof(g_scenarios[0]); ++si) {
+			const struct scenario &sc = g_scenarios[si];
+			// Every variant sees the same trials
+			std::mt19937 rng((uint32_t)(1000 * ci + si + 1));
+			std::vector<struct trial> trials(opt.trials);
+			for (struct trial &t : trials)
+				make_trial(c.samples, &sc, frames, opt.rate, max_delay, &rng, &t);
+
+			for (const struct variant &v : g_variants) {
+				const struct row_result r = run_variant(&v, &opt, trials);
+				const std::string key = c.name + " " + sc.name + " " + v.name;
+				const auto it = golden.find(key);
+				const bool bad = it != golden.end() && regressed(&r, &it->second);
+				regressions += bad ? 1 : 0;
+				printf("%-12s %-6s %-10s %6.1f %10.4f %10.4f %10.4f %7.1f %10.0f%s\n", c.name.c_str(),
+				       sc.name, v.name, row_pct(r.ok, r.trials), r.median_ms, r.p95_ms, r.max_ms,
+				       row_pct(r.gross, r.trials), r.us_per_measure, bad ? "  REGRESSED" : "");
+				if (bad)
+					printf("%-12s golden: ok %zu/%zu p95 %.4f ms gross %zu/%zu\n", "",
+					       it->second.ok, it->second.trials, it->second.p95_ms, it->second.gross,
+					       it->second.trials);
+				if (out)
+					fprintf(out, "%s %zu %zu %zu %.4f\n", key.c_str(), r.ok, r.gross, r.trials,
+						r.p95_ms);
+			}
+		}
+	}
+
+	if (out)
+		fclose(out);
+	if (!golden.empty()) {
+		printf("%zu regression(s) against %s\n", regressions, opt.baseline_path.c_str());
+		return regressions ? 1 : 0;
+	}
+	return 0;
+}
@@ -0,0 +1,350 @@
+/*
+Audio Sync Analyzer - Correlation engine benchmark
+Copyright (C) 2025
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+*/
+
+// Runs whole measurements through sync_engine_measure() over a sweep of window
+// lengths, lag ranges, sample rates and target counts, and reports the time
+// and heap allocations per measurement along with the worst delay error.
+//
+// Input is synthetic by default: enveloped white noise, with each target a
+// fractionally delayed copy plus independent noise.  --wav uses a recording
+// instead (downmixed to mono, targets delayed by whole samples) and its own
+// sample rate.
+//
+//   engine-benchmark [--window 300,1000,3000] [--lag 500,1500] [--rate 48000]
+//                    [--targets 1,4,16] [--coarse 0|1] [--weighting 0-3]
+//                    [--taper 0-2] [--noise 0.1] [--iterations 20] [--wav file]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "offline-analysis.h"
+#include "sync-engine.h"
+#include "task-pool.h"
+
+// Every heap allocation in the process goes through here.  GCC cannot see that
+// the replaced new and delete pair malloc with free.
+static std::atomic<size_t> g_allocations{0};
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void *operator new(size_t size)
+{
+	g_allocations.fetch_add(1, std::memory_order_relaxed);
+	if (void *p = malloc(size ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+
+void *operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void *p) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+	free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void *p, size_t) noexcept
+{
+	free(p);
+}
+
+// Distinct inputs cycled through the timed iterations
+#define TRIAL_SETS 4u
+// Half-width of the windowed-sinc fractional delay
+#define SINC_TAPS 16
+
+typedef std::chrono::steady_clock bench_clock;
+
+struct bench_options {
+	std::vector<uint32_t> windows_ms = {300, 1000, 3000};
+	std::vector<uint32_t> lags_ms = {500, 1500};
+	std::vector<uint32_t> rates = {48000};
+	std::vector<size_t> target_counts = {1, 4, 16};
+	bool coarse_search = true;
+	enum spectral_weighting weighting = WEIGHTING_NONE;
+	enum taper_kind taper = TAPER_HANN;
+	float noise = 0.1f;
+	size_t iterations = 20;
+	std::string wav_path;
+};
+
+// Inputs for one measurement: the reference and each target, plus the delay planted in each
+struct trial {
+	std::vector<float> ref;
+	std::vector<std::vector<float>> targets;
+	std::vector<double> delay_samples;
+};
+
+template<typename T> static std::vector<T> parse_list(const char *arg)
+{
+	std::vector<T> values;
+	const char *p = arg;
+	while (*p) {
+		char *end = nullptr;
+		const unsigned long long v = strtoull(p, &end, 10);
+		if (end == p)
+			break;
+		values.push_back((T)v);
+		p = *end == ',' ? end + 1 : end;
+	}
+	return values;
+}
+
+static bool parse_options(int argc, char **argv, struct bench_options *opt)
+{
+	for (int i = 1; i + 1 < argc; i += 2) {
+		const char *key = argv[i];
+		const char *value = argv[i + 1];
+		if (!strcmp(key, "--window"))
+			opt->windows_ms = parse_list<uint32_t>(value);
+		else if (!strcmp(key, "--lag"))
+			opt->lags_ms = parse_list<uint32_t>(value);
+		else if (!strcmp(key, "--rate"))
+			opt->rates = parse_list<uint32_t>(value);
+		else if (!strcmp(key, "--targets"))
+			opt->target_counts = parse_list<size_t>(value);
+		else if (!strcmp(key, "--coarse"))
+			opt->coarse_search = atoi(value) != 0;
+		else if (!strcmp(key, "--weighting"))
+			opt->weighting = spectral_weighting_from_int(atoll(value));
+		else if (!strcmp(key, "--taper"))
+			opt->taper = taper_from_int(atoll(value));
+		else if (!strcmp(key, "--noise"))
+			opt->noise = (float)atof(value);
+		else if (!strcmp(key, "--iterations"))
+			opt->iterations = std::max<size_t>(1, strtoull(value, nullptr, 10));
+		else if (!strcmp(key, "--wav"))
+			opt->wav_path = value;
+		else
+			return false;
+	}
+	return (argc % 2) == 1;
+}
+
+// Downmixes a whole recording to mono
+static bool load_wav(const char *path, std::vector<float> *samples, uint32_t *sample_rate)
+{
+	struct wav_file wav;
+	std::string error;
+	if (!wav_open(&wav, path, &error))
+		return false;
+	samples->resize((size_t)wav.frames);
+	wav_read(&wav, CAPTURE_CHANNEL_MIX, 0, samples->size(), samples->data());
+	*sample_rate = wav.sample_rate;
+	wav_close(&wav);
+	return true;
+}
+
+static double sinc_tap(double x)
+{
+	if (std::fabs(x) < 1e-12)
+		return 1.0;
+	const double window = 0.5 + 0.5 * cos(M_PI * x / (SINC_TAPS + 1));
+	return window * sin(M_PI * x) / (M_PI * x);
+}
+
+// Builds one trial.  The target is the source delayed by d samples, tgt(t) = src(t - d),
+// so a positive delay means the target lags.
+static void make_trial(const std::vector<float> &source, bool fractional, size_t frames, size_t count,
+		       double max_delay, float noise, std::mt19937 *rng, struct trial *t)
+{
+	std::uniform_real_distribution<double> delay_dist(-max_delay, max_delay);
+	std::normal_distribution<float> noise_dist(0.0f, noise);
+	const size_t margin = (size_t)std::ceil(max_delay) + SINC_TAPS + 1;
+	std::uniform_int_distribution<size_t> start_dist(margin, source.size() - frames - margin);
+	const size_t start = start_dist(*rng);
+
+	t->ref.assign(source.begin() + (ptrdiff_t)start, source.begin() + (ptrdiff_t)(start + frames));
+	t->targets.assign(count, std::vector<float>(frames));
+	t->delay_samples.assign(count, 0.0);
+	for (size_t i = 0; i < count; ++i) {
+		double d = delay_dist(*rng);
+		if (!fractional)
+			d = std::round(d);
+		const double whole = std::floor(d);
+		const double frac = d - whole;
+		t->delay_samples[i] = d;
+
+		std::vector<float> &tgt = t->targets[i];
+		for (size_t n = 0; n < frames; ++n) {
+			const ptrdiff_t base = (ptrdiff_t)(start + n) - (ptrdiff_t)whole;
+			double v = 0.0;
+			if (frac == 0.0) {
+				v = source[(size_t)base];
+			} else {
+				for (int k = -SINC_TAPS; k <= SINC_TAPS; ++k)
+					v += source[(size_t)(base - k)] * sinc_tap((double)k - frac);
+			}
+			tgt[n] = (float)v + (noise > 0.0f ? noise_dist(*rng) : 0.0f);
+		}
+	}
+}
+
+static std::vector<float> synthetic_source(size_t frames, uint32_t sample_rate, std::mt19937 *rng)
+{
+	std::normal_distribution<float> dist(0.0f, 0.3f);
+	std::vector<float> source(frames);
+	for (size_t i = 0; i < frames; ++i) {
+		// A slow envelope so the windows are not stationary noise
+		const double t = (double)i / (double)sample_rate;
+		source[i] = dist(*rng) * (float)(0.6 + 0.4 * sin(2.0 * M_PI * 1.7 * t));
+	}
+	return source;
+}
+
+static void run_config(const struct bench_options *opt, struct task_pool *pool, const std::vector<float> *recording,
+		       uint32_t sample_rate, uint32_t window_ms, uint32_t lag_ms, size_t count)
+{
+	struct sync_engine engine;
+	sync_engine_init(&engine, sample_rate, pool, nullptr);
+
+	struct sync_engine_settings settings;
+	settings.window_ms = window_ms;
+	settings.max_lag_ms = lag_ms;
+	settings.corr_threshold = 0.3f;
+	settings.coarse_search = opt->coarse_search;
+	settings.taper = opt->taper;
+	settings.weighting = opt->weighting;
+	settings.debug = false;
+
+	const size_t frames = ms_to_samples(window_ms, sample_rate);
+	// Planted delays stay inside the searched range and leave most of the window overlapping
+	const double max_delay = std::min(0.8 * (double)ms_to_samples(lag_ms, sample_rate), 0.25 * (double)frames);
+
+	std::mt19937 rng(sample_rate ^ (window_ms << 8) ^ (lag_ms << 20) ^ (uint32_t)count);
+	std::vector<float> source;
+	const size_t needed = frames + 2 * ((size_t)max_delay + SINC_TAPS + 2);
+	if (recording) {
+		if (recording->size() < needed) {
+			printf("%6u %6u %5u %3zu  recording too short\n", sample_rate, window_ms, lag_ms, count);
+			return;
+		}
+		source = *recording;
+	} else {
+		source = synthetic_source(needed * 2, sample_rate, &rng);
+	}
+
+	struct trial trials[TRIAL_SETS];
+	for (auto &t : trials)
+		make_trial(source, !recording, frames, count, max_delay, opt->noise, &rng, &t);
+
+	struct correlation_workspace ws;
+	std::vector<struct target_workspace> tws(count);
+	std::vector<struct measurement_sample> outs(count);
+	std::vector<const float *> targets(count);
+
+	double total_ns = 0.0;
+	size_t allocations = 0;
+	double max_error = 0.0;
+	size_t ok = 0;
+	size_t attempts = 0;
+	// The first pass over the trial sets sizes every workspace and is not counted
+	for (size_t it = 0; it < opt->iterations + TRIAL_SETS; ++it) {
+		const struct trial &t = trials[it % TRIAL_SETS];
+		for (size_t i = 0; i < count; ++i)
+			targets[i] = t.targets[i].data();
+
+		const size_t allocations_before = g_allocations.load(std::memory_order_relaxed);
+		const bench_clock::time_point start = bench_clock::now();
+		sync_engine_measure(&engine, &settings, &ws, tws.data(), t.ref.data(), targets.data(), count, frames,
+				    outs.data());
+		const double ns =
+			(double)std::chrono::duration_cast<std::chrono::nanoseconds>(bench_clock::now() - start).count();
+		if (it < TRIAL_SETS)
+			continue;
+
+		total_ns += ns;
+		allocations += g_allocations.load(std::memory_order_relaxed) - allocations_before;
+		for (size_t i = 0; i < count; ++i) {
+			++attempts;
+			if (!outs[i].success)
+				continue;
+			++ok;
+			const double measured = outs[i].delay_ms * (double)sample_rate / 1000.0;
+			max_error = std::max(max_error, std::fabs(measured - t.delay_samples[i]));
+		}
+	}
+
+	const double per_measure = total_ns / (double)opt->iterations;
+	printf("%6u %6u %5u %3zu  %12.0f %12.0f %8.1f %10.3f  %zu/%zu\n", sample_rate, window_ms, lag_ms, count,
+	       per_measure, per_measure / (double)count, (double)allocations / (double)opt->iterations, max_error, ok,
+	       attempts);
+}
+
+int main(int argc, char **argv)
+{
+	struct bench_options opt;
+	if (!parse_options(argc, argv, &opt)) {
+		fprintf(stderr,
+			"usage: %s [--window ms,...] [--lag ms,...] [--rate hz,...] [--targets n,...] [--coarse 0|1]\n"
+			"       [--weighting 0-3] [--taper 0-2] [--noise sigma] [--iterations n] [--wav file]\n",
+			argv[0]);
+		return 1;
+	}
+
+	std::vector<float> recording;
+	if (!opt.wav_path.empty()) {
+		uint32_t rate = 0;
+		if (!load_wav(opt.wav_path.c_str(), &recording, &rate)) {
+			fprintf(stderr, "Could not read %s (PCM 16/24/32-bit or float32 WAV)\n", opt.wav_path.c_str());
+			return 1;
+		}
+		opt.rates = {rate};
+	}
+
+	struct task_pool pool;
+	const size_t workers = std::min<size_t>(std::max(std::thread::hardware_concurrency(), 2u), MAX_TARGETS);
+	task_pool_init(&pool, workers);
+
+	printf("coarse=%d weighting=%s taper=%s noise=%.3f iterations=%zu workers=%zu input=%s\n",
+	       opt.coarse_search ? 1 : 0, spectral_weighting_name(opt.weighting), taper_name(opt.taper), opt.noise,
+	       opt.iterations, pool.threads.size(), opt.wav_path.empty() ? "synthetic" : opt.wav_path.c_str());
+	printf("%6s %6s %5s %3s  %12s %12s %8s %10s  %s\n", "rate", "window", "lag", "tgt", "ns/measure", "ns/target",
+	       "allocs", "max err", "ok");
+
+	for (uint32_t rate : opt.rates) {
+		for (uint32_t window_ms : opt.windows_ms) {
+			for (uint32_t lag_ms : opt.lags_ms) {
+				for (size_t count : opt.target_counts) {
+					count = std::min<size_t>(std::max<size_t>(count, 1), MAX_TARGETS);
+					run_config(&opt, &pool, recording.empty() ? nullptr : &recording, rate, window_ms,
+						   lag_ms, count);
+				}
+			}
+		}
+	}
+
+	task_pool_shutdown(&pool);
+	return 0;
+}
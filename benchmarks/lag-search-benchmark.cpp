@@ -0,0 +1,177 @@
+/*
+Audio Sync Analyzer - Lag search microbenchmark
+Copyright (C) 2025
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+*/
+
+// Compares the original one-lag-at-a-time search against lag_search() and
+// checks that both pick the same lag, correlation and lag count on random
+// inputs, including near-silent and very loud windows.
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "lag-search.h"
+
+#define SAMPLE_RATE 48000u
+#define MAX_LAG_FRAMES 72000
+#define WINDOW_FRAMES 144000u
+
+// Original implementation, kept verbatim for comparison
+static double legacy_search(const double *ref_prefix, const double *tgt_prefix, const float *corr_time,
+			    size_t frames, size_t nfft, int max_lag, int *best_lag_out, int *lag_count_out)
+{
+	double best_corr = -1.0;
+	int best_lag = 0;
+	int lag_count = 0;
+
+	for (int lag = -max_lag; lag <= max_lag; ++lag) {
+		const int abs_lag = std::abs(lag);
+		const size_t overlap = frames - (size_t)abs_lag;
+		if (overlap < 1024)
+			continue;
+
+		double energy_ref = 0.0;
+		double energy_tgt = 0.0;
+
+		if (lag >= 0) {
+			energy_ref = ref_prefix[overlap] - ref_prefix[0];
+			energy_tgt = tgt_prefix[(size_t)lag + overlap] - tgt_prefix[(size_t)lag];
+		} else {
+			const size_t start = (size_t)abs_lag;
+			energy_ref = ref_prefix[start + overlap] - ref_prefix[start];
+			energy_tgt = tgt_prefix[overlap] - tgt_prefix[0];
+		}
+
+		double denom = sqrt(energy_ref * energy_tgt);
+		if (denom < 1e-8)
+			continue;
+
+		const size_t idx = lag >= 0 ? (size_t)lag : nfft - (size_t)abs_lag;
+		double corr = corr_time[idx] / denom;
+		lag_count++;
+
+		if (corr > best_corr) {
+			best_corr = corr;
+			best_lag = lag;
+		}
+	}
+
+	*best_lag_out = best_lag;
+	*lag_count_out = lag_count;
+	return best_corr;
+}
+
+struct search_input {
+	size_t frames;
+	size_t nfft;
+	int max_lag;
+	std::vector<double> ref_prefix;
+	std::vector<double> tgt_prefix;
+	std::vector<float> corr;
+};
+
+// Prefix sums of gaussian noise scaled by `scale`, with a correlation peak at `peak` when non-negative
+static void make_input(std::mt19937 &rng, size_t frames, int max_lag, double scale, int peak, search_input *in)
+{
+	std::normal_distribution<float> noise;
+	size_t nfft = 1;
+	while (nfft < frames * 2)
+		nfft <<= 1;
+
+	in->frames = frames;
+	in->nfft = nfft;
+	in->max_lag = max_lag;
+	in->ref_prefix.assign(frames + 1, 0.0);
+	in->tgt_prefix.assign(frames + 1, 0.0);
+	in->corr.resize(nfft);
+	for (size_t i = 0; i < frames; ++i) {
+		const double r = noise(rng);
+		const double t = noise(rng);
+		in->ref_prefix[i + 1] = in->ref_prefix[i] + r * r * scale;
+		in->tgt_prefix[i + 1] = in->tgt_prefix[i] + t * t * scale;
+	}
+	const float spread = (float)(sqrt((double)frames) * scale);
+	for (size_t i = 0; i < nfft; ++i)
+		in->corr[i] = noise(rng) * spread;
+	if (peak >= 0)
+		in->corr[(size_t)peak] = (float)(0.8 * (double)frames * scale);
+}
+
+typedef std::chrono::steady_clock bench_clock;
+
+static double elapsed_ns(bench_clock::time_point start)
+{
+	return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(bench_clock::now() - start).count();
+}
+
+int main(int argc, char **argv)
+{
+	const size_t iterations = argc > 1 ? (size_t)strtoull(argv[1], nullptr, 10) : 200;
+	std::mt19937 rng(1);
+
+	// Equivalence on assorted sizes; lags that exceed the window exercise the overlap limit
+	const double scales[] = {1.0, 1e-12, 1e20};
+	size_t mismatches = 0;
+	size_t cases = 0;
+	for (int i = 0; i < 300; ++i) {
+		search_input in;
+		const size_t frames = 1024 + rng() % 60000;
+		const int max_lag = (int)std::min<size_t>(rng() % 80000, frames - 1);
+		make_input(rng, frames, max_lag, scales[i % 3], i % 2 ? (int)(rng() % (frames / 2)) : -1, &in);
+
+		int legacy_lag = 0;
+		int legacy_count = 0;
+		const double legacy_corr = legacy_search(in.ref_prefix.data(), in.tgt_prefix.data(), in.corr.data(),
+							 in.frames, in.nfft, in.max_lag, &legacy_lag, &legacy_count);
+		const struct lag_search_result res = lag_search(in.ref_prefix.data(), in.tgt_prefix.data(),
+								  in.corr.data(), in.frames, in.nfft, in.max_lag, LAG_SEARCH_MIN_OVERLAP);
+		cases++;
+		const bool same = res.best_lag == legacy_lag && res.best_corr == legacy_corr &&
+				  (int)res.valid_count == legacy_count;
+		if (!same) {
+			mismatches++;
+			printf("mismatch: frames=%zu max_lag=%d lag %d/%d corr %.17g/%.17g count %d/%zu\n", in.frames,
+			       in.max_lag, legacy_lag, res.best_lag, legacy_corr, res.best_corr, legacy_count,
+			       res.valid_count);
+		}
+	}
+	printf("equivalence: %zu/%zu cases identical\n", cases - mismatches, cases);
+
+	// Timing at the largest configuration: 3 s window, 1500 ms max lag
+	search_input in;
+	make_input(rng, WINDOW_FRAMES, MAX_LAG_FRAMES, 1.0, 2400, &in);
+	double sink = 0.0;
+
+	auto start = bench_clock::now();
+	for (size_t i = 0; i < iterations; ++i) {
+		int lag = 0;
+		int count = 0;
+		sink += legacy_search(in.ref_prefix.data(), in.tgt_prefix.data(), in.corr.data(), in.frames, in.nfft,
+				      in.max_lag, &lag, &count);
+	}
+	const double legacy_ns = elapsed_ns(start);
+
+	start = bench_clock::now();
+	for (size_t i = 0; i < iterations; ++i)
+		sink += lag_search(in.ref_prefix.data(), in.tgt_prefix.data(), in.corr.data(), in.frames, in.nfft,
+				   in.max_lag, LAG_SEARCH_MIN_OVERLAP)
+				.best_corr;
+	const double kernel_ns = elapsed_ns(start);
+
+	const double lags = (double)(2 * MAX_LAG_FRAMES + 1);
+	printf("lags per search: %.0f (%u Hz, checksum %.3f)\n", lags, SAMPLE_RATE, sink);
+	printf("search legacy    : %8.1f us  %6.2f ns/lag\n", legacy_ns / (double)iterations / 1000.0,
+	       legacy_ns / (double)iterations / lags);
+	printf("search lag_search: %8.1f us  %6.2f ns/lag  (%.1fx)\n", kernel_ns / (double)iterations / 1000.0,
+	       kernel_ns / (double)iterations / lags, legacy_ns / kernel_ns);
+	return mismatches ? 1 : 0;
+}
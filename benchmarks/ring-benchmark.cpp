@@ -0,0 +1,170 @@
+/*
+Audio Sync Analyzer - Capture ring microbenchmark
+Copyright (C) 2025
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+*/
+
+// Compares the original per-sample modulo ring against sync_ring's
+// power-of-two block copy, for both the audio-thread write and the
+// analyzer-side window read, then times each storage precision and reports
+// its footprint and worst round-trip error.
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "sync-ring.h"
+
+#define SAMPLE_RATE 48000u
+#define BUFFER_SECONDS 5u
+#define PACKET_FRAMES 1024u
+#define WINDOW_FRAMES 48000u
+
+// Original implementation, kept verbatim for comparison
+static void legacy_ring_write(float *buffer, size_t capacity, size_t *pos, size_t *count, const float *src,
+			      size_t frames)
+{
+	for (size_t i = 0; i < frames; ++i) {
+		buffer[*pos] = src[i];
+		*pos = (*pos + 1) % capacity;
+		if (*count < capacity)
+			(*count)++;
+	}
+}
+
+static void legacy_copy_recent(const float *buffer, size_t capacity, size_t pos, float *dst, size_t frames)
+{
+	const size_t start = (pos + capacity - frames) % capacity;
+	for (size_t i = 0; i < frames; ++i)
+		dst[i] = buffer[(start + i) % capacity];
+}
+
+typedef std::chrono::steady_clock bench_clock;
+
+static double elapsed_ns(bench_clock::time_point start)
+{
+	return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(bench_clock::now() - start).count();
+}
+
+// Keeps the optimizer from discarding the copies
+static volatile float g_sink;
+
+int main(int argc, char **argv)
+{
+	const size_t iterations = argc > 1 ? (size_t)strtoull(argv[1], nullptr, 10) : 200000;
+	const size_t legacy_capacity = (size_t)SAMPLE_RATE * BUFFER_SECONDS;
+
+	std::vector<float> packet(PACKET_FRAMES);
+	for (size_t i = 0; i < packet.size(); ++i)
+		packet[i] = (float)i / (float)PACKET_FRAMES;
+	std::vector<float> window(WINDOW_FRAMES);
+
+	std::vector<float> legacy(legacy_capacity, 0.0f);
+	size_t legacy_pos = 0;
+	size_t legacy_count = 0;
+
+	sync_ring ring;
+	sync_ring_init(&ring, legacy_capacity);
+
+	printf("ring capacity: legacy=%zu sync_ring=%zu, packet=%u frames, window=%u frames\n", legacy_capacity,
+	       ring.capacity, PACKET_FRAMES, WINDOW_FRAMES);
+
+	auto start = bench_clock::now();
+	for (size_t i = 0; i < iterations; ++i)
+		legacy_ring_write(legacy.data(), legacy_capacity, &legacy_pos, &legacy_count, packet.data(),
+				  packet.size());
+	const double legacy_write_ns = elapsed_ns(start);
+	g_sink = legacy[legacy_pos];
+
+	start = bench_clock::now();
+	for (size_t i = 0; i < iterations; ++i)
+		sync_ring_write(&ring, packet.data(), packet.size(), i);
+	const double ring_write_ns = elapsed_ns(start);
+	g_sink = (float)ring.buffer[0];
+
+	const size_t reads = iterations / 50 + 1;
+
+	start = bench_clock::now();
+	for (size_t i = 0; i < reads; ++i) {
+		legacy_copy_recent(legacy.data(), legacy_capacity, (legacy_pos + i * 97) % legacy_capacity,
+				   window.data(), window.size());
+		g_sink = window[i % window.size()];
+	}
+	const double legacy_read_ns = elapsed_ns(start);
+
+	start = bench_clock::now();
+	for (size_t i = 0; i < reads; ++i) {
+		if (!sync_ring_snapshot(&ring, window.data(), window.size()))
+			return 1;
+		g_sink = window[i % window.size()];
+	}
+	const double ring_read_ns = elapsed_ns(start);
+
+	// Zero-copy read: the caller consumes the spans directly (summed here)
+	start = bench_clock::now();
+	for (size_t i = 0; i < reads; ++i) {
+		sync_ring_view view;
+		if (!sync_ring_peek(&ring, window.size(), &view))
+			return 1;
+		float sum = 0.0f;
+		for (int s = 0; s < 2; ++s)
+			for (size_t j = 0; j < view.frames[s]; ++j)
+				sum += static_cast<const float *>(view.data[s])[j];
+		if (!sync_ring_view_valid(&ring, &view))
+			return 1;
+		g_sink = sum;
+	}
+	const double ring_view_ns = elapsed_ns(start);
+
+	const double total_frames = (double)iterations * PACKET_FRAMES;
+	printf("write  legacy   : %8.3f ns/frame  %8.1f Mframes/s\n", legacy_write_ns / total_frames,
+	       total_frames / legacy_write_ns * 1000.0);
+	printf("write  sync_ring: %8.3f ns/frame  %8.1f Mframes/s  (%.1fx)\n", ring_write_ns / total_frames,
+	       total_frames / ring_write_ns * 1000.0, legacy_write_ns / ring_write_ns);
+	printf("read   legacy   : %8.1f us/window\n", legacy_read_ns / (double)reads / 1000.0);
+	printf("read   snapshot : %8.1f us/window  (%.1fx)\n", ring_read_ns / (double)reads / 1000.0,
+	       legacy_read_ns / ring_read_ns);
+	printf("read   view+sum : %8.1f us/window\n", ring_view_ns / (double)reads / 1000.0);
+
+	// Storage precisions: a near full-scale sine at a frequency unrelated to the
+	// packet, so its samples are not the short binary fractions a ramp over the
+	// packet gives, which half precision stores exactly
+	for (size_t i = 0; i < packet.size(); ++i)
+		packet[i] = (float)(0.99 * std::sin(2.0 * M_PI * 7.31 * (double)i / (double)PACKET_FRAMES));
+	for (int f = 0; f < SAMPLE_FORMAT_COUNT; ++f) {
+		const enum sample_format format = (enum sample_format)f;
+		sync_ring fr;
+		sync_ring_init(&fr, legacy_capacity, format);
+
+		start = bench_clock::now();
+		for (size_t i = 0; i < iterations; ++i)
+			sync_ring_write(&fr, packet.data(), packet.size(), i);
+		const double write_ns = elapsed_ns(start);
+
+		start = bench_clock::now();
+		for (size_t i = 0; i < reads; ++i) {
+			if (!sync_ring_snapshot(&fr, window.data(), window.size()))
+				return 1;
+			g_sink = window[i % window.size()];
+		}
+		const double read_ns = elapsed_ns(start);
+
+		// The newest window ends on a packet boundary, so it lines up with the packet pattern
+		double max_error = 0.0;
+		for (size_t i = 0; i < window.size(); ++i) {
+			const float want = packet[(i + PACKET_FRAMES - window.size() % PACKET_FRAMES) % PACKET_FRAMES];
+			max_error = std::max(max_error, (double)std::fabs(window[i] - want));
+		}
+
+		printf("%-15s: %6zu KiB  write %6.3f ns/frame  snapshot %7.1f us/window  max error %.2e\n",
+		       sample_format_name(format), sync_ring_bytes(&fr) / 1024, write_ns / total_frames,
+		       read_ns / (double)reads / 1000.0, max_error);
+	}
+	return 0;
+}
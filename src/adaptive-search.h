@@ -0,0 +1,62 @@
+/*
+Audio Sync Analyzer - Adaptive window and lag range
+Copyright (C) 2025
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+// Once a target's delay is known, the next measurement only has to confirm it.
+// The target window is shifted by the known delay so the two windows line up,
+// which lets both shrink to ADAPTIVE_WINDOW_MS with a full overlap, and the lag
+// search only covers a few confidence intervals around it.  A narrowed result
+// that fails or lands near the edge of its range widens the search to the full
+// settings again.
+
+// Window used while every target of a measurement is narrowed
+#define ADAPTIVE_WINDOW_MS 250u
+// A wide result with an interval (95% half-width) this tight narrows the next search
+#define ADAPTIVE_MAX_INTERVAL_MS 2.0
+// Lags searched either side of the known delay: this many intervals, at least ADAPTIVE_MIN_RADIUS_MS
+#define ADAPTIVE_INTERVALS 4.0
+#define ADAPTIVE_MIN_RADIUS_MS 10.0
+// A peak this close to the edge of the range may belong to a delay outside it
+#define ADAPTIVE_EDGE_MS 1.0
+
+struct adaptive_search {
+	bool narrowed = false;
+	// Delay the windows are aligned on and the search range either side of it
+	double center_ms = 0.0;
+	double radius_ms = 0.0;
+};
+
+static inline void adaptive_search_reset(struct adaptive_search *a)
+{
+	a->narrowed = false;
+	a->center_ms = 0.0;
+	a->radius_ms = 0.0;
+}
+
+// Takes one result.  `narrowed` is whether it came from the search in `a`;
+// max_lag_ms caps the range at what a wide search covers.
+static inline void adaptive_search_update(struct adaptive_search *a, bool narrowed, bool success, double delay_ms,
+					  double interval_ms, double max_lag_ms)
+{
+	const bool confident = narrowed ? std::fabs(delay_ms - a->center_ms) < a->radius_ms - ADAPTIVE_EDGE_MS
+					: interval_ms <= ADAPTIVE_MAX_INTERVAL_MS;
+	if (!success || !confident) {
+		adaptive_search_reset(a);
+		return;
+	}
+
+	a->narrowed = true;
+	a->center_ms = delay_ms;
+	a->radius_ms = std::min(std::max(ADAPTIVE_INTERVALS * interval_ms, ADAPTIVE_MIN_RADIUS_MS), max_lag_ms);
+}
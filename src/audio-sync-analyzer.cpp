@@ -1,6 +1,6 @@
 /*
 Audio Sync Analyzer - High Quality Correlation
-Copyright (C) 2025 
+Copyright (C) 2025
 
 This program is free software; you can redistribute it and/or modify
 it under the terms of the GNU General Public License as published by
@@ -15,10 +15,13 @@ the Free Software Foundation; either version 2 of the License, or
 #include <time.h>
 
 #include <algorithm>
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <cmath>
 #include <complex>
+#include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -28,7 +31,18 @@ the Free Software Foundation; either version 2 of the License, or
 #include <util/bmem.h>
 #include <util/platform.h>
 
-#include "pocketfft_hdronly.h"
+#include "adaptive-search.h"
+#include "channel-mix.h"
+#include "drift-estimator.h"
+#include "lag-search.h"
+#include "offline-analysis.h"
+#include "sync-engine.h"
+#include "sync-plot.h"
+#include "sync-ring.h"
+#include "sync-stats.h"
+#include "task-pool.h"
+#include "voice-activity.h"
+#include "websocket-vendor.h"
 
 #define BUFFER_SECONDS 5u
 #define MIN_WINDOW_MS 200u
@@ -36,84 +50,356 @@ the Free Software Foundation; either version 2 of the License, or
 #define DEFAULT_WINDOW_MS 1000u
 #define MAX_LAG_MS 1500u
 #define MIN_CORR_THRESHOLD 0.3f
-#define BANDPASS_LOW_Hz 200.0f
-#define BANDPASS_HIGH_Hz 2000.0f
+#define MONITOR_HOP_MS 250u
+// Distance between the fitted delay and the applied offset that calls for a re-apply
+#define DEFAULT_DRIFT_TOLERANCE_MS 5.0
+// Auto apply acts on a change that stayed outside the tolerance, and within it of itself, this long
+#define AUTO_APPLY_STABLE_MS 5000u
+// and never re-applies one target more often than this
+#define AUTO_APPLY_MIN_INTERVAL_MS 30000u
+// Adjustments kept for the dock; every one is also logged
+#define AUTO_APPLY_HISTORY 32u
+// The dock refreshes at most this often however fast results arrive
+#define DOCK_REFRESH_MS 100u
+// Log entries waiting for the next refresh, and lines the dock's log keeps
+#define DOCK_PENDING_MAX 64u
+#define DOCK_LOG_LINES 500
+// Avg: measurements taken, how many of the best are averaged, and the spacing
+// between windows when they have to be collected over time
+#define AVERAGE_ROUNDS 10u
+#define AVERAGE_TOP 4u
+#define AVERAGE_INTERVAL_MS 400u
+// Closest spacing of the windows cut from one buffer snapshot
+#define AVERAGE_MIN_HOP_MS 100u
+// Stack block the capture callbacks filter into before writing to the ring
+#define CAPTURE_BLOCK_FRAMES 256u
+// OBS's own limits: timestamps this close to os_gettime_ns() are taken as they
+// are, and packets this close to where the last one ended are continuous
+#define CAPTURE_MAX_TS_VAR_NS 2000000000LL
+#define CAPTURE_TS_SMOOTHING_NS 70000000LL
+
+// Streaming bandpass for one capture ring.  `state` and `channel` belong to the
+// audio callback (or to whoever holds the source after removing the callback).
+// `filtered` says whether the ring holds bandpassed samples; the callback
+// resets the ring before flipping it, so readers never see a mix.
+struct capture_filter {
+	struct bandpass_state state = {};
+	// Channel selection the ring's contents were captured with
+	int channel = CAPTURE_CHANNEL_MIX;
+	std::atomic<bool> filtered{false};
+	// Maps a device clock onto os_gettime_ns(); written only by the audio thread
+	std::atomic<int64_t> timing_adjust_ns{0};
+	std::atomic<bool> timing_set{false};
+	// Which blocks of the ring carry speech-like audio; written by the audio callback
+	struct voice_activity vad;
+	// Set when the ring took over another capture's history (see adopt_history());
+	// the first packet fills the frames missed in the handover with silence
+	bool resume = false;
+};
 
-struct bandpass_coeffs {
-	float b0, b1, b2, a1, a2;
+enum sync_filter_role { SYNC_FILTER_TARGET, SYNC_FILTER_REFERENCE };
+
+// A "Sync Analyzer" audio filter.  Put on a source, it selects the source for
+// measurement and becomes its capture point: the source's ring is fed from
+// filter_audio instead of an audio capture callback, so the analyzer hears the
+// audio as it leaves this filter.  Adding or removing the filter takes effect at
+// once.  The analyzer finds the source through the filter's parent pointer and
+// the ring it binds is matched by source pointer, so renaming the source or
+// adding a second filter to it keeps the same ring.
+struct sync_filter {
+	obs_source_t *context = nullptr;
+	// Source the filter is on, from filter_add to filter_remove; guarded by audio_sync_data::lock
+	obs_source_t *parent = nullptr;
+	enum sync_filter_role role = SYNC_FILTER_TARGET;
+
+	// Capture callback filter_audio feeds, or null.  The audio thread only
+	// try-locks, so it never waits while a ring is attached or detached.
+	pthread_mutex_t lock;
+	obs_source_audio_capture_t sink = nullptr;
+	void *sink_param = nullptr;
 };
 
 struct audio_sync_data;
 static audio_sync_data *g_dm = nullptr;
 
+// UI-thread code reads g_dm directly, since shutdown runs there too.  Other
+// threads (API requests, filter callbacks) hold it through acquire_dm() and
+// release_dm(); shutdown clears g_dm and waits for them before freeing it.
+static pthread_mutex_t g_dm_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_dm_idle = PTHREAD_COND_INITIALIZER;
+static size_t g_dm_users = 0;
+
+static audio_sync_data *acquire_dm()
+{
+	pthread_mutex_lock(&g_dm_lock);
+	audio_sync_data *dm = g_dm;
+	if (dm)
+		g_dm_users++;
+	pthread_mutex_unlock(&g_dm_lock);
+	return dm;
+}
+
+static void release_dm()
+{
+	pthread_mutex_lock(&g_dm_lock);
+	if (--g_dm_users == 0)
+		pthread_cond_broadcast(&g_dm_idle);
+	pthread_mutex_unlock(&g_dm_lock);
+}
+
+// Stops handing out g_dm and returns it once nobody off the UI thread holds it
+static audio_sync_data *retire_dm()
+{
+	pthread_mutex_lock(&g_dm_lock);
+	audio_sync_data *dm = g_dm;
+	g_dm = nullptr;
+	while (g_dm_users)
+		pthread_cond_wait(&g_dm_idle, &g_dm_lock);
+	pthread_mutex_unlock(&g_dm_lock);
+	return dm;
+}
+
+// Reference side of the continuous monitor.  Each hop correlates one new
+// reference block against the matching span (+/- max lag) of every target.
+// Per-lag products and energies are accumulated with an exponential decay whose
+// time constant is window_ms, so a hop costs O((hop + 2 * max_lag) log n) no
+// matter how long the effective window is.
+struct monitor_state {
+	size_t hop = 0;
+	size_t max_lag = 0;
+	size_t nfft = 0;
+	std::unique_ptr<pocketfft::detail::pocketfft_r<float>> plan;
+
+	std::vector<float> ref_spec;
+	std::vector<float> scratch;
+
+	struct bandpass_state ref_filter;
+	// Next reference frame to consume
+	uint64_t ref_pos = 0;
+	uint64_t last_progress_ns = 0;
+	// Bumped on every re-anchor; targets anchored to an older generation are stale
+	uint64_t generation = 0;
+	bool anchored = false;
+};
+
+// Target side of the monitor
+struct monitor_target {
+	// Filtered target frames [ref_pos + offset - max_lag, ... + hop + max_lag)
+	std::vector<float> hist;
+	std::vector<double> prefix;
+	std::vector<float> corr;
+
+	std::vector<double> corr_acc;
+	std::vector<double> energy_acc;
+	double ref_energy_acc = 0.0;
+	size_t hops = 0;
+
+	struct bandpass_state filter;
+	// Target frame matching reference frame n is n + offset
+	int64_t offset = 0;
+	uint64_t last_progress_ns = 0;
+	uint64_t generation = 0;
+	bool anchored = false;
+};
+
+// Run of monitor results outside the tolerance that may turn into an adjustment
+struct auto_apply_state {
+	uint64_t run_start_ns = 0;
+	double run_min_ms = 0.0;
+	double run_max_ms = 0.0;
+	double run_sum_ms = 0.0;
+	size_t run_count = 0;
+	uint64_t last_apply_ns = 0;
+};
+
+// Buffers for an average cut from one snapshot of the whole ring
+struct average_state {
+	// Filtered snapshot of the reference and of each ready target, all ending at the same moment
+	std::vector<float> ref;
+	std::vector<float> tgt[MAX_TARGETS];
+	// Reference side and target scratch for each worker thread
+	struct correlation_workspace ws[AVERAGE_ROUNDS];
+	struct target_workspace tw[AVERAGE_ROUNDS];
+	// Pool tasks for the workers
+	struct task_batch tasks;
+};
+
+struct sync_target {
+	struct audio_sync_data *dm;
+	// Replaced on the UI thread when the source is renamed, while workers may be
+	// logging it; read it through target_name() off the UI thread
+	std::shared_ptr<const std::string> name;
+	obs_source_t *source = nullptr;
+	sync_ring ring;
+	struct capture_filter capture;
+	// Plane to capture or CAPTURE_CHANNEL_MIX; read by the audio callback
+	std::atomic<int> channel{CAPTURE_CHANNEL_MIX};
+
+	// Used only while holding audio_sync_data::workspace_lock
+	struct target_workspace workspace;
+	// Used only by the monitor thread
+	struct monitor_target monitor;
+
+	// Latest result, guarded by audio_sync_data::lock
+	std::string delay_text = "---";
+	std::string status;
+	double delay_ms = 0.0;
+	double interval_ms = 0.0;
+	float correlation = 0.0f;
+	bool valid = false;
+	// Fed by every successful result, guarded by audio_sync_data::lock
+	struct drift_estimator drift;
+	// What the dock plots, guarded by audio_sync_data::lock: the latest curve
+	// from a single measurement or the monitor, and every result's delay
+	struct sync_curve curve;
+	struct sync_history history;
+	// Used only by the monitor thread
+	struct auto_apply_state auto_apply;
+	// Where Measure looks next, guarded by audio_sync_data::lock
+	struct adaptive_search adaptive;
+};
+
+// The target's current name, kept alive for as long as the caller holds it
+static std::shared_ptr<const std::string> target_name(const struct sync_target *target)
+{
+	return std::atomic_load(&target->name);
+}
+
+// Snapshot of the target list; holding the shared_ptrs keeps removed targets alive
+struct target_list {
+	std::shared_ptr<sync_target> items[MAX_TARGETS];
+	size_t count = 0;
+};
+
+// One result for the dock's log.  Live entries (the monitor's running results)
+// replace the live entry before them instead of adding a new one.
+struct dock_entry {
+	std::string time;
+	std::string notes;
+	bool live;
+};
+
+// Row shown in the dock's per-target result table
+struct target_row {
+	std::string name;
+	std::string delay_text;
+	double correlation;
+	bool valid;
+};
+
 static void connect_ref(struct audio_sync_data *dm);
-static void connect_target(struct audio_sync_data *dm);
+static void connect_targets(struct audio_sync_data *dm);
+static void connect_sources(struct audio_sync_data *dm);
+static void set_ring_format(struct audio_sync_data *dm, enum sample_format format);
+static void follow_audio_output(struct audio_sync_data *dm);
+static bool audio_output_changed(struct audio_sync_data *dm, uint32_t *rate, size_t *channels);
+static void apply_audio_output(struct audio_sync_data *dm, uint32_t rate, size_t channels);
 
 struct audio_sync_data {
 	obs_source_t *ref;
-	obs_source_t *target;
 	std::string ref_name;
-	std::string target_name;
 	std::string connected_ref;
-	std::string connected_target;
-
+	std::vector<std::string> target_names;
+	// Channel selection per source name; sources not listed are downmixed.  Guarded by lock.
+	std::map<std::string, int> source_channels;
+	// Guarded by lock; each target owns its capture ring
+	std::vector<std::shared_ptr<sync_target>> targets;
+	// Every Sync Analyzer filter instance, guarded by lock
+	std::vector<struct sync_filter *> filters;
+	// Target whose result drives the headline and Apply
+	size_t selected_target;
+
+	// Guards settings and UI/result state only; the capture rings are lock-free
 	pthread_mutex_t lock;
 
-	float *ref_buffer;
-	float *tgt_buffer;
+	sync_ring ref_ring;
+	struct capture_filter ref_capture;
+	// Plane the reference callback captures, or CAPTURE_CHANNEL_MIX
+	std::atomic<int> ref_channel;
 	size_t capacity;
-	size_t ref_pos;
-	size_t tgt_pos;
-	size_t ref_count;
-	size_t tgt_count;
-	uint64_t last_ref_ns;
-	uint64_t last_tgt_ns;
+	// Storage precision of every capture ring; changed only through set_ring_format()
+	enum sample_format ring_format;
 
 	uint32_t sample_rate;
 	enum audio_format audio_format;
+	// Planes in each captured packet (the output's channel count)
+	size_t channels;
 	uint32_t window_ms;
 	uint32_t max_lag_ms;
 	float corr_threshold;
+	// Decimated first pass plus full-rate refinement instead of one full-rate FFT
+	bool coarse_search;
+	// Shrink the window and lag range around each target's last confident delay
+	bool adaptive_search;
+	// Taper applied to each analysis window
+	enum taper_kind taper;
+	// Cross-spectrum weighting; anything but NONE locates the peak on a whitened correlation
+	enum spectral_weighting weighting;
+	// Bandpass in the capture callbacks so measurements read filtered rings; read by the audio thread
+	std::atomic<bool> stream_filter;
 	bool debug_enabled;
-
-	// Bandpass filter coefficients (state is reset for each measurement)
-	struct bandpass_coeffs bp_coeffs;
+	double drift_tolerance_ms;
+	// Let the monitor apply stable delay changes itself
+	bool auto_apply;
+	// Only correlate windows where both sources carry speech-like audio
+	bool voice_gate;
+	// Newest last, guarded by lock
+	std::vector<std::string> auto_apply_events;
+
+	// Sample rate, bandpass and worker pool shared with the correlation engine
+	struct sync_engine engine;
+	// Always-on stage timings, shown in the dock with debug logging on
+	struct sync_stats stats;
+
+	pthread_mutex_t workspace_lock;
+	struct correlation_workspace workspace;
 
 	std::string last_delay_text = "---";
 	std::string last_time_text;
-	std::string last_notes;
+	std::string last_notes_text;
+	// Bumped with every posted result, guarded by lock; scripted callers wait for it to pass what they were given
+	uint64_t result_seq = 0;
+	// The latest result is the monitor's running estimate
+	bool result_live = false;
+	// Log entries the dock has not shown yet, oldest first; guarded by lock
+	std::vector<struct dock_entry> dock_pending;
+	// Set whenever anything the dock shows changes; the dock's refresh timer clears it
+	std::atomic<bool> dock_dirty{true};
 	double last_delay_ms;
 	float last_correlation;
 	bool last_delay_valid;
+
+	// Runs measurements, averages and monitor passes off the UI thread
+	struct task_pool pool;
+	// Pending or running work, guarded by lock.  Cancelling average_task stops an average between windows.
+	task_handle measure_task;
+	task_handle average_task;
+	task_handle monitor_task;
+	// Cancelling offline_task stops a file analysis between windows
+	task_handle offline_task;
+
 	bool average_in_progress;
-	bool average_stop;
-	bool average_thread_active;
-	pthread_t average_thread;
+	// Recording being analyzed, guarded by lock; empty when none is
+	std::string offline_path;
+	// Used only by the average task
+	struct average_state average;
+
+	bool monitor_active;
+	// Set by stop_monitor(); a monitor pass seeing it does not schedule the next one
+	bool monitor_stop;
+	struct monitor_state monitor;
 };
 
 static void update_dock_ui(audio_sync_data *dm);
+static void api_emit_result(struct audio_sync_data *dm);
 
-static size_t next_power_of_2(size_t n)
-{
-	size_t p = 1;
-	while (p < n)
-		p <<= 1;
-	return p;
-}
-
-static size_t ms_to_samples(uint32_t ms, uint32_t sample_rate)
-{
-	return (size_t)(((uint64_t)ms * sample_rate + 500) / 1000);
-}
-
-static void ring_write(float *buffer, size_t capacity, size_t *pos, size_t *count, const float *src, size_t frames)
+static void snapshot_targets(struct audio_sync_data *dm, struct target_list *list)
 {
-	for (size_t i = 0; i < frames; ++i) {
-		buffer[*pos] = src[i];
-		*pos = (*pos + 1) % capacity;
-		if (*count < capacity)
-			(*count)++;
-	}
+	pthread_mutex_lock(&dm->lock);
+	list->count = std::min<size_t>(dm->targets.size(), MAX_TARGETS);
+	for (size_t i = 0; i < list->count; ++i)
+		list->items[i] = dm->targets[i];
+	pthread_mutex_unlock(&dm->lock);
 }
 
 static bool has_recent_audio(uint64_t last_ns, uint64_t now_ns, uint64_t max_age_ns)
@@ -123,83 +409,62 @@ static bool has_recent_audio(uint64_t last_ns, uint64_t now_ns, uint64_t max_age
 	return (now_ns - last_ns) <= max_age_ns;
 }
 
-static const float *as_float_channel(const uint8_t *const *planes, enum audio_format format)
+// Planes a packet contributes for the given channel selection: the selected
+// plane alone, or every present plane for a downmix.  Returns how many were
+// stored in `out` (0 if the format is unsupported).
+static size_t capture_planes(const uint8_t *const *planes, enum audio_format format, size_t channels, int channel,
+			     const float **out)
 {
 	if (!planes)
-		return nullptr;
+		return 0;
 
-	if (format == AUDIO_FORMAT_FLOAT || format == AUDIO_FORMAT_FLOAT_PLANAR)
-		return (const float *)planes[0];
+	if (format == AUDIO_FORMAT_FLOAT) {
+		// Interleaved packets are analyzed as they are
+		out[0] = (const float *)planes[0];
+		return out[0] ? 1 : 0;
+	}
+	if (format != AUDIO_FORMAT_FLOAT_PLANAR)
+		return 0;
+
+	if (channel != CAPTURE_CHANNEL_MIX) {
+		const size_t plane = std::min<size_t>((size_t)channel, channels - 1);
+		out[0] = (const float *)planes[plane];
+		return out[0] ? 1 : 0;
+	}
 
-	return nullptr;
+	size_t count = 0;
+	for (size_t c = 0; c < channels; ++c) {
+		if (planes[c])
+			out[count++] = (const float *)planes[c];
+	}
+	return count;
 }
 
-static void design_bandpass_filter(float low_freq, float high_freq, uint32_t sample_rate,
-				   struct bandpass_coeffs *coeffs)
+// Channel selection for a source name; caller holds dm->lock
+static int source_channel(const struct audio_sync_data *dm, const std::string &name)
 {
-	// Design a second-order bandpass filter using biquad structure
-	// This implements a bandpass filter with center frequency and Q
-
-	const float center_freq = sqrtf(low_freq * high_freq);
-	const float bandwidth = high_freq - low_freq;
-	const float Q = center_freq / bandwidth;
-
-	const float w0 = 2.0f * (float)M_PI * center_freq / (float)sample_rate;
-	const float cos_w0 = cosf(w0);
-	const float sin_w0 = sinf(w0);
-	const float alpha = sin_w0 / (2.0f * Q);
-
-	const float b0_val = alpha;
-	const float b1_val = 0.0f;
-	const float b2_val = -alpha;
-	const float a0_val = 1.0f + alpha;
-	const float a1_val = -2.0f * cos_w0;
-	const float a2_val = 1.0f - alpha;
-
-	// Normalize coefficients
-	coeffs->b0 = b0_val / a0_val;
-	coeffs->b1 = b1_val / a0_val;
-	coeffs->b2 = b2_val / a0_val;
-	coeffs->a1 = a1_val / a0_val;
-	coeffs->a2 = a2_val / a0_val;
+	auto it = dm->source_channels.find(name);
+	return it != dm->source_channels.end() ? it->second : CAPTURE_CHANNEL_MIX;
 }
 
-static void apply_bandpass_filter(float *data, size_t samples, const struct bandpass_coeffs *coeffs)
+static bool capture_prefiltered(const struct capture_filter *cf)
 {
-	if (samples == 0)
-		return;
-
-	// Initialize filter state to zero for independent measurements
-	float x_prev1 = 0.0f;
-	float x_prev2 = 0.0f;
-	float y_prev1 = 0.0f;
-	float y_prev2 = 0.0f;
-
-	for (size_t i = 0; i < samples; ++i) {
-		const float x = data[i];
-
-		// Direct Form II transposed biquad filter
-		const float y = coeffs->b0 * x + coeffs->b1 * x_prev1 + coeffs->b2 * x_prev2 - coeffs->a1 * y_prev1 -
-				coeffs->a2 * y_prev2;
-
-		x_prev2 = x_prev1;
-		x_prev1 = x;
-		y_prev2 = y_prev1;
-		y_prev1 = y;
-
-		data[i] = y;
-	}
+	return cf->filtered.load(std::memory_order_acquire);
 }
 
-static void apply_hann_window(float *data, size_t samples)
+// Whether the window of `frames` ending at ring frame `end` has enough
+// speech-like audio to be worth correlating
+static bool window_has_voice(const struct capture_filter *cf, uint64_t end, size_t frames)
 {
-	if (samples <= 1)
-		return;
+	return voice_activity_share(&cf->vad, end - frames, frames) >= VAD_MIN_ACTIVE;
+}
 
-	for (size_t i = 0; i < samples; ++i) {
-		double w = 0.5 * (1.0 - cos(2.0 * M_PI * (double)i / (samples - 1.0)));
-		data[i] *= (float)w;
-	}
+static bool voice_gate_enabled(struct audio_sync_data *dm)
+{
+	pthread_mutex_lock(&dm->lock);
+	const bool gate = dm->voice_gate;
+	pthread_mutex_unlock(&dm->lock);
+	return gate;
 }
 
 static void frontend_save_cb(obs_data_t *settings, bool saving, void *private_data)
@@ -212,15 +477,42 @@ static void frontend_save_cb(obs_data_t *settings, bool saving, void *private_da
 
 	if (saving) {
 		obs_data_t *obj = obs_data_create();
+		obs_data_array_t *targets = obs_data_array_create();
 		pthread_mutex_lock(&dm->lock);
 		obs_data_set_string(obj, "ref_name", dm->ref_name.c_str());
-		obs_data_set_string(obj, "target_name", dm->target_name.c_str());
+		for (const std::string &name : dm->target_names) {
+			obs_data_t *item = obs_data_create();
+			obs_data_set_string(item, "name", name.c_str());
+			obs_data_array_push_back(targets, item);
+			obs_data_release(item);
+		}
+		obs_data_array_t *channels = obs_data_array_create();
+		for (const auto &entry : dm->source_channels) {
+			obs_data_t *item = obs_data_create();
+			obs_data_set_string(item, "name", entry.first.c_str());
+			obs_data_set_int(item, "channel", entry.second);
+			obs_data_array_push_back(channels, item);
+			obs_data_release(item);
+		}
+		obs_data_set_array(obj, "channels", channels);
+		obs_data_array_release(channels);
 		obs_data_set_int(obj, "window_ms", dm->window_ms);
 		obs_data_set_int(obj, "max_lag_ms", dm->max_lag_ms);
 		obs_data_set_double(obj, "corr_threshold", dm->corr_threshold);
 		obs_data_set_bool(obj, "debug_enabled", dm->debug_enabled);
+		obs_data_set_bool(obj, "coarse_search", dm->coarse_search);
+		obs_data_set_bool(obj, "adaptive_search", dm->adaptive_search);
+		obs_data_set_int(obj, "ring_format", dm->ring_format);
+		obs_data_set_int(obj, "taper", dm->taper);
+		obs_data_set_int(obj, "weighting", dm->weighting);
+		obs_data_set_bool(obj, "stream_filter", dm->stream_filter.load());
+		obs_data_set_double(obj, "drift_tolerance_ms", dm->drift_tolerance_ms);
+		obs_data_set_bool(obj, "auto_apply", dm->auto_apply);
+		obs_data_set_bool(obj, "voice_gate", dm->voice_gate);
 		pthread_mutex_unlock(&dm->lock);
 
+		obs_data_set_array(obj, "targets", targets);
+		obs_data_array_release(targets);
 		obs_data_set_obj(settings, key, obj);
 		obs_data_release(obj);
 		blog(LOG_INFO, "[ASM] saved frontend settings");
@@ -229,9 +521,48 @@ static void frontend_save_cb(obs_data_t *settings, bool saving, void *private_da
 		if (!obj)
 			return;
 
+		std::vector<std::string> target_names;
+		obs_data_array_t *targets = obs_data_get_array(obj, "targets");
+		if (targets) {
+			const size_t count = obs_data_array_count(targets);
+			for (size_t i = 0; i < count && target_names.size() < MAX_TARGETS; ++i) {
+				obs_data_t *item = obs_data_array_item(targets, i);
+				const char *name = obs_data_get_string(item, "name");
+				if (name && *name)
+					target_names.push_back(name);
+				obs_data_release(item);
+			}
+			obs_data_array_release(targets);
+		} else {
+			// Settings written before multi-target support
+			const char *name = obs_data_get_string(obj, "target_name");
+			if (name && *name)
+				target_names.push_back(name);
+		}
+
+		std::map<std::string, int> source_channels;
+		obs_data_array_t *channels = obs_data_get_array(obj, "channels");
+		if (channels) {
+			const size_t count = obs_data_array_count(channels);
+			for (size_t i = 0; i < count; ++i) {
+				obs_data_t *item = obs_data_array_item(channels, i);
+				const char *name = obs_data_get_string(item, "name");
+				const int channel = (int)obs_data_get_int(item, "channel");
+				if (name && *name && channel >= CAPTURE_CHANNEL_MIX && channel < (int)dm->channels)
+					source_channels[name] = channel;
+				obs_data_release(item);
+			}
+			obs_data_array_release(channels);
+		}
+
+		obs_data_set_default_bool(obj, "coarse_search", true);
+		obs_data_set_default_double(obj, "drift_tolerance_ms", DEFAULT_DRIFT_TOLERANCE_MS);
+		obs_data_set_default_bool(obj, "voice_gate", true);
+
 		pthread_mutex_lock(&dm->lock);
 		dm->ref_name = obs_data_get_string(obj, "ref_name");
-		dm->target_name = obs_data_get_string(obj, "target_name");
+		dm->target_names = target_names;
+		dm->source_channels = source_channels;
 		uint32_t win = (uint32_t)obs_data_get_int(obj, "window_ms");
 		uint32_t lag = (uint32_t)obs_data_get_int(obj, "max_lag_ms");
 		double corr = obs_data_get_double(obj, "corr_threshold");
@@ -239,188 +570,354 @@ static void frontend_save_cb(obs_data_t *settings, bool saving, void *private_da
 		dm->max_lag_ms = lag ? lag : 500;
 		dm->corr_threshold = (float)(corr > 0.0 ? corr : MIN_CORR_THRESHOLD);
 		dm->debug_enabled = obs_data_get_bool(obj, "debug_enabled");
+		dm->coarse_search = obs_data_get_bool(obj, "coarse_search");
+		dm->adaptive_search = obs_data_get_bool(obj, "adaptive_search");
+		dm->taper = taper_from_int(obs_data_get_int(obj, "taper"));
+		dm->weighting = spectral_weighting_from_int(obs_data_get_int(obj, "weighting"));
+		dm->stream_filter.store(obs_data_get_bool(obj, "stream_filter"));
+		dm->drift_tolerance_ms = std::max(obs_data_get_double(obj, "drift_tolerance_ms"), 0.1);
+		dm->auto_apply = obs_data_get_bool(obj, "auto_apply");
+		dm->voice_gate = obs_data_get_bool(obj, "voice_gate");
 		pthread_mutex_unlock(&dm->lock);
 
+		set_ring_format(dm, sample_format_from_int(obs_data_get_int(obj, "ring_format")));
 		obs_data_release(obj);
-		connect_ref(dm);
-		connect_target(dm);
+		connect_sources(dm);
 		update_dock_ui(dm);
 		blog(LOG_INFO, "[ASM] loaded frontend settings");
 	}
 }
 
-static bool copy_recent(struct audio_sync_data *dm, float **out_ref, float **out_tgt, size_t *out_frames)
-{
-	float *ref = nullptr;
-	float *tgt = nullptr;
-
-	pthread_mutex_lock(&dm->lock);
-
-	size_t available = dm->ref_count < dm->tgt_count ? dm->ref_count : dm->tgt_count;
-	const size_t window_frames = ms_to_samples(dm->window_ms, dm->sample_rate);
-	const size_t frames = available < window_frames ? available : window_frames;
-
-	if (frames < 1024) {
-		pthread_mutex_unlock(&dm->lock);
-		return false;
-	}
-
-	ref = static_cast<float *>(bmalloc(frames * sizeof(float)));
-	tgt = static_cast<float *>(bmalloc(frames * sizeof(float)));
-	if (!ref || !tgt) {
-		pthread_mutex_unlock(&dm->lock);
-		bfree(ref);
-		bfree(tgt);
-		return false;
-	}
-
-	const size_t ref_start = (dm->ref_pos + dm->capacity - frames) % dm->capacity;
-	const size_t tgt_start = (dm->tgt_pos + dm->capacity - frames) % dm->capacity;
+// One target's share of a measurement, run on its own thread when there are several
+struct target_job {
+	struct audio_sync_data *dm;
+	const struct correlation_workspace *ref_ws;
+	struct sync_target *target;
+	struct target_workspace *tw;
+	sync_ring_view view;
+	// Target window already filtered and copied out of the ring; when null it is read from `view`
+	const float *samples;
+	int max_lag;
+	const struct sync_engine_settings *settings;
+	// capture_prefiltered() of the target ring, sampled before the view was taken
+	bool prefiltered;
+	measurement_sample *out;
+};
 
-	for (size_t i = 0; i < frames; ++i) {
-		ref[i] = dm->ref_buffer[(ref_start + i) % dm->capacity];
-		tgt[i] = dm->tgt_buffer[(tgt_start + i) % dm->capacity];
+static void correlate_target(struct target_job *job)
+{
+	struct audio_sync_data *dm = job->dm;
+	const struct correlation_workspace *ws = job->ref_ws;
+	struct target_workspace *tw = job->tw;
+	const uint64_t copy_ns = sync_stats_now_ns();
+
+	prepare_target_workspace(tw, ws);
+	if (job->samples) {
+		std::copy(job->samples, job->samples + ws->frames, tw->tgt.data());
+	} else {
+		filter_ring_view(&job->view, tw->tgt.data(), &dm->engine.bp_coeffs, job->prefiltered);
+		if (!sync_ring_view_valid(&job->target->ring, &job->view) ||
+		    capture_prefiltered(&job->target->capture) != job->prefiltered) {
+			job->out->status = "Target buffer overrun";
+			return;
+		}
 	}
+	sync_stats_since(&dm->stats, SYNC_STAT_COPY, copy_ns);
 
-	// Apply bandpass filter instead of pre-emphasis
-	apply_bandpass_filter(ref, frames, &dm->bp_coeffs);
-	apply_bandpass_filter(tgt, frames, &dm->bp_coeffs);
+	correlate_window(&dm->engine, job->settings, ws, tw, job->max_lag, job->prefiltered,
+			 target_name(job->target)->c_str(), job->out);
+}
 
-	apply_hann_window(ref, frames);
-	apply_hann_window(tgt, frames);
+static void correlate_target_task(void *param)
+{
+	correlate_target(static_cast<struct target_job *>(param));
+}
 
-	*out_ref = ref;
-	*out_tgt = tgt;
-	*out_frames = frames;
+static struct sync_engine_settings read_measure_params(struct audio_sync_data *dm)
+{
+	struct sync_engine_settings params;
+	pthread_mutex_lock(&dm->lock);
+	params.window_ms = dm->window_ms;
+	params.max_lag_ms = dm->max_lag_ms;
+	params.corr_threshold = dm->corr_threshold;
+	params.coarse_search = dm->coarse_search;
+	params.taper = dm->taper;
+	params.weighting = dm->weighting;
+	params.debug = dm->debug_enabled;
 	pthread_mutex_unlock(&dm->lock);
-
-	return true;
+	return params;
 }
 
-static bool estimate_delay(struct audio_sync_data *dm, double *delay_ms_out, double *corr_out)
+// Index just past the newest frame of each ring that was captured no later than
+// the newest instant all of them have audio for: ends[0] for the reference,
+// ends[1 + i] for targets[i].  Windows ending there line up on the capture
+// timestamps, however the callbacks happened to be scheduled.  Until every ring
+// has timestamps, or when a ring's timeline is further off than half its
+// capacity (a source with a broken clock), the rings' newest frames are used,
+// taking them to have been captured together.
+static void aligned_ends(const struct audio_sync_data *dm, struct sync_target *const *targets, size_t count,
+			 uint64_t *ends)
 {
-	float *ref = nullptr;
-	float *tgt = nullptr;
-	size_t frames = 0;
-
-	if (!copy_recent(dm, &ref, &tgt, &frames)) {
-		blog(LOG_INFO, "[ADM]  copy_recent failed");
-		return false;
+	const uint32_t rate = dm->engine.sample_rate;
+	const sync_ring *rings[MAX_TARGETS + 1];
+	rings[0] = &dm->ref_ring;
+	for (size_t i = 0; i < count; ++i)
+		rings[1 + i] = &targets[i]->ring;
+
+	bool timed = true;
+	int64_t end_ns = INT64_MAX;
+	for (size_t i = 0; i <= count; ++i) {
+		ends[i] = sync_ring_end(rings[i]);
+		timed = timed && sync_ring_has_time(rings[i]);
+		if (timed)
+			end_ns = std::min(end_ns, sync_ring_time_at(rings[i], ends[i], rate));
 	}
+	if (!timed)
+		return;
 
-	if (dm->debug_enabled) {
-		blog(LOG_INFO, "[ADM DEBUG] frames=%zu max_lag=%d", frames,
-		     (int)ms_to_samples(dm->max_lag_ms, dm->sample_rate));
+	uint64_t aligned[MAX_TARGETS + 1];
+	for (size_t i = 0; i <= count; ++i) {
+		aligned[i] = std::min(ends[i], sync_ring_index_at(rings[i], end_ns, rate));
+		if (ends[i] - aligned[i] > rings[i]->capacity / 2)
+			return;
 	}
+	std::copy(aligned, aligned + count + 1, ends);
+}
 
-	int max_lag = (int)ms_to_samples(dm->max_lag_ms, dm->sample_rate);
-	max_lag = std::min(max_lag, (int)frames - 1);
+// Correlates every given target against one reference snapshot.  The reference
+// is filtered, windowed and transformed once; targets then run in parallel on
+// the pool, each with its own scratch, sharing the reference spectrum and FFT plan.
+// A target with a narrowed adaptive search has its window moved by its known
+// delay and only searches the lags around it (see adaptive-search.h).
+static bool estimate_delays_once(struct audio_sync_data *dm, const struct sync_engine_settings *params,
+				 struct sync_target *const *targets, measurement_sample *const *outs, size_t count)
+{
+	struct correlation_workspace *ws = &dm->workspace;
+	if (count == 0)
+		return false;
 
-	auto compute_mean = [](const float *data, size_t count) {
-		if (!data || count == 0)
-			return 0.0f;
-		double sum = 0.0;
-		for (size_t i = 0; i < count; ++i)
-			sum += data[i];
-		return (float)(sum / (double)count);
-	};
+	const uint64_t start_ns = sync_stats_now_ns();
+	const uint32_t rate = dm->engine.sample_rate;
 
-	const float ref_mean = compute_mean(ref, frames);
-	const float tgt_mean = compute_mean(tgt, frames);
-	for (size_t i = 0; i < frames; ++i) {
-		ref[i] -= ref_mean;
-		tgt[i] -= tgt_mean;
+	// Each window ends back[k] frames before its aligned end, so the target
+	// window trails the reference one by the target's known delay
+	struct adaptive_search search[MAX_TARGETS];
+	int64_t shift[MAX_TARGETS];
+	bool all_narrowed = true;
+	int64_t ref_back = 0;
+	pthread_mutex_lock(&dm->lock);
+	const bool adaptive = dm->adaptive_search;
+	for (size_t i = 0; i < count; ++i) {
+		if (!adaptive)
+			adaptive_search_reset(&targets[i]->adaptive);
+		search[i] = targets[i]->adaptive;
+		shift[i] = search[i].narrowed ? llround(search[i].center_ms * rate / 1000.0) : 0;
+		all_narrowed = all_narrowed && search[i].narrowed;
+		ref_back = std::max(ref_back, shift[i]);
 	}
+	pthread_mutex_unlock(&dm->lock);
 
-	std::vector<double> ref_prefix(frames + 1, 0.0);
-	std::vector<double> tgt_prefix(frames + 1, 0.0);
-	for (size_t i = 0; i < frames; ++i) {
-		ref_prefix[i + 1] = ref_prefix[i] + (double)ref[i] * (double)ref[i];
-		tgt_prefix[i + 1] = tgt_prefix[i] + (double)tgt[i] * (double)tgt[i];
+	uint64_t back[MAX_TARGETS + 1];
+	back[0] = (uint64_t)ref_back;
+	size_t available = sync_ring_available(&dm->ref_ring);
+	available = available > back[0] ? available - back[0] : 0;
+	for (size_t i = 0; i < count; ++i) {
+		back[1 + i] = (uint64_t)(ref_back - shift[i]);
+		const size_t target_available = sync_ring_available(&targets[i]->ring);
+		available = std::min(available, target_available > back[1 + i] ? target_available - back[1 + i] : 0);
 	}
+	const uint32_t window_ms = all_narrowed ? std::min(params->window_ms, ADAPTIVE_WINDOW_MS) : params->window_ms;
+	const size_t window_frames = ms_to_samples(window_ms, rate);
+	const size_t frames = available < window_frames ? available : window_frames;
 
-	const size_t nfft = next_power_of_2(frames * 2);
-	const size_t spectrum_len = nfft / 2 + 1;
-
-	std::vector<float> ref_padded(nfft, 0.0f);
-	std::vector<float> tgt_padded(nfft, 0.0f);
-	std::copy(ref, ref + frames, ref_padded.begin());
-	std::copy(tgt, tgt + frames, tgt_padded.begin());
-
-	std::vector<std::complex<float>> ref_fft(spectrum_len);
-	std::vector<std::complex<float>> tgt_fft(spectrum_len);
-	std::vector<std::complex<float>> cross_spectrum(spectrum_len);
-	std::vector<float> corr_time(nfft, 0.0f);
+	if (frames < 1024) {
+		blog(LOG_INFO, "[ADM]  sync_ring_available: %zu frames in every ring, need 1024", frames);
+		for (size_t i = 0; i < count; ++i)
+			outs[i]->status = "Buffers too small";
+		return false;
+	}
 
-	const pocketfft::shape_t shape{nfft};
-	const pocketfft::stride_t stride_real{(ptrdiff_t)sizeof(float)};
-	const pocketfft::stride_t stride_complex{(ptrdiff_t)sizeof(std::complex<float>)};
+	// Measure and Avg can run concurrently; they share one workspace
+	const uint64_t wait_ns = sync_stats_now_ns();
+	pthread_mutex_lock(&dm->workspace_lock);
+	const uint64_t copy_ns = sync_stats_since(&dm->stats, SYNC_STAT_LOCK_WAIT, wait_ns);
+	prepare_workspace(ws, frames, coarse_decimation(dm->engine.sample_rate, params->coarse_search));
+	prepare_taper(ws, params->taper);
 
-	pocketfft::r2c(shape, stride_real, stride_complex, 0, true, ref_padded.data(), ref_fft.data(), 1.0f);
-	pocketfft::r2c(shape, stride_real, stride_complex, 0, true, tgt_padded.data(), tgt_fft.data(), 1.0f);
+	const int max_lag = sync_engine_max_lag(&dm->engine, params->max_lag_ms, frames);
 
-	for (size_t i = 0; i < spectrum_len; ++i)
-		cross_spectrum[i] = ref_fft[i] * std::conj(tgt_fft[i]);
+	if (params->debug) {
+		blog(LOG_INFO, "[ADM DEBUG] frames=%zu decimation=%zu nfft=%zu max_lag=%d targets=%zu taper=%s weighting=%s",
+		     frames, ws->decimation, ws->nfft, max_lag, count, taper_name(params->taper),
+		     spectral_weighting_name(params->weighting));
+	}
 
-	const float ifft_scale = 1.0f / (float)nfft;
-	pocketfft::c2r(shape, stride_complex, stride_real, 0, true, cross_spectrum.data(), corr_time.data(),
-		       ifft_scale);
+	// Reading never blocks the audio thread and no lock is held during the DSP.
+	// Every window ends at the same capture time (see aligned_ends()).
+	// The bandpass filter (used instead of pre-emphasis) reads the ring spans
+	// directly; retry if the producer lapped the reference while we were reading.
+	// A ring's filtered flag is sampled before its view and checked again after
+	// the copy, so a mode switch in the capture callback is caught like an overrun.
+	struct target_job jobs[MAX_TARGETS];
+	bool copied = false;
+	bool ref_prefiltered = false;
+	uint64_t ends[MAX_TARGETS + 1];
+	for (int attempt = 0; attempt < 4 && !copied; ++attempt) {
+		aligned_ends(dm, targets, count, ends);
+		bool behind = true;
+		for (size_t k = 0; k <= count && behind; ++k) {
+			behind = ends[k] >= back[k];
+			ends[k] -= behind ? back[k] : 0;
+		}
+		if (!behind)
+			break;
+		sync_ring_view ref_view;
+		ref_prefiltered = capture_prefiltered(&dm->ref_capture);
+		if (ends[0] < frames || !sync_ring_peek_at(&dm->ref_ring, ends[0] - frames, frames, &ref_view))
+			break;
 
-	double best_corr = -1.0;
-	int best_lag = 0;
-	int lag_count = 0;
+		bool peeked = true;
+		for (size_t i = 0; i < count && peeked; ++i) {
+			const bool prefiltered = capture_prefiltered(&targets[i]->capture);
+			const int radius = (int)std::ceil(search[i].radius_ms * rate / 1000.0);
+			const int lag = search[i].narrowed ? std::min(max_lag, radius) : max_lag;
+			jobs[i] = {dm, ws, targets[i], &targets[i]->workspace, {}, nullptr, lag, params,
+				   prefiltered, outs[i]};
+			peeked = ends[1 + i] >= frames &&
+				 sync_ring_peek_at(&targets[i]->ring, ends[1 + i] - frames, frames, &jobs[i].view);
+		}
+		if (!peeked)
+			break;
 
-	for (int lag = -max_lag; lag <= max_lag; ++lag) {
-		const int abs_lag = std::abs(lag);
-		const size_t overlap = frames - (size_t)abs_lag;
-		if (overlap < 1024)
-			continue;
+		filter_ring_view(&ref_view, ws->ref.data(), &dm->engine.bp_coeffs, ref_prefiltered);
+		copied = sync_ring_view_valid(&dm->ref_ring, &ref_view) &&
+			 capture_prefiltered(&dm->ref_capture) == ref_prefiltered;
+	}
 
-		double energy_ref = 0.0;
-		double energy_tgt = 0.0;
+	if (!copied) {
+		pthread_mutex_unlock(&dm->workspace_lock);
+		blog(LOG_INFO, "[ADM]  sync_ring_peek_at view out of range or lapped during the read");
+		for (size_t i = 0; i < count; ++i)
+			outs[i]->status = "Buffers too small";
+		return false;
+	}
 
-		if (lag >= 0) {
-			energy_ref = ref_prefix[overlap] - ref_prefix[0];
-			energy_tgt = tgt_prefix[(size_t)lag + overlap] - tgt_prefix[(size_t)lag];
-		} else {
-			const size_t start = (size_t)abs_lag;
-			energy_ref = ref_prefix[start + overlap] - ref_prefix[start];
-			energy_tgt = tgt_prefix[overlap] - tgt_prefix[0];
+	sync_stats_since(&dm->stats, SYNC_STAT_COPY, copy_ns);
+	if (params->debug) {
+		for (size_t i = 0; i < count; ++i) {
+			blog(LOG_INFO, "[ADM DEBUG] %s window ends %lld frames before its newest, reference %lld",
+			     target_name(targets[i])->c_str(),
+			     (long long)(sync_ring_end(&targets[i]->ring) - ends[1 + i]),
+			     (long long)(sync_ring_end(&dm->ref_ring) - ends[0]));
 		}
+	}
 
-		double denom = sqrt(energy_ref * energy_tgt);
-		if (denom < 1e-8)
-			continue;
+	// Windows without speech-like audio on both sides would only burn FFTs on a failed result
+	const bool gate = voice_gate_enabled(dm);
+	const bool ref_voice = !gate || window_has_voice(&dm->ref_capture, ends[0], frames);
+	void *job_params[MAX_TARGETS];
+	bool ran[MAX_TARGETS];
+	size_t active = 0;
+	for (size_t i = 0; i < count; ++i) {
+		ran[i] = ref_voice && (!gate || window_has_voice(&targets[i]->capture, ends[1 + i], frames));
+		if (ran[i])
+			job_params[active++] = &jobs[i];
+		else
+			outs[i]->status = ref_voice ? "No speech on target" : "No speech on reference";
+	}
+	if (params->debug && active < count)
+		blog(LOG_INFO, "[ADM DEBUG] VAD: %zu of %zu targets gated", count - active, count);
 
-		const size_t idx = lag >= 0 ? (size_t)lag : nfft - (size_t)abs_lag;
-		double corr = corr_time[idx] / denom;
-		lag_count++;
+	if (active) {
+		prepare_reference(&dm->engine, ws, ref_prefiltered, params->weighting);
+		task_pool_parallel(&dm->pool, &ws->tasks, correlate_target_task, job_params, active);
+	}
 
-		if (corr > best_corr) {
-			best_corr = corr;
-			best_lag = lag;
+	pthread_mutex_unlock(&dm->workspace_lock);
+	sync_stats_since(&dm->stats, SYNC_STAT_MEASURE, start_ns);
+
+	// Results of a moved window are relative to the delay it was moved by
+	for (size_t i = 0; i < count; ++i) {
+		if (!ran[i] || !search[i].narrowed)
+			continue;
+		const double shift_ms = (double)shift[i] * 1000.0 / rate;
+		if (outs[i]->success)
+			outs[i]->delay_ms += shift_ms;
+		if (outs[i]->curve && outs[i]->curve->count) {
+			outs[i]->curve->first_ms += shift_ms;
+			outs[i]->curve->last_ms += shift_ms;
+			outs[i]->curve->peak_ms += shift_ms;
+		}
+		if (params->debug) {
+			blog(LOG_INFO, "[ADM DEBUG] adaptive '%s': center=%+.2f ms radius=%.2f ms",
+			     target_name(targets[i])->c_str(), search[i].center_ms, search[i].radius_ms);
 		}
 	}
 
-	bfree(ref);
-	bfree(tgt);
+	const double max_lag_ms = (double)max_lag * 1000.0 / rate;
+	pthread_mutex_lock(&dm->lock);
+	for (size_t i = 0; i < count && adaptive; ++i) {
+		if (ran[i]) {
+			adaptive_search_update(&targets[i]->adaptive, search[i].narrowed, outs[i]->success,
+					       outs[i]->delay_ms, outs[i]->interval_ms, max_lag_ms);
+		}
+	}
+	pthread_mutex_unlock(&dm->lock);
 
-	if (dm->debug_enabled) {
-		blog(LOG_INFO, "[ADM DEBUG] FINAL: best_corr=%.4f best_lag=%d lag_count=%d", best_corr, best_lag,
-		     lag_count);
+	for (size_t i = 0; i < count; ++i) {
+		if (outs[i]->success)
+			return true;
 	}
+	return false;
+}
 
-	if (best_corr < dm->corr_threshold) {
-		blog(LOG_INFO, "[ADM]  CORRELATION TOO LOW: %.4f < %.2f", best_corr, dm->corr_threshold);
-		return false;
+// estimate_delays_once(), then a full-range pass for every target whose
+// narrowed search just failed, so a jump in the delay costs no extra round
+static bool estimate_delays(struct audio_sync_data *dm, const struct sync_engine_settings *params,
+			    struct sync_target *const *targets, measurement_sample *const *outs, size_t count)
+{
+	bool narrowed[MAX_TARGETS];
+	pthread_mutex_lock(&dm->lock);
+	for (size_t i = 0; i < count; ++i)
+		narrowed[i] = dm->adaptive_search && targets[i]->adaptive.narrowed;
+	pthread_mutex_unlock(&dm->lock);
+
+	bool any = estimate_delays_once(dm, params, targets, outs, count);
+
+	struct sync_target *retry[MAX_TARGETS];
+	measurement_sample *retry_outs[MAX_TARGETS];
+	size_t retries = 0;
+	pthread_mutex_lock(&dm->lock);
+	for (size_t i = 0; i < count; ++i) {
+		if (narrowed[i] && !targets[i]->adaptive.narrowed) {
+			retry[retries] = targets[i];
+			retry_outs[retries++] = outs[i];
+		}
+	}
+	pthread_mutex_unlock(&dm->lock);
+	if (!retries)
+		return any;
+
+	if (params->debug)
+		blog(LOG_INFO, "[ADM DEBUG] adaptive: %zu targets back to the full range", retries);
+	for (size_t i = 0; i < retries; ++i) {
+		struct sync_curve *curve = retry_outs[i]->curve;
+		*retry_outs[i] = measurement_sample();
+		retry_outs[i]->curve = curve;
 	}
+	estimate_delays_once(dm, params, retry, retry_outs, retries);
 
-	*delay_ms_out = ((double)best_lag * 1000.0) / (double)dm->sample_rate;
-	*corr_out = best_corr;
-	return true;
+	any = false;
+	for (size_t i = 0; i < count; ++i)
+		any = any || outs[i]->success;
+	return any;
 }
 
-static void set_result(struct audio_sync_data *dm, const char *delay_text, const char *notes_text, bool valid)
+// Stores the headline and queues the notes for the dock's log.  A live result
+// replaces a live one the dock has not picked up yet, so a fast producer only
+// ever has one entry waiting.
+static void post_result(struct audio_sync_data *dm, const char *delay_text, const char *notes_text, bool valid,
+			bool live)
 {
 	if (!dm || !delay_text)
 		return;
@@ -433,423 +930,2669 @@ static void set_result(struct audio_sync_data *dm, const char *delay_text, const
 	pthread_mutex_lock(&dm->lock);
 	dm->last_delay_text = delay_text;
 	dm->last_time_text = timestamp;
-	dm->last_notes = notes_text ? notes_text : "";
 	dm->last_delay_valid = valid;
+	dm->last_notes_text = notes_text ? notes_text : "";
+	dm->result_seq++;
+	dm->result_live = live;
+	if (notes_text && *notes_text) {
+		std::vector<struct dock_entry> &pending = dm->dock_pending;
+		if (live && !pending.empty() && pending.back().live) {
+			pending.back().time = timestamp;
+			pending.back().notes = notes_text;
+		} else {
+			if (pending.size() == DOCK_PENDING_MAX)
+				pending.erase(pending.begin());
+			pending.push_back({timestamp, notes_text, live});
+		}
+	}
 	pthread_mutex_unlock(&dm->lock);
 
 	update_dock_ui(dm);
+	// The monitor's running results would flood scripted clients; they read them with GetLastResult
+	if (!live)
+		api_emit_result(dm);
 }
 
-static void capture_target(void *param, obs_source_t *source, const struct audio_data *audio, bool muted)
+static void set_result(struct audio_sync_data *dm, const char *delay_text, const char *notes_text, bool valid)
 {
-	UNUSED_PARAMETER(source);
-	UNUSED_PARAMETER(muted);
-
-	auto *dm = static_cast<audio_sync_data *>(param);
-	if (!dm)
-		return;
+	post_result(dm, delay_text, notes_text, valid, false);
+}
 
-	const float *samples = as_float_channel((const uint8_t *const *)audio->data, dm->audio_format);
-	if (!samples || audio->frames == 0)
-		return;
+// Writes every stage histogram and the FFT size counts to `path`
+static bool save_stats(struct audio_sync_data *dm, const char *path)
+{
+	FILE *f = os_fopen(path, "w");
+	if (!f) {
+		blog(LOG_WARNING, "[ADM] Could not write statistics to %s", path);
+		return false;
+	}
 
 	pthread_mutex_lock(&dm->lock);
-	ring_write(dm->tgt_buffer, dm->capacity, &dm->tgt_pos, &dm->tgt_count, samples, audio->frames);
-	dm->last_tgt_ns = os_gettime_ns();
+	const uint32_t window_ms = dm->window_ms;
+	const uint32_t max_lag_ms = dm->max_lag_ms;
+	const size_t targets = dm->targets.size();
 	pthread_mutex_unlock(&dm->lock);
+
+	const std::string text = sync_stats_format(&dm->stats, true);
+	fprintf(f, "Audio Sync Analyzer statistics\nsample_rate=%u window_ms=%u max_lag_ms=%u targets=%zu\n%s\n",
+		dm->engine.sample_rate, window_ms, max_lag_ms, targets, text.c_str());
+	fclose(f);
+	blog(LOG_INFO, "[ADM] Statistics written to %s", path);
+	return true;
 }
 
-static void capture_ref(void *param, obs_source_t *source, const struct audio_data *audio, bool muted)
+static std::string describe_result(const std::string &name, const measurement_sample &s)
 {
-	UNUSED_PARAMETER(source);
-	UNUSED_PARAMETER(muted);
-
-	auto *dm = static_cast<audio_sync_data *>(param);
-	if (!dm)
-		return;
+	const char *target = !name.empty() ? name.c_str() : "<target>";
+	char line[256];
+
+	if (!s.success)
+		snprintf(line, sizeof(line), "Target '%s': %s", target,
+			 s.status.empty() ? "no result" : s.status.c_str());
+	else if (s.delay_ms > 0)
+		snprintf(line, sizeof(line), "Target '%s' lags reference by %.2f ms ±%.2f (corr=%.2f)", target,
+			 s.delay_ms, s.interval_ms, s.correlation);
+	else if (s.delay_ms < 0)
+		snprintf(line, sizeof(line), "Target '%s' leads reference by %.2f ms ±%.2f (corr=%.2f)", target,
+			 fabs(s.delay_ms), s.interval_ms, s.correlation);
+	else
+		snprintf(line, sizeof(line), "Target '%s' is aligned with reference ±%.2f ms (corr=%.2f)", target,
+			 s.interval_ms, s.correlation);
+
+	return line;
+}
 
-	const float *samples = as_float_channel((const uint8_t *const *)audio->data, dm->audio_format);
-	if (!samples || audio->frames == 0)
-		return;
+static void append_duration(std::string *out, double seconds)
+{
+	char buffer[32];
+	if (seconds < 60.0)
+		snprintf(buffer, sizeof(buffer), "under a minute");
+	else if (seconds < 3600.0)
+		snprintf(buffer, sizeof(buffer), "%.0f min", seconds / 60.0);
+	else
+		snprintf(buffer, sizeof(buffer), "%.1f h", seconds / 3600.0);
+	*out += buffer;
+}
 
-	pthread_mutex_lock(&dm->lock);
-	ring_write(dm->ref_buffer, dm->capacity, &dm->ref_pos, &dm->ref_count, samples, audio->frames);
-	dm->last_ref_ns = os_gettime_ns();
-	pthread_mutex_unlock(&dm->lock);
+// Skew of the target's clock and, from the offsets applied to both sources,
+// how long until the fitted delay leaves the tolerance.  Caller holds dm->lock.
+static std::string describe_drift(const struct audio_sync_data *dm, const sync_target *t, double now_s)
+{
+	struct drift_fit fit;
+	if (!drift_estimate(&t->drift, now_s, &fit))
+		return std::string();
+
+	char line[192];
+	snprintf(line, sizeof(line), "  drift %+.1f ±%.1f ppm (%+.2f ms/h) over ", fit.ppm, fit.ppm_interval,
+		 fit.ppm * 3.6);
+	std::string text = line;
+	append_duration(&text, fit.span_s);
+
+	// Delaying the reference and advancing the target both compensate a lagging target
+	const int64_t ref_offset = dm->ref ? obs_source_get_sync_offset(dm->ref) : 0;
+	const int64_t tgt_offset = t->source ? obs_source_get_sync_offset(t->source) : 0;
+	const double compensated_ms = (double)(ref_offset - tgt_offset) / 1e6;
+	const double due_s = drift_time_to_tolerance(&fit, compensated_ms, dm->drift_tolerance_ms);
+
+	if (due_s == 0.0) {
+		snprintf(line, sizeof(line), "; re-apply now, %.1f ms off", fit.delay_ms - compensated_ms);
+		text += line;
+	} else if (std::fabs(fit.ppm) <= fit.ppm_interval || std::isinf(due_s)) {
+		text += "; no significant drift";
+	} else {
+		text += "; re-apply in ";
+		append_duration(&text, due_s);
+	}
+	return text;
 }
 
-static void connect_ref(struct audio_sync_data *dm)
+// Stores per-target results and shows the selected target's result as the
+// headline.  `live` results come continuously and replace each other in the log.
+static void publish_results(struct audio_sync_data *dm, const struct target_list *list,
+			    const measurement_sample *samples, const char *header, bool live)
 {
-	if (dm->ref && dm->ref_name == dm->connected_ref) {
-		return;
+	std::string notes = header ? header : "";
+	std::string headline = "---";
+	bool valid = false;
+	const double now_s = (double)os_gettime_ns() / 1e9;
+
+	pthread_mutex_lock(&dm->lock);
+	const size_t selected = list->count ? std::min(dm->selected_target, list->count - 1) : 0;
+	for (size_t i = 0; i < list->count; ++i) {
+		sync_target *t = list->items[i].get();
+		const measurement_sample &s = samples[i];
+
+		t->valid = s.success;
+		t->status = s.status;
+		t->correlation = (float)s.correlation;
+		if (s.success) {
+			char buffer[64];
+			snprintf(buffer, sizeof(buffer), "%+7.2f ms", s.delay_ms);
+			t->delay_text = buffer;
+			t->delay_ms = s.delay_ms;
+			t->interval_ms = s.interval_ms;
+			drift_add(&t->drift, now_s, s.delay_ms, s.interval_ms);
+		} else {
+			t->delay_text = "---";
+		}
+		if (s.curve && s.curve->count)
+			t->curve = *s.curve;
+		if (s.success || s.correlation > 0.0)
+			sync_history_add(&t->history, now_s, s.success, s.delay_ms, s.correlation);
+
+		if (i == selected) {
+			headline = t->delay_text;
+			valid = s.success;
+			dm->last_correlation = (float)s.correlation;
+			if (s.success)
+				dm->last_delay_ms = s.delay_ms;
+		}
+
+		if (!notes.empty())
+			notes += "\n";
+		notes += describe_result(*target_name(t), s);
+		const std::string drift = describe_drift(dm, t, now_s);
+		if (!drift.empty())
+			notes += "\n" + drift;
 	}
-	if (dm->ref_name.empty())
-		return;
-	if (dm->debug_enabled) {
-		blog(LOG_INFO, "[ADM TRACE] Connect Ref");
+	// The last few adjustments while auto apply is on
+	if (dm->auto_apply && !dm->auto_apply_events.empty()) {
+		notes += "\nAuto applied:";
+		const size_t shown = std::min<size_t>(dm->auto_apply_events.size(), 3);
+		for (size_t i = dm->auto_apply_events.size() - shown; i < dm->auto_apply_events.size(); ++i)
+			notes += "\n  " + dm->auto_apply_events[i];
 	}
+	const bool debug = dm->debug_enabled;
+	pthread_mutex_unlock(&dm->lock);
 
-	if (dm->ref) {
-		obs_source_remove_audio_capture_callback(dm->ref, capture_ref, dm);
-		obs_source_release(dm->ref);
-		dm->ref = nullptr;
-		dm->ref_count = 0;
-		dm->ref_pos = 0;
-		dm->last_ref_ns = 0;
-	}
+	if (debug)
+		notes += "\n\n" + sync_stats_format(&dm->stats, false);
 
-	obs_source_t *src = obs_get_source_by_name(dm->ref_name.c_str());
-	if (!src) {
-		blog(LOG_INFO, "[ADM] Ref '%s' not yet available", dm->ref_name.c_str());
-		return;
-	}
+	post_result(dm, headline.c_str(), notes.c_str(), valid, live);
+}
 
-	dm->ref = src;
-	dm->connected_ref = dm->ref_name;
-	obs_source_add_audio_capture_callback(dm->ref, capture_ref, dm);
+// Capture time of a packet on the os_gettime_ns() timeline every source shares.
+// Like OBS, a timestamp within CAPTURE_MAX_TS_VAR_NS of now is used directly;
+// one from a device clock is shifted by the difference seen on its first packet,
+// re-measured whenever the device clock jumps.
+static int64_t capture_time(struct capture_filter *cf, uint64_t timestamp, uint64_t now_ns)
+{
+	const int64_t ts = (int64_t)timestamp;
+	const int64_t now = (int64_t)now_ns;
+	int64_t adjust = cf->timing_adjust_ns.load(std::memory_order_relaxed);
+	if (llabs(ts - now) < CAPTURE_MAX_TS_VAR_NS) {
+		adjust = 0;
+		cf->timing_adjust_ns.store(adjust, std::memory_order_relaxed);
+		cf->timing_set.store(true, std::memory_order_relaxed);
+	} else if (!cf->timing_set.load(std::memory_order_relaxed) ||
+		   llabs(ts + adjust - now) >= CAPTURE_MAX_TS_VAR_NS) {
+		adjust = now - ts;
+		cf->timing_adjust_ns.store(adjust, std::memory_order_relaxed);
+		cf->timing_set.store(true, std::memory_order_relaxed);
+	}
+	return ts + adjust;
 }
 
-static void connect_target(struct audio_sync_data *dm)
+// Writes silence for the frames between the end of an adopted history and the
+// first packet after it, so that packet lands where its timestamp puts it.  A
+// gap the ring cannot hold drops the history instead.
+static void capture_fill_gap(struct audio_sync_data *dm, sync_ring *ring, struct capture_filter *cf,
+			     int64_t time_ns, uint64_t now_ns)
 {
-	if (dm->target && dm->connected_target == dm->target_name) {
-		// nothing has changed, ignore
+	if (!sync_ring_has_time(ring))
 		return;
-	}
-	if (dm->target_name.empty())
+	const uint32_t rate = dm->engine.sample_rate;
+	const int64_t gap = sync_ns_to_frames(time_ns - sync_ring_time_at(ring, sync_ring_end(ring), rate), rate);
+	if (gap <= 0)
+		return;
+	if ((uint64_t)gap >= ring->capacity) {
+		sync_ring_reset(ring);
 		return;
-	if (dm->debug_enabled) {
-		blog(LOG_INFO, "[ADM TRACE] Connect Target");
 	}
 
-	if (dm->target) {
-		blog(LOG_INFO, "Releasing prior audio callback");
-		obs_source_remove_audio_capture_callback(dm->target, capture_target, dm);
-		obs_source_release(dm->target);
-		dm->target = nullptr;
-		dm->connected_target = "";
-		dm->tgt_count = 0;
-		dm->tgt_pos = 0;
-		dm->last_tgt_ns = 0;
+	static const float silence[CAPTURE_BLOCK_FRAMES] = {};
+	for (int64_t done = 0; done < gap;) {
+		const size_t n = (size_t)std::min<int64_t>(gap - done, CAPTURE_BLOCK_FRAMES);
+		voice_activity_write(&cf->vad, silence, n, sync_ring_end(ring), rate);
+		sync_ring_write(ring, silence, n, now_ns);
+		done += (int64_t)n;
 	}
+}
 
-	blog(LOG_INFO, "[ADM Info] Connecting to %s", dm->target_name.c_str());
+// Writes one audio packet to a capture ring, downmixing several planes and
+// bandpassing when streaming preprocessing is on.  Both are decided once per
+// packet.  A mode change resets the ring and the filter state here, on the audio
+// thread, so the ring never holds filtered and raw samples together.
+static void capture_write(struct audio_sync_data *dm, sync_ring *ring, struct capture_filter *cf, int channel,
+			  const float *const *planes, size_t count, size_t frames, uint64_t timestamp)
+{
+	const uint64_t now_ns = os_gettime_ns();
+	const int64_t time_ns = timestamp ? capture_time(cf, timestamp, now_ns) : 0;
+	if (cf->resume) {
+		cf->resume = false;
+		if (timestamp)
+			capture_fill_gap(dm, ring, cf, time_ns, now_ns);
+	}
+	// Sources that send no timestamps are aligned on their newest frame instead
+	if (timestamp)
+		sync_ring_stamp(ring, sync_ring_end(ring), time_ns, dm->engine.sample_rate, CAPTURE_TS_SMOOTHING_NS);
+	const bool stream = dm->stream_filter.load(std::memory_order_relaxed);
+	if (stream != cf->filtered.load(std::memory_order_relaxed)) {
+		cf->state = {};
+		sync_ring_reset(ring);
+		cf->filtered.store(stream, std::memory_order_release);
+	}
+	// Audio from another channel would only blur the next windows
+	if (channel != cf->channel) {
+		cf->state = {};
+		sync_ring_reset(ring);
+		cf->channel = channel;
+	}
 
-	obs_source_t *src = obs_get_source_by_name(dm->target_name.c_str());
-	if (!src) {
-		blog(LOG_INFO, "[ADM] Target '%s' not yet available", dm->target_name.c_str());
-		// OK to leave target_name set
+	// The detector always sees the unfiltered audio, so its thresholds hold with either filter mode
+	if (!stream && count == 1) {
+		voice_activity_write(&cf->vad, planes[0], frames, sync_ring_end(ring), dm->engine.sample_rate);
+		sync_ring_write(ring, planes[0], frames, now_ns);
 		return;
 	}
 
-	dm->target = src;
-	dm->connected_target = dm->target_name;
-	obs_source_add_audio_capture_callback(dm->target, capture_target, dm);
-	blog(LOG_INFO, "[ADM Info] Connected to %s", dm->target_name.c_str());
+	float block[CAPTURE_BLOCK_FRAMES];
+	for (size_t done = 0; done < frames;) {
+		const size_t n = std::min<size_t>(frames - done, CAPTURE_BLOCK_FRAMES);
+		const float *src = planes[0] + done;
+		if (count > 1) {
+			channel_mix(planes, count, done, n, block);
+			src = block;
+		}
+		voice_activity_write(&cf->vad, src, n, sync_ring_end(ring), dm->engine.sample_rate);
+		if (stream) {
+			apply_bandpass_filter(src, block, n, &dm->engine.bp_coeffs, &cf->state);
+			src = block;
+		}
+		sync_ring_write(ring, src, n, now_ns);
+		done += n;
+	}
 }
 
-struct measurement_sample {
-	double delay_ms = 0.0;
-	double correlation = 0.0;
-	bool success = false;
-	std::string status;
-};
-
-static bool try_measure_once(struct audio_sync_data *dm, measurement_sample &out)
+static void capture_target(void *param, obs_source_t *source, const struct audio_data *audio, bool muted)
 {
-	if (!dm || !dm->target) {
-		out.status = "No target source";
-		return false;
-	}
+	UNUSED_PARAMETER(source);
+	UNUSED_PARAMETER(muted);
 
-	uint64_t last_ref_ns = 0;
-	uint64_t last_tgt_ns = 0;
-	size_t ref_count = 0;
-	size_t tgt_count = 0;
+	auto *target = static_cast<sync_target *>(param);
+	if (!target)
+		return;
 
-	pthread_mutex_lock(&dm->lock);
-	ref_count = dm->ref_count;
-	tgt_count = dm->tgt_count;
-	last_ref_ns = dm->last_ref_ns;
-	last_tgt_ns = dm->last_tgt_ns;
-	pthread_mutex_unlock(&dm->lock);
+	const uint64_t start_ns = sync_stats_now_ns();
+	const int channel = target->channel.load(std::memory_order_relaxed);
+	const float *planes[MAX_AV_PLANES];
+	const size_t count = capture_planes((const uint8_t *const *)audio->data, target->dm->audio_format,
+					    target->dm->channels, channel, planes);
+	if (!count || audio->frames == 0)
+		return;
 
-	if (ref_count < 1024 || tgt_count < 1024) {
-		out.status = "Buffers too small";
-		return false;
+	capture_write(target->dm, &target->ring, &target->capture, channel, planes, count, audio->frames,
+		      audio->timestamp);
+	sync_stats_since(&target->dm->stats, SYNC_STAT_CAPTURE_TARGET, start_ns);
+}
+
+static void capture_ref(void *param, obs_source_t *source, const struct audio_data *audio, bool muted)
+{
+	UNUSED_PARAMETER(source);
+	UNUSED_PARAMETER(muted);
+
+	auto *dm = static_cast<audio_sync_data *>(param);
+	if (!dm)
+		return;
+
+	const uint64_t start_ns = sync_stats_now_ns();
+	const int channel = dm->ref_channel.load(std::memory_order_relaxed);
+	const float *planes[MAX_AV_PLANES];
+	const size_t count =
+		capture_planes((const uint8_t *const *)audio->data, dm->audio_format, dm->channels, channel, planes);
+	if (!count || audio->frames == 0)
+		return;
+
+	capture_write(dm, &dm->ref_ring, &dm->ref_capture, channel, planes, count, audio->frames, audio->timestamp);
+	sync_stats_since(&dm->stats, SYNC_STAT_CAPTURE_REF, start_ns);
+}
+
+// Hands fn(param) to a free Sync Analyzer filter on `source`.  Caller holds dm->lock.
+static bool filter_attach(struct audio_sync_data *dm, obs_source_t *source, obs_source_audio_capture_t fn,
+			  void *param)
+{
+	for (struct sync_filter *filter : dm->filters) {
+		if (filter->parent != source)
+			continue;
+		pthread_mutex_lock(&filter->lock);
+		const bool free = !filter->sink;
+		if (free) {
+			filter->sink = fn;
+			filter->sink_param = param;
+		}
+		pthread_mutex_unlock(&filter->lock);
+		if (free)
+			return true;
+	}
+	return false;
+}
+
+// Caller holds dm->lock
+static void filter_detach(struct audio_sync_data *dm, obs_source_t *source, obs_source_audio_capture_t fn,
+			  void *param)
+{
+	for (struct sync_filter *filter : dm->filters) {
+		if (filter->parent != source)
+			continue;
+		pthread_mutex_lock(&filter->lock);
+		if (filter->sink == fn && filter->sink_param == param) {
+			filter->sink = nullptr;
+			filter->sink_param = nullptr;
+		}
+		pthread_mutex_unlock(&filter->lock);
+	}
+}
+
+// Feeds fn(param) from the source's Sync Analyzer filter when it has one, from an audio capture callback otherwise
+static void attach_capture(struct audio_sync_data *dm, obs_source_t *source, obs_source_audio_capture_t fn,
+			   void *param)
+{
+	pthread_mutex_lock(&dm->lock);
+	const bool filtered = filter_attach(dm, source, fn, param);
+	pthread_mutex_unlock(&dm->lock);
+	if (!filtered)
+		obs_source_add_audio_capture_callback(source, fn, param);
+}
+
+// However it was fed, fn(param) is not running and is not called again once this returns
+static void detach_capture(struct audio_sync_data *dm, obs_source_t *source, obs_source_audio_capture_t fn,
+			   void *param)
+{
+	pthread_mutex_lock(&dm->lock);
+	filter_detach(dm, source, fn, param);
+	pthread_mutex_unlock(&dm->lock);
+	obs_source_remove_audio_capture_callback(source, fn, param);
+}
+
+// Hands a source's buffered audio to the ring that captures it from now on, so
+// swapping a source between reference and target keeps what it has buffered.
+// `ring` must be detached; `from` may still be live.
+static void adopt_history(sync_ring *ring, struct capture_filter *cf, const sync_ring *from,
+			  const struct capture_filter *from_cf, int channel)
+{
+	sync_ring_copy(ring, from);
+	voice_activity_copy(&cf->vad, &from_cf->vad);
+	cf->state = {};
+	cf->channel = channel;
+	cf->filtered.store(from_cf->filtered.load(std::memory_order_acquire), std::memory_order_relaxed);
+	// The same device clock offset, so the gap to the first packet is measured on the same timeline
+	const int64_t adjust = from_cf->timing_adjust_ns.load(std::memory_order_relaxed);
+	cf->timing_adjust_ns.store(adjust, std::memory_order_relaxed);
+	cf->timing_set.store(from_cf->timing_set.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	cf->resume = true;
+}
+
+// A new reference to the source selected as `name`.  A source with a Sync
+// Analyzer filter is taken from the filter's parent pointer, which stays valid
+// from filter_add to filter_remove.  Only sources picked in the dock or through
+// the API without a filter are looked up by name.
+static obs_source_t *selected_source(struct audio_sync_data *dm, const std::string &name)
+{
+	obs_source_t *src = nullptr;
+	pthread_mutex_lock(&dm->lock);
+	for (size_t i = 0; i < dm->filters.size() && !src; ++i) {
+		obs_source_t *parent = dm->filters[i]->parent;
+		if (parent && name == obs_source_get_name(parent))
+			src = obs_source_get_ref(parent);
+	}
+	pthread_mutex_unlock(&dm->lock);
+	return src ? src : obs_get_source_by_name(name.c_str());
+}
+
+static void disconnect_ref(struct audio_sync_data *dm)
+{
+	if (!dm->ref)
+		return;
+
+	detach_capture(dm, dm->ref, capture_ref, dm);
+	obs_source_release(dm->ref);
+	dm->ref = nullptr;
+	sync_ring_reset(&dm->ref_ring);
+	// The callback is gone, so its filter state is ours to clear
+	dm->ref_capture.state = {};
+}
+
+// A new reference takes over the history of a target, in dm->targets or in
+// `leaving`, that captures the same source and channel.
+static void connect_ref(struct audio_sync_data *dm, const std::vector<std::shared_ptr<sync_target>> *leaving)
+{
+	// Picked up by the callback on its next packet, even when the source is unchanged
+	pthread_mutex_lock(&dm->lock);
+	dm->ref_channel.store(source_channel(dm, dm->ref_name), std::memory_order_relaxed);
+	pthread_mutex_unlock(&dm->lock);
+
+	if (dm->ref && dm->ref_name == dm->connected_ref) {
+		return;
+	}
+	if (dm->ref_name.empty())
+		return;
+	if (dm->debug_enabled) {
+		blog(LOG_INFO, "[ADM TRACE] Connect Ref");
+	}
+
+	disconnect_ref(dm);
+
+	obs_source_t *src = selected_source(dm, dm->ref_name);
+	if (!src) {
+		blog(LOG_INFO, "[ADM] Ref '%s' not yet available", dm->ref_name.c_str());
+		return;
+	}
+
+	dm->ref = src;
+	dm->connected_ref = dm->ref_name;
+
+	const int channel = dm->ref_channel.load(std::memory_order_relaxed);
+	struct target_list list;
+	snapshot_targets(dm, &list);
+	const struct sync_target *holder = nullptr;
+	for (size_t i = 0; i < list.count && !holder; ++i) {
+		if (list.items[i]->source == src && list.items[i]->channel.load(std::memory_order_relaxed) == channel)
+			holder = list.items[i].get();
+	}
+	for (size_t i = 0; leaving && i < leaving->size() && !holder; ++i) {
+		const struct sync_target *t = (*leaving)[i].get();
+		if (t->source == src && t->channel.load(std::memory_order_relaxed) == channel)
+			holder = t;
+	}
+	if (holder && sync_ring_available(&holder->ring))
+		adopt_history(&dm->ref_ring, &dm->ref_capture, &holder->ring, &holder->capture, channel);
+
+	attach_capture(dm, dm->ref, capture_ref, dm);
+}
+
+static void connect_ref(struct audio_sync_data *dm)
+{
+	connect_ref(dm, nullptr);
+}
+
+static void disconnect_target(struct sync_target *target)
+{
+	if (!target->source)
+		return;
+
+	blog(LOG_INFO, "Releasing prior audio callback");
+	detach_capture(target->dm, target->source, capture_target, target);
+	obs_source_release(target->source);
+	target->source = nullptr;
+	sync_ring_reset(&target->ring);
+	target->capture.state = {};
+}
+
+static void connect_target(struct sync_target *target)
+{
+	if (target->source)
+		return;
+
+	const std::string &name = *target->name;
+	blog(LOG_INFO, "[ADM Info] Connecting to %s", name.c_str());
+
+	struct audio_sync_data *dm = target->dm;
+	obs_source_t *src = selected_source(dm, name);
+	if (!src) {
+		blog(LOG_INFO, "[ADM] Target '%s' not yet available", name.c_str());
+		// OK to keep the target; it is retried on the next connect
+		return;
+	}
+
+	target->source = src;
+	// A source that was the reference until now takes its history along
+	const int channel = target->channel.load(std::memory_order_relaxed);
+	if (dm->ref == src && dm->ref_channel.load(std::memory_order_relaxed) == channel &&
+	    sync_ring_available(&dm->ref_ring))
+		adopt_history(&target->ring, &target->capture, &dm->ref_ring, &dm->ref_capture, channel);
+	attach_capture(target->dm, target->source, capture_target, target);
+	blog(LOG_INFO, "[ADM Info] Connected to %s", name.c_str());
+}
+
+// Reconciles the target list with target_names.  Targets that stay selected keep
+// their rings, so re-applying settings never throws buffered audio away.  With
+// `leaving`, dropped targets are handed over still connected instead of being
+// disconnected, for connect_sources().
+static void connect_targets(struct audio_sync_data *dm, std::vector<std::shared_ptr<sync_target>> *leaving)
+{
+	if (dm->debug_enabled) {
+		blog(LOG_INFO, "[ADM TRACE] Connect Targets");
+	}
+
+	pthread_mutex_lock(&dm->lock);
+	const std::vector<std::string> names = dm->target_names;
+	const std::map<std::string, int> channels = dm->source_channels;
+	std::vector<std::shared_ptr<sync_target>> current = dm->targets;
+	pthread_mutex_unlock(&dm->lock);
+
+	std::vector<std::shared_ptr<sync_target>> next;
+	for (const std::string &name : names) {
+		if (name.empty() || next.size() >= MAX_TARGETS)
+			continue;
+
+		auto it = std::find_if(current.begin(), current.end(), [&name](const std::shared_ptr<sync_target> &t) {
+			return t && *t->name == name;
+		});
+		if (it != current.end()) {
+			next.push_back(*it);
+			it->reset();
+			continue;
+		}
+
+		auto target = std::make_shared<sync_target>();
+		target->dm = dm;
+		target->name = std::make_shared<const std::string>(name);
+		sync_ring_init(&target->ring, dm->capacity, dm->ring_format);
+		voice_activity_init(&target->capture.vad, dm->capacity);
+		next.push_back(target);
+	}
+
+	for (auto &target : current) {
+		if (target && leaving)
+			leaving->push_back(target);
+		else if (target)
+			disconnect_target(target.get());
+	}
+	for (auto &target : next) {
+		auto it = channels.find(*target->name);
+		target->channel.store(it != channels.end() ? it->second : CAPTURE_CHANNEL_MIX, std::memory_order_relaxed);
+		connect_target(target.get());
+	}
+
+	pthread_mutex_lock(&dm->lock);
+	dm->targets = next;
+	if (dm->selected_target >= dm->targets.size())
+		dm->selected_target = 0;
+	pthread_mutex_unlock(&dm->lock);
+}
+
+static void connect_targets(struct audio_sync_data *dm)
+{
+	connect_targets(dm, nullptr);
+}
+
+// Connects the reference and the targets.  Targets go first and dropped ones
+// are only disconnected last, so a source that changes role hands its history
+// over from a capture that is still running: a new target adopts the outgoing
+// reference's ring, the new reference a current or dropped target's.
+static void connect_sources(struct audio_sync_data *dm)
+{
+	std::vector<std::shared_ptr<sync_target>> leaving;
+	connect_targets(dm, &leaving);
+	connect_ref(dm, &leaving);
+	for (auto &target : leaving)
+		disconnect_target(target.get());
+}
+
+// Moves the reference and any target on `parent` to the capture path it has
+// now, keeping their rings.  `parent` is only compared, never dereferenced.
+static void recapture(struct audio_sync_data *dm, const obs_source_t *parent)
+{
+	if (dm->ref && dm->ref == parent) {
+		detach_capture(dm, dm->ref, capture_ref, dm);
+		attach_capture(dm, dm->ref, capture_ref, dm);
+	}
+
+	struct target_list list;
+	snapshot_targets(dm, &list);
+	for (size_t i = 0; i < list.count; ++i) {
+		struct sync_target *target = list.items[i].get();
+		if (target->source && target->source == parent) {
+			detach_capture(dm, target->source, capture_target, target);
+			attach_capture(dm, target->source, capture_target, target);
+		}
+	}
+}
+
+// A filter was added, removed or given another role; applied on the UI thread, which owns the connections
+struct sync_filter_change {
+	// Compared, never dereferenced: the source may be gone by the time the change is applied
+	const obs_source_t *parent;
+	// The same source, if it still exists then
+	obs_weak_source_t *weak;
+	enum sync_filter_role role;
+	// Select the source in `role`; false when the filter was removed
+	bool select;
+};
+
+// Selects `source` in `role`.  The entries it holds now are found by pointer,
+// so a second filter on a source that is already selected only changes its role.
+// Returns true when it stops being the reference.  UI thread.
+static bool select_filtered_source(struct audio_sync_data *dm, obs_source_t *source, enum sync_filter_role role)
+{
+	const std::string name = obs_source_get_name(source);
+	struct target_list list;
+	snapshot_targets(dm, &list);
+	std::shared_ptr<const std::string> held;
+	for (size_t i = 0; i < list.count && !held; ++i) {
+		if (list.items[i]->source == source)
+			held = list.items[i]->name;
+	}
+
+	bool ref_dropped = false;
+	pthread_mutex_lock(&dm->lock);
+	std::vector<std::string> &names = dm->target_names;
+	if (role == SYNC_FILTER_REFERENCE) {
+		dm->ref_name = name;
+		names.erase(std::remove(names.begin(), names.end(), held ? *held : name), names.end());
+	} else if (!held && std::find(names.begin(), names.end(), name) == names.end()) {
+		if (names.size() < MAX_TARGETS)
+			names.push_back(name);
+		else
+			blog(LOG_WARNING, "[ADM] '%s' not added: already measuring %u targets", name.c_str(),
+			     (unsigned)MAX_TARGETS);
+	}
+	if (role == SYNC_FILTER_TARGET && (dm->ref == source || dm->ref_name == name)) {
+		dm->ref_name.clear();
+		ref_dropped = true;
+	}
+	pthread_mutex_unlock(&dm->lock);
+	return ref_dropped;
+}
+
+static void sync_filter_change_ui(void *param)
+{
+	std::unique_ptr<struct sync_filter_change> change(static_cast<struct sync_filter_change *>(param));
+	obs_source_t *source = obs_weak_source_get_source(change->weak);
+	obs_weak_source_release(change->weak);
+	struct audio_sync_data *dm = g_dm;
+	if (!dm) {
+		obs_source_release(source);
+		return;
+	}
+
+	// A source is either the reference or a target; each filter feeds one ring
+	const bool ref_dropped = change->select && source && select_filtered_source(dm, source, change->role);
+	obs_source_release(source);
+
+	// The outgoing reference stays connected until the new target has taken its
+	// history; recapturing last moves whichever ring now owns the source onto its filter
+	connect_sources(dm);
+	if (ref_dropped)
+		disconnect_ref(dm);
+	recapture(dm, change->parent);
+	update_dock_ui(dm);
+}
+
+static void sync_filter_queue(obs_source_t *parent, enum sync_filter_role role, bool select)
+{
+	auto *change = new sync_filter_change();
+	change->parent = parent;
+	change->weak = obs_source_get_weak_source(parent);
+	change->role = role;
+	change->select = select;
+	obs_queue_task(OBS_TASK_UI, sync_filter_change_ui, change, false);
+}
+
+// A source was renamed.  Selections and channel choices are stored by name, so
+// they follow it; the rings are bound to the source itself and keep capturing.
+struct source_rename {
+	std::string prev;
+	std::string next;
+};
+
+static void source_rename_ui(void *param)
+{
+	std::unique_ptr<struct source_rename> rename(static_cast<struct source_rename *>(param));
+	struct audio_sync_data *dm = g_dm;
+	if (!dm)
+		return;
+
+	// Names are unique, so whatever was selected as `prev` was this source
+	const auto renamed = std::make_shared<const std::string>(rename->next);
+	pthread_mutex_lock(&dm->lock);
+	bool selected = dm->ref_name == rename->prev;
+	if (selected)
+		dm->ref_name = rename->next;
+	if (dm->connected_ref == rename->prev)
+		dm->connected_ref = rename->next;
+	for (std::string &name : dm->target_names) {
+		if (name == rename->prev) {
+			name = rename->next;
+			selected = true;
+		}
+	}
+	const auto channel = dm->source_channels.find(rename->prev);
+	if (channel != dm->source_channels.end()) {
+		const int value = channel->second;
+		dm->source_channels.erase(channel);
+		dm->source_channels[rename->next] = value;
+	}
+	for (auto &target : dm->targets) {
+		if (*target->name == rename->prev)
+			std::atomic_store(&target->name, std::shared_ptr<const std::string>(renamed));
+	}
+	pthread_mutex_unlock(&dm->lock);
+
+	if (selected) {
+		blog(LOG_INFO, "[ADM] '%s' renamed to '%s'", rename->prev.c_str(), rename->next.c_str());
+		update_dock_ui(dm);
+	}
+}
+
+static void source_renamed(void *param, calldata_t *cd)
+{
+	UNUSED_PARAMETER(param);
+	const char *prev = calldata_string(cd, "prev_name");
+	const char *next = calldata_string(cd, "new_name");
+	if (!prev || !next)
+		return;
+
+	auto *rename = new source_rename();
+	rename->prev = prev;
+	rename->next = next;
+	obs_queue_task(OBS_TASK_UI, source_rename_ui, rename, false);
+}
+
+static enum sync_filter_role sync_filter_role_from(obs_data_t *settings)
+{
+	return obs_data_get_int(settings, "role") == SYNC_FILTER_REFERENCE ? SYNC_FILTER_REFERENCE
+									   : SYNC_FILTER_TARGET;
+}
+
+static const char *sync_filter_get_name(void *type_data)
+{
+	UNUSED_PARAMETER(type_data);
+	return obs_module_text("SyncAnalyzerFilter");
+}
+
+static void *sync_filter_create(obs_data_t *settings, obs_source_t *context)
+{
+	auto *filter = new sync_filter();
+	filter->context = context;
+	filter->role = sync_filter_role_from(settings);
+	pthread_mutex_init(&filter->lock, nullptr);
+
+	struct audio_sync_data *dm = acquire_dm();
+	if (dm) {
+		pthread_mutex_lock(&dm->lock);
+		dm->filters.push_back(filter);
+		pthread_mutex_unlock(&dm->lock);
+		release_dm();
+	}
+	return filter;
+}
+
+static void sync_filter_destroy(void *data)
+{
+	auto *filter = static_cast<struct sync_filter *>(data);
+	struct audio_sync_data *dm = acquire_dm();
+	if (dm) {
+		pthread_mutex_lock(&dm->lock);
+		auto &filters = dm->filters;
+		filters.erase(std::remove(filters.begin(), filters.end(), filter), filters.end());
+		pthread_mutex_unlock(&dm->lock);
+		release_dm();
+	}
+	pthread_mutex_destroy(&filter->lock);
+	delete filter;
+}
+
+static void sync_filter_add(void *data, obs_source_t *parent)
+{
+	auto *filter = static_cast<struct sync_filter *>(data);
+	struct audio_sync_data *dm = acquire_dm();
+	if (!dm)
+		return;
+
+	pthread_mutex_lock(&dm->lock);
+	filter->parent = parent;
+	const enum sync_filter_role role = filter->role;
+	pthread_mutex_unlock(&dm->lock);
+	release_dm();
+	sync_filter_queue(parent, role, true);
+}
+
+// Also called when the parent is destroyed, on whichever thread released it
+static void sync_filter_remove(void *data, obs_source_t *parent)
+{
+	auto *filter = static_cast<struct sync_filter *>(data);
+	struct audio_sync_data *dm = acquire_dm();
+	if (!dm)
+		return;
+
+	pthread_mutex_lock(&dm->lock);
+	filter->parent = nullptr;
+	pthread_mutex_lock(&filter->lock);
+	const bool fed = filter->sink != nullptr;
+	filter->sink = nullptr;
+	filter->sink_param = nullptr;
+	pthread_mutex_unlock(&filter->lock);
+	const enum sync_filter_role role = filter->role;
+	pthread_mutex_unlock(&dm->lock);
+	release_dm();
+
+	// The source stays selected; whatever the filter fed goes back to an audio capture callback
+	if (fed)
+		sync_filter_queue(parent, role, false);
+}
+
+static void sync_filter_update(void *data, obs_data_t *settings)
+{
+	auto *filter = static_cast<struct sync_filter *>(data);
+	struct audio_sync_data *dm = acquire_dm();
+	if (!dm)
+		return;
+
+	const enum sync_filter_role role = sync_filter_role_from(settings);
+	pthread_mutex_lock(&dm->lock);
+	const bool changed = role != filter->role;
+	filter->role = role;
+	obs_source_t *parent = filter->parent;
+	pthread_mutex_unlock(&dm->lock);
+	release_dm();
+	if (changed && parent)
+		sync_filter_queue(parent, role, true);
+}
+
+static void sync_filter_defaults(obs_data_t *settings)
+{
+	obs_data_set_default_int(settings, "role", SYNC_FILTER_TARGET);
+}
+
+static obs_properties_t *sync_filter_properties(void *data)
+{
+	UNUSED_PARAMETER(data);
+	obs_properties_t *props = obs_properties_create();
+	obs_property_t *role = obs_properties_add_list(props, "role", obs_module_text("SyncRole"),
+						       OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_INT);
+	obs_property_list_add_int(role, obs_module_text("SyncRoleTarget"), SYNC_FILTER_TARGET);
+	obs_property_list_add_int(role, obs_module_text("SyncRoleReference"), SYNC_FILTER_REFERENCE);
+	obs_properties_add_text(props, "info", obs_module_text("SyncFilterInfo"), OBS_TEXT_INFO);
+	return props;
+}
+
+// The whole audio-path cost: hand the packet to the attached ring, pass it on unchanged
+static struct obs_audio_data *sync_filter_audio(void *data, struct obs_audio_data *audio)
+{
+	auto *filter = static_cast<struct sync_filter *>(data);
+	// A packet arriving while a ring is being attached or detached is dropped
+	if (pthread_mutex_trylock(&filter->lock) != 0)
+		return audio;
+
+	if (filter->sink) {
+		struct audio_data packet = {};
+		memcpy(packet.data, audio->data, sizeof(packet.data));
+		packet.frames = audio->frames;
+		packet.timestamp = audio->timestamp;
+		filter->sink(filter->sink_param, obs_filter_get_parent(filter->context), &packet, false);
+	}
+	pthread_mutex_unlock(&filter->lock);
+	return audio;
+}
+
+static void register_sync_filter()
+{
+	static struct obs_source_info info = {};
+	info.id = "audio_sync_analyzer_filter";
+	info.type = OBS_SOURCE_TYPE_FILTER;
+	info.output_flags = OBS_SOURCE_AUDIO;
+	info.get_name = sync_filter_get_name;
+	info.create = sync_filter_create;
+	info.destroy = sync_filter_destroy;
+	info.update = sync_filter_update;
+	info.get_defaults = sync_filter_defaults;
+	info.get_properties = sync_filter_properties;
+	info.filter_audio = sync_filter_audio;
+	info.filter_add = sync_filter_add;
+	info.filter_remove = sync_filter_remove;
+	obs_register_source(&info);
+}
+
+static bool target_ready(const struct audio_sync_data *dm, struct sync_target *target, uint64_t now_ns,
+			 uint64_t max_age_ns, measurement_sample &out)
+{
+	UNUSED_PARAMETER(dm);
+
+	if (!target->source) {
+		out.status = "No target source";
+		return false;
+	}
+	if (sync_ring_available(&target->ring) < 1024) {
+		out.status = "Buffers too small";
+		return false;
+	}
+	if (!has_recent_audio(sync_ring_last_write_ns(&target->ring), now_ns, max_age_ns)) {
+		out.status = "Target inactive";
+		return false;
+	}
+	return true;
+}
+
+// Checks the reference and every target in `list` against the window and lag in
+// `params`.  Returns how many targets can be measured and their indices in
+// `ready`; samples[i] is reset and, when list->items[i] cannot be measured,
+// given the reason.
+static size_t ready_targets(struct audio_sync_data *dm, const struct sync_engine_settings *params,
+			    const struct target_list *list, measurement_sample *samples, size_t *ready)
+{
+	for (size_t i = 0; i < list->count; ++i)
+		samples[i] = measurement_sample();
+
+	if (!dm || !list->count)
+		return 0;
+
+	const char *ref_status = nullptr;
+	const uint64_t now_ns = os_gettime_ns();
+	const uint64_t max_age_ns = (uint64_t)(params->window_ms + params->max_lag_ms + 200u) * 1000000ULL;
+
+	if (!dm->ref)
+		ref_status = "No reference source";
+	else if (sync_ring_available(&dm->ref_ring) < 1024)
+		ref_status = "Buffers too small";
+	else if (!has_recent_audio(sync_ring_last_write_ns(&dm->ref_ring), now_ns, max_age_ns))
+		ref_status = "Reference inactive";
+
+	if (ref_status) {
+		for (size_t i = 0; i < list->count; ++i)
+			samples[i].status = ref_status;
+		return 0;
+	}
+
+	size_t count = 0;
+	for (size_t i = 0; i < list->count; ++i) {
+		if (target_ready(dm, list->items[i].get(), now_ns, max_age_ns, samples[i]))
+			ready[count++] = i;
+	}
+	return count;
+}
+
+// Measures every target once; samples[i] receives the result for list->items[i]
+// and, when curves is set, curves[i] the correlation around its peak
+static bool try_measure_once(struct audio_sync_data *dm, const struct sync_engine_settings *params,
+			     const struct target_list *list, measurement_sample *samples, struct sync_curve *curves)
+{
+	size_t ready[MAX_TARGETS];
+	const size_t count = ready_targets(dm, params, list, samples, ready);
+
+	sync_target *targets[MAX_TARGETS];
+	measurement_sample *outs[MAX_TARGETS];
+	for (size_t i = 0; i < count; ++i) {
+		targets[i] = list->items[ready[i]].get();
+		outs[i] = &samples[ready[i]];
+		outs[i]->curve = curves ? &curves[ready[i]] : nullptr;
+	}
+	return estimate_delays(dm, params, targets, outs, count);
+}
+
+static bool perform_measure(struct audio_sync_data *dm)
+{
+	if (!dm)
+		return false;
+
+	follow_audio_output(dm);
+	const struct sync_engine_settings params = read_measure_params(dm);
+	if (params.debug) {
+		blog(LOG_INFO, "[ADM DIAG] Starting measurement");
+	}
+
+	struct target_list list;
+	snapshot_targets(dm, &list);
+
+	if (!list.count || !dm->ref) {
+		set_result(dm, "---", "Select both reference and target sources.", false);
+		return false;
+	}
+
+	const size_t ref_count = sync_ring_available(&dm->ref_ring);
+	if (params.debug) {
+		blog(LOG_INFO, "[ADM DIAG] ref=%zu targets=%zu", ref_count, list.count);
+	}
+
+	const uint64_t now_ns = os_gettime_ns();
+	// Grace window
+	const uint64_t max_age_ns = (uint64_t)(params.window_ms + params.max_lag_ms + 200u) * 1000000ULL;
+
+	if (!has_recent_audio(sync_ring_last_write_ns(&dm->ref_ring), now_ns, max_age_ns)) {
+		set_result(dm, "---", "No recent audio on reference source.", false);
+		return false;
+	}
+
+	if (ref_count < 1024) {
+		set_result(dm, "---", "Need more buffered audio from both reference and target before measuring.",
+			   false);
+		return false;
+	}
+
+	measurement_sample samples[MAX_TARGETS];
+	struct sync_curve curves[MAX_TARGETS];
+
+	blog(LOG_INFO, "[ADM] Estimating Audio Delay");
+	const bool any = try_measure_once(dm, &params, &list, samples, curves);
+
+	if (!any && list.count == 1) {
+		// Keep the single-target guidance specific
+		const std::string &status = samples[0].status;
+		if (status == "Target inactive")
+			set_result(dm, "---", "No recent audio on target source.", false);
+		else if (status == "Buffers too small")
+			set_result(dm, "---",
+				   "Need more buffered audio from both reference and target before measuring.", false);
+		else if (status == "No speech on reference" || status == "No speech on target")
+			set_result(dm, "---", "No speech on both sources; measure again while someone is talking.",
+				   false);
+		else
+			set_result(dm, "---",
+				   "Insufficient correlation; ensure both sources carry similar program audio.", false);
+		return false;
+	}
+
+	publish_results(dm, &list, samples, nullptr, false);
+	return any;
+}
+
+static void measure_task(void *param)
+{
+	perform_measure(static_cast<audio_sync_data *>(param));
+}
+
+// Sources are connected on the calling (UI) thread, which owns the target list;
+// the measurement itself runs on the pool so the dock stays responsive.  A click
+// while a measurement is still pending is ignored.
+static void measure_now(audio_sync_data *dm)
+{
+	if (!dm->ref && !dm->ref_name.empty())
+		connect_ref(dm);
+	connect_targets(dm);
+
+	if (dm->pool.threads.empty()) {
+		perform_measure(dm);
+		return;
+	}
+
+	pthread_mutex_lock(&dm->lock);
+	if (task_done(dm->measure_task))
+		dm->measure_task = task_pool_submit(&dm->pool, measure_task, dm, TASK_PRIORITY_HIGH);
+	pthread_mutex_unlock(&dm->lock);
+}
+
+// One worker's share of an instant average: windows worker, worker + workers, ...
+struct average_job {
+	struct audio_sync_data *dm;
+	const struct sync_engine_settings *params;
+	struct sync_target *const *targets;
+	const bool *prefiltered;
+	size_t count;
+	bool ref_prefiltered;
+	size_t frames;
+	size_t hop;
+	int max_lag;
+	size_t worker;
+	size_t workers;
+	// outs[r * count + i] receives window r's result for targets[i], if voiced[r * count + i]
+	measurement_sample *const *outs;
+	const bool *voiced;
+};
+
+static bool average_stopped(struct audio_sync_data *dm)
+{
+	pthread_mutex_lock(&dm->lock);
+	const bool stop = task_cancelled(dm->average_task);
+	pthread_mutex_unlock(&dm->lock);
+	return stop;
+}
+
+static void average_windows(struct average_job *job)
+{
+	struct audio_sync_data *dm = job->dm;
+	struct average_state *st = &dm->average;
+	struct correlation_workspace *ws = &st->ws[job->worker];
+	struct target_workspace *tw = &st->tw[job->worker];
+
+	prepare_workspace(ws, job->frames, coarse_decimation(dm->engine.sample_rate, job->params->coarse_search));
+	prepare_taper(ws, job->params->taper);
+
+	for (size_t r = job->worker; r < AVERAGE_ROUNDS && !average_stopped(dm); r += job->workers) {
+		const bool *voiced = job->voiced + r * job->count;
+		if (std::find(voiced, voiced + job->count, true) == voiced + job->count)
+			continue;
+
+		const size_t start = r * job->hop;
+		std::copy(st->ref.begin() + start, st->ref.begin() + start + job->frames, ws->ref.begin());
+		prepare_reference(&dm->engine, ws, job->ref_prefiltered, job->params->weighting);
+
+		for (size_t i = 0; i < job->count; ++i) {
+			if (!voiced[i])
+				continue;
+			struct target_job tj = {dm, ws, job->targets[i], tw, {}, st->tgt[i].data() + start,
+						job->max_lag, job->params, job->prefiltered[i],
+						job->outs[r * job->count + i]};
+			correlate_target(&tj);
+		}
+	}
+}
+
+static void average_windows_task(void *param)
+{
+	average_windows(static_cast<struct average_job *>(param));
+}
+
+// Cuts AVERAGE_ROUNDS evenly spaced, overlapping windows out of one snapshot of
+// the whole buffer and correlates them in parallel on the pool, instead of waiting for new
+// audio between measurements.  The snapshot is filtered in one pass, so no
+// window carries the bandpass startup transient.  Returns false, leaving
+// `rounds` empty, when too little audio is buffered to space the windows out.
+static bool measure_average_instant(struct audio_sync_data *dm, const struct target_list *list,
+				    std::vector<std::vector<measurement_sample>> *rounds)
+{
+	struct average_state *st = &dm->average;
+	const struct sync_engine_settings params = read_measure_params(dm);
+	const uint64_t start_ns = os_gettime_ns();
+
+	measurement_sample status[MAX_TARGETS];
+	size_t ready[MAX_TARGETS];
+	const size_t count = ready_targets(dm, &params, list, status, ready);
+	if (count == 0)
+		return false;
+
+	sync_target *targets[MAX_TARGETS];
+	for (size_t i = 0; i < count; ++i)
+		targets[i] = list->items[ready[i]].get();
+
+	// Audio from before the snapshot's end counts; whatever a ring holds past it does not
+	uint64_t ends[MAX_TARGETS + 1];
+	aligned_ends(dm, targets, count, ends);
+	const uint64_t ref_begin = sync_ring_begin(&dm->ref_ring);
+	size_t available = ends[0] > ref_begin ? (size_t)(ends[0] - ref_begin) : 0;
+	for (size_t i = 0; i < count; ++i) {
+		const uint64_t begin = sync_ring_begin(&targets[i]->ring);
+		available = std::min(available, ends[1 + i] > begin ? (size_t)(ends[1 + i] - begin) : 0);
+	}
+
+	// The ring is a little larger than BUFFER_SECONDS; reading no more than that
+	// leaves the producer room to write while the snapshot is copied
+	available = std::min(available, ms_to_samples(BUFFER_SECONDS * 1000u, dm->engine.sample_rate));
+	const size_t frames = ms_to_samples(params.window_ms, dm->engine.sample_rate);
+	const size_t min_hop = ms_to_samples(AVERAGE_MIN_HOP_MS, dm->engine.sample_rate);
+	if (available < frames + (AVERAGE_ROUNDS - 1) * min_hop)
+		return false;
+	const size_t hop = (available - frames) / (AVERAGE_ROUNDS - 1);
+	const size_t total = frames + (AVERAGE_ROUNDS - 1) * hop;
+
+	// Held only while copying, so the rings cannot be rebuilt under the views
+	bool prefiltered[MAX_TARGETS];
+	bool ref_prefiltered = false;
+	bool copied = false;
+	const uint64_t wait_ns = sync_stats_now_ns();
+	pthread_mutex_lock(&dm->workspace_lock);
+	const uint64_t copy_ns = sync_stats_since(&dm->stats, SYNC_STAT_LOCK_WAIT, wait_ns);
+	st->ref.resize(total);
+	for (size_t i = 0; i < count; ++i)
+		st->tgt[i].resize(total);
+	for (int attempt = 0; attempt < 4 && !copied; ++attempt) {
+		sync_ring_view ref_view;
+		sync_ring_view views[MAX_TARGETS];
+		ref_prefiltered = capture_prefiltered(&dm->ref_capture);
+		bool peeked = sync_ring_peek_at(&dm->ref_ring, ends[0] - total, total, &ref_view);
+		for (size_t i = 0; i < count && peeked; ++i) {
+			prefiltered[i] = capture_prefiltered(&targets[i]->capture);
+			peeked = sync_ring_peek_at(&targets[i]->ring, ends[1 + i] - total, total, &views[i]);
+		}
+		if (!peeked)
+			break;
+
+		filter_ring_view(&ref_view, st->ref.data(), &dm->engine.bp_coeffs, ref_prefiltered);
+		for (size_t i = 0; i < count; ++i)
+			filter_ring_view(&views[i], st->tgt[i].data(), &dm->engine.bp_coeffs, prefiltered[i]);
+
+		copied = sync_ring_view_valid(&dm->ref_ring, &ref_view) &&
+			 capture_prefiltered(&dm->ref_capture) == ref_prefiltered;
+		for (size_t i = 0; i < count && copied; ++i) {
+			copied = sync_ring_view_valid(&targets[i]->ring, &views[i]) &&
+				 capture_prefiltered(&targets[i]->capture) == prefiltered[i];
+		}
+	}
+	pthread_mutex_unlock(&dm->workspace_lock);
+	sync_stats_since(&dm->stats, SYNC_STAT_COPY, copy_ns);
+
+	if (!copied)
+		return false;
+
+	rounds->assign(AVERAGE_ROUNDS, std::vector<measurement_sample>(status, status + list->count));
+	measurement_sample *outs[AVERAGE_ROUNDS * MAX_TARGETS];
+	for (size_t r = 0; r < AVERAGE_ROUNDS; ++r) {
+		for (size_t i = 0; i < count; ++i)
+			outs[r * count + i] = &(*rounds)[r][ready[i]];
+	}
+
+	// Windows the voice gate rules out keep their status and are never correlated
+	const bool gate = voice_gate_enabled(dm);
+	bool voiced[AVERAGE_ROUNDS * MAX_TARGETS];
+	for (size_t r = 0; r < AVERAGE_ROUNDS; ++r) {
+		const uint64_t back = total - r * hop - frames;
+		const bool ref_voice = !gate || window_has_voice(&dm->ref_capture, ends[0] - back, frames);
+		for (size_t i = 0; i < count; ++i) {
+			const uint64_t end = ends[1 + i] - back;
+			const bool voice = ref_voice && (!gate || window_has_voice(&targets[i]->capture, end, frames));
+			voiced[r * count + i] = voice;
+			if (!voice)
+				outs[r * count + i]->status = ref_voice ? "No speech on target"
+									: "No speech on reference";
+		}
+	}
+
+	const int max_lag = sync_engine_max_lag(&dm->engine, params.max_lag_ms, frames);
+
+	const size_t workers = std::min<size_t>(AVERAGE_ROUNDS, std::max<size_t>(dm->pool.threads.size(), 1));
+	struct average_job jobs[AVERAGE_ROUNDS];
+	void *job_params[AVERAGE_ROUNDS];
+	for (size_t w = 0; w < workers; ++w) {
+		jobs[w] = {dm, &params, targets, prefiltered, count, ref_prefiltered, frames, hop, max_lag, w, workers,
+			   outs, voiced};
+		job_params[w] = &jobs[w];
+	}
+	task_pool_parallel(&dm->pool, &st->tasks, average_windows_task, job_params, workers);
+
+	if (dm->debug_enabled) {
+		blog(LOG_INFO, "[ADM DEBUG] AVERAGE: %u windows of %zu frames every %zu frames, %zu workers, %.1f ms",
+		     AVERAGE_ROUNDS, frames, hop, workers, (double)(os_gettime_ns() - start_ns) / 1e6);
+	}
+	return true;
+}
+
+static void measure_average_task(void *param)
+{
+	auto *dm = static_cast<audio_sync_data *>(param);
+	if (!dm)
+		return;
+
+	follow_audio_output(dm);
+	struct target_list list;
+	snapshot_targets(dm, &list);
+
+	// rounds[r][i] is round r's result for target i
+	std::vector<std::vector<measurement_sample>> rounds;
+	const bool instant = measure_average_instant(dm, &list, &rounds);
+
+	// Not enough buffered yet: collect the measurements over time instead
+	for (size_t i = 0; !instant && i < AVERAGE_ROUNDS && !average_stopped(dm); ++i) {
+		measurement_sample round[MAX_TARGETS];
+		follow_audio_output(dm);
+		const struct sync_engine_settings params = read_measure_params(dm);
+		try_measure_once(dm, &params, &list, round, nullptr);
+		rounds.emplace_back(round, round + list.count);
+
+		if (i + 1 < AVERAGE_ROUNDS)
+			os_sleep_ms(AVERAGE_INTERVAL_MS);
+	}
+
+	std::string notes;
+	measurement_sample results[MAX_TARGETS];
+	bool have_result = false;
+
+	for (size_t t = 0; t < list.count; ++t) {
+		std::vector<measurement_sample> successes;
+		successes.reserve(rounds.size());
+
+		for (size_t i = 0; i < rounds.size(); ++i) {
+			const auto &s = rounds[i][t];
+			if (s.success) {
+				successes.push_back(s);
+			}
+			if (dm->debug_enabled) {
+				char line[192];
+				const std::shared_ptr<const std::string> name = target_name(list.items[t].get());
+				if (s.success) {
+					snprintf(line, sizeof(line), "%s %2zu: %+7.2f ms ±%.2f (corr=%.2f)",
+						 name->c_str(), i + 1, s.delay_ms, s.interval_ms, s.correlation);
+				} else {
+					snprintf(line, sizeof(line), "%s %2zu: fail (%s)", name->c_str(), i + 1,
+						 s.status.c_str());
+				}
+				if (!notes.empty())
+					notes += "\n";
+				notes += line;
+			}
+		}
+
+		if (successes.empty()) {
+			results[t].status = "No successful measurements";
+			continue;
+		}
+
+		std::sort(successes.begin(), successes.end(),
+			  [](const measurement_sample &a, const measurement_sample &b) {
+				  return a.correlation > b.correlation;
+			  });
+		const size_t take = std::min<size_t>(AVERAGE_TOP, successes.size());
+		double sum_delay = 0.0;
+		double sum_corr = 0.0;
+		double sum_interval_sq = 0.0;
+		for (size_t i = 0; i < take; ++i) {
+			sum_delay += successes[i].delay_ms;
+			sum_corr += successes[i].correlation;
+			sum_interval_sq += successes[i].interval_ms * successes[i].interval_ms;
+		}
+		const double mean_delay = sum_delay / (double)take;
+
+		// The windows overlap, so widen the propagated interval by the spread actually observed
+		double spread = 0.0;
+		for (size_t i = 0; i < take; ++i)
+			spread += (successes[i].delay_ms - mean_delay) * (successes[i].delay_ms - mean_delay);
+		spread = take > 1 ? spread / (double)(take - 1) : 0.0;
+
+		results[t].delay_ms = mean_delay;
+		results[t].interval_ms =
+			sqrt(sum_interval_sq / (double)(take * take) + 1.96 * 1.96 * spread / (double)take);
+		results[t].correlation = sum_corr / (double)take;
+		results[t].success = true;
+		have_result = true;
+	}
+
+	// Cleared before the result is posted, so whoever sees it can start the next average
+	pthread_mutex_lock(&dm->lock);
+	dm->average_in_progress = false;
+	pthread_mutex_unlock(&dm->lock);
+
+	if (have_result) {
+		const char *summary = instant ? "Average of buffered audio completed (top 4 used)."
+					      : "Average completed (top 4 used).";
+		const char *details = dm->debug_enabled ? notes.c_str() : summary;
+		publish_results(dm, &list, results, details, false);
+	} else {
+		set_result(dm, "Average failed", notes.empty() ? "No successful measurements" : notes.c_str(), false);
+		pthread_mutex_lock(&dm->lock);
+		dm->last_delay_valid = false;
+		pthread_mutex_unlock(&dm->lock);
+	}
+	blog(LOG_INFO, "[ADM Trace] Average Task Complete");
+}
+
+static void measure_average(audio_sync_data *dm)
+{
+	if (!dm)
+		return;
+
+	connect_targets(dm);
+
+	if (dm->pool.threads.empty()) {
+		set_result(dm, "Error", "Could not start background measurement thread.", false);
+		return;
+	}
+
+	pthread_mutex_lock(&dm->lock);
+	if (dm->average_in_progress) {
+		pthread_mutex_unlock(&dm->lock);
+		return;
+	}
+	dm->average_in_progress = true;
+	pthread_mutex_unlock(&dm->lock);
+
+	// Shown before the task is queued; an average of buffered audio can finish first otherwise
+	set_result(dm, "Averaging...", "Collecting 10 measurements.", false);
+
+	pthread_mutex_lock(&dm->lock);
+	dm->last_delay_valid = false;
+	dm->average_task = task_pool_submit(&dm->pool, measure_average_task, dm, TASK_PRIORITY_NORMAL);
+	pthread_mutex_unlock(&dm->lock);
+}
+
+static void monitor_prepare(struct monitor_state *st, size_t hop, size_t max_lag)
+{
+	const size_t nfft = next_power_of_2(hop + 2 * max_lag);
+
+	st->hop = hop;
+	st->max_lag = max_lag;
+	if (st->nfft != nfft) {
+		st->plan.reset(new pocketfft::detail::pocketfft_r<float>(nfft));
+		st->nfft = nfft;
+	}
+	st->ref_spec.assign(nfft, 0.0f);
+	st->scratch.assign(nfft, 0.0f);
+	st->anchored = false;
+}
+
+static void monitor_prepare_target(const struct monitor_state *st, struct monitor_target *mt)
+{
+	const size_t span = st->hop + 2 * st->max_lag;
+
+	mt->hist.resize(span);
+	mt->prefix.resize(span + 1);
+	mt->corr.resize(st->nfft);
+	mt->corr_acc.assign(2 * st->max_lag + 1, 0.0);
+	mt->energy_acc.assign(2 * st->max_lag + 1, 0.0);
+	mt->ref_energy_acc = 0.0;
+	mt->hops = 0;
+	mt->filter = {};
+}
+
+// Filters ring frames [start, start + frames) into dst, continuing the stream's filter state.
+// Rings bandpassed by the capture callback are copied as they are.
+static bool monitor_read(const struct audio_sync_data *dm, const sync_ring *ring, const struct capture_filter *cf,
+			 uint64_t start, size_t frames, float *dst, struct bandpass_state *state)
+{
+	const bool prefiltered = capture_prefiltered(cf);
+	sync_ring_view view;
+	if (!sync_ring_peek_at(ring, start, frames, &view))
+		return false;
+
+	struct bandpass_state next = *state;
+	if (prefiltered) {
+		sync_ring_view_read(&view, dst);
+	} else {
+		filter_ring_spans(&view, dst, &dm->engine.bp_coeffs, &next);
+	}
+	if (!sync_ring_view_valid(ring, &view) || capture_prefiltered(cf) != prefiltered)
+		return false;
+
+	*state = next;
+	return true;
+}
+
+static bool monitor_target_anchored(const struct monitor_state *st, const struct monitor_target *mt)
+{
+	return mt->anchored && mt->generation == st->generation;
+}
+
+// Starts the reference cursor max_lag behind the newest frame, leaving room for
+// targets to anchor against frames that are already buffered.
+static bool monitor_anchor_ref(const struct audio_sync_data *dm, struct monitor_state *st)
+{
+	const uint64_t ref_end = sync_ring_end(&dm->ref_ring);
+	if (ref_end < sync_ring_begin(&dm->ref_ring) + st->max_lag)
+		return false;
+
+	st->ref_pos = ref_end - st->max_lag;
+	st->ref_filter = {};
+	st->last_progress_ns = os_gettime_ns();
+	st->generation++;
+	st->anchored = true;
+	return true;
+}
+
+// Maps reference frames onto the target's through their capture timestamps (the
+// same alignment a single measurement uses) and preloads the 2 * max_lag frames
+// that precede the next hop.
+static bool monitor_anchor_target(const struct audio_sync_data *dm, const struct monitor_state *st,
+				  struct sync_target *target)
+{
+	struct monitor_target *mt = &target->monitor;
+	const size_t lag = st->max_lag;
+	uint64_t ends[2];
+	aligned_ends(dm, &target, 1, ends);
+	const uint64_t tgt_end = sync_ring_end(&target->ring);
+	const int64_t offset = (int64_t)ends[1] - (int64_t)ends[0];
+	const int64_t start = (int64_t)st->ref_pos + offset - (int64_t)lag;
+
+	if (start < (int64_t)sync_ring_begin(&target->ring) || (uint64_t)start + 2 * lag > tgt_end)
+		return false;
+
+	monitor_prepare_target(st, mt);
+	if (!monitor_read(dm, &target->ring, &target->capture, (uint64_t)start, 2 * lag, mt->hist.data(), &mt->filter))
+		return false;
+
+	mt->offset = offset;
+	mt->last_progress_ns = os_gettime_ns();
+	mt->generation = st->generation;
+	mt->anchored = true;
+	return true;
+}
+
+// True when a timestamp jump on either source re-anchored its timeline by more
+// than a hop since the target was anchored
+static bool monitor_timeline_moved(const struct audio_sync_data *dm, const struct monitor_state *st,
+				   struct sync_target *target)
+{
+	if (!sync_ring_has_time(&dm->ref_ring) || !sync_ring_has_time(&target->ring))
+		return false;
+
+	uint64_t ends[2];
+	aligned_ends(dm, &target, 1, ends);
+	const int64_t moved = (int64_t)ends[1] - (int64_t)ends[0] - target->monitor.offset;
+	return (uint64_t)(moved < 0 ? -moved : moved) > st->hop;
+}
+
+enum monitor_step_result {
+	MONITOR_STEP_DONE,
+	MONITOR_STEP_WAIT,
+	MONITOR_STEP_LOST,
+};
+
+// Consumes one hop; work depends on hop + max_lag only, never on the window length.
+// The reference block is transformed once and shared by every anchored target.
+// With `gate`, a hop without speech on the reference or on a target is still
+// read, so filters and history stay continuous, but is not transformed or
+// accumulated: the accumulators then hold the most recent voiced audio.
+static enum monitor_step_result monitor_step(const struct audio_sync_data *dm, struct monitor_state *st,
+					     const struct target_list *list, float decay, uint64_t stall_ns, bool gate)
+{
+	const size_t hop = st->hop;
+	const size_t lag = st->max_lag;
+	const size_t nfft = st->nfft;
+	const uint64_t now_ns = os_gettime_ns();
+
+	// Keep max_lag of reference frames in hand so late targets can still anchor
+	if (sync_ring_end(&dm->ref_ring) < st->ref_pos + hop + lag)
+		return MONITOR_STEP_WAIT;
+
+	for (size_t i = 0; i < list->count; ++i) {
+		sync_target *target = list->items[i].get();
+		struct monitor_target *mt = &target->monitor;
+		if (!monitor_target_anchored(st, mt))
+			continue;
+
+		const uint64_t next = (uint64_t)((int64_t)st->ref_pos + mt->offset) + lag;
+		if (sync_ring_end(&target->ring) >= next + hop)
+			continue;
+
+		// A stalled target must not hold the others back
+		if (now_ns - mt->last_progress_ns > stall_ns)
+			mt->anchored = false;
+		else
+			return MONITOR_STEP_WAIT;
+	}
+
+	float *ref_spec = st->ref_spec.data();
+	if (!monitor_read(dm, &dm->ref_ring, &dm->ref_capture, st->ref_pos, hop, ref_spec, &st->ref_filter))
+		return MONITOR_STEP_LOST;
+
+	const bool ref_voice = !gate || window_has_voice(&dm->ref_capture, st->ref_pos + hop, hop);
+	double ref_energy = 0.0;
+	if (ref_voice) {
+		for (size_t i = 0; i < hop; ++i)
+			ref_energy += (double)ref_spec[i] * (double)ref_spec[i];
+
+		std::fill(ref_spec + hop, ref_spec + nfft, 0.0f);
+		st->plan->exec(ref_spec, st->scratch.data(), 1.0f, true);
+		sync_stats_fft(dm->engine.stats, nfft, 1);
+	}
+
+	for (size_t i = 0; i < list->count; ++i) {
+		sync_target *target = list->items[i].get();
+		struct monitor_target *mt = &target->monitor;
+		if (!monitor_target_anchored(st, mt))
+			continue;
+
+		float *hist = mt->hist.data();
+		float *corr = mt->corr.data();
+		const uint64_t next = (uint64_t)((int64_t)st->ref_pos + mt->offset) + lag;
+		if (!monitor_read(dm, &target->ring, &target->capture, next, hop, hist + 2 * lag, &mt->filter)) {
+			mt->anchored = false;
+			continue;
+		}
+
+		if (ref_voice && (!gate || window_has_voice(&target->capture, next + hop, hop))) {
+			double *prefix = mt->prefix.data();
+			const size_t span = hop + 2 * lag;
+			prefix[0] = 0.0;
+			for (size_t k = 0; k < span; ++k)
+				prefix[k + 1] = prefix[k] + (double)hist[k] * (double)hist[k];
+
+			std::copy(hist, hist + span, corr);
+			std::fill(corr + span, corr + nfft, 0.0f);
+			st->plan->exec(corr, st->scratch.data(), 1.0f, true);
+			cross_spectrum_halfcomplex(ref_spec, corr, nfft);
+			st->plan->exec(corr, st->scratch.data(), 1.0f / (float)nfft, false);
+			sync_stats_fft(dm->engine.stats, nfft, 2);
+
+			// corr[k] pairs the block with target frames shifted by k - max_lag;
+			// span <= nfft so nothing wraps
+			double *corr_acc = mt->corr_acc.data();
+			double *energy_acc = mt->energy_acc.data();
+			for (size_t k = 0; k <= 2 * lag; ++k) {
+				corr_acc[k] = decay * corr_acc[k] + (double)corr[k];
+				energy_acc[k] = decay * energy_acc[k] + (prefix[k + hop] - prefix[k]);
+			}
+			mt->ref_energy_acc = decay * mt->ref_energy_acc + ref_energy;
+			mt->hops++;
+		}
+
+		memmove(hist, hist + hop, 2 * lag * sizeof(float));
+		mt->last_progress_ns = now_ns;
 	}
 
-	const uint64_t now_ns = os_gettime_ns();
-	const uint64_t max_age_ns = (uint64_t)(dm->window_ms + dm->max_lag_ms + 200u) * 1000000ULL;
+	st->ref_pos += hop;
+	st->last_progress_ns = now_ns;
+	return MONITOR_STEP_DONE;
+}
 
-	if (!has_recent_audio(last_ref_ns, now_ns, max_age_ns)) {
-		out.status = "Reference inactive";
+static bool monitor_value(const struct monitor_target *mt, size_t k, double *value)
+{
+	const double denom = sqrt(mt->ref_energy_acc * mt->energy_acc[k]);
+	if (denom < 1e-8)
 		return false;
+	*value = mt->corr_acc[k] / denom;
+	return true;
+}
+
+// Peak of the accumulated correlation with parabolic sub-sample refinement.
+// interval_out is the ~95% half-width in frames.
+static bool monitor_peak(const struct audio_sync_data *dm, const struct monitor_state *st,
+			 const struct monitor_target *mt, float decay, double *lag_out, double *corr_out,
+			 double *interval_out)
+{
+	double best_corr = -1.0;
+	size_t best_k = 0;
+
+	for (size_t k = 0; k <= 2 * st->max_lag; ++k) {
+		double corr;
+		if (!monitor_value(mt, k, &corr))
+			continue;
+		if (corr > best_corr) {
+			best_corr = corr;
+			best_k = k;
+		}
 	}
 
-	if (!has_recent_audio(last_tgt_ns, now_ns, max_age_ns)) {
-		out.status = "Target inactive";
+	if (best_corr < 0.0)
 		return false;
+
+	double offset = 0.0;
+	double interval = 0.5;
+	double before = 0.0;
+	double after = 0.0;
+	double curvature = 0.0;
+	if (best_k > 0 && best_k < 2 * st->max_lag && monitor_value(mt, best_k - 1, &before) &&
+	    monitor_value(mt, best_k + 1, &after) &&
+	    lag_search_parabolic(before, best_corr, after, &offset, &curvature)) {
+		// Effective length of the exponentially weighted history: hop * (1 + decay) / (1 - decay)
+		const double history = (double)st->hop * (1.0 + decay) / (1.0 - decay);
+		interval = lag_search_interval(best_corr, curvature,
+					       effective_samples(history, dm->engine.sample_rate));
 	}
 
-	double delay_ms = 0.0;
-	double corr = 0.0;
-	if (!estimate_delay(dm, &delay_ms, &corr)) {
-		out.status = "Insufficient correlation";
+	*lag_out = (double)best_k - (double)st->max_lag + offset;
+	*corr_out = best_corr;
+	*interval_out = interval;
+	return true;
+}
+
+// monitor_value() by lag instead of accumulator index
+struct monitor_curve_source {
+	const struct monitor_target *mt;
+	int max_lag;
+};
+
+static bool monitor_curve_value(const void *param, int lag, double *value)
+{
+	const struct monitor_curve_source *src = static_cast<const struct monitor_curve_source *>(param);
+	return monitor_value(src->mt, (size_t)(lag + src->max_lag), value);
+}
+
+// The accumulated correlation around the peak monitor_peak() found, for the dock
+static void monitor_curve(const struct audio_sync_data *dm, const struct monitor_state *st,
+			  const struct monitor_target *mt, double lag_frames, struct sync_curve *curve)
+{
+	const struct monitor_curve_source src = {mt, (int)st->max_lag};
+	const double lag_ms = 1000.0 / (double)dm->engine.sample_rate;
+	int first;
+	int last;
+	sync_curve_range((int)std::lround(lag_frames), src.max_lag, lag_ms, &first, &last);
+	sync_curve_build(curve, first, last, lag_ms, monitor_curve_value, &src);
+	curve->peak_ms = lag_frames * lag_ms;
+}
+
+// One offset to write, decided under dm->lock and written after it is released
+struct auto_apply_action {
+	obs_source_t *source;
+	int64_t offset_ns;
+};
+
+// Closed loop over the monitor's results.  A target whose delay has moved more
+// than the drift tolerance away from the applied compensation, stayed within
+// one tolerance of itself for AUTO_APPLY_STABLE_MS with every result above the
+// correlation threshold, and was not adjusted in the last
+// AUTO_APPLY_MIN_INTERVAL_MS gets the run's mean delay applied.  A run is only
+// abandoned once the error falls below half the tolerance, so a delay sitting
+// near the threshold does not toggle.
+//
+// A single target is compensated on the reference, as Apply does.  With several,
+// each target's own offset is set, since they can drift apart.
+static void auto_apply_results(struct audio_sync_data *dm, const struct target_list *list,
+			       const measurement_sample *samples)
+{
+	const uint64_t now_ns = os_gettime_ns();
+	struct auto_apply_action actions[MAX_TARGETS];
+	size_t action_count = 0;
+
+	pthread_mutex_lock(&dm->lock);
+	if (!dm->auto_apply || !dm->ref || !list->count) {
+		pthread_mutex_unlock(&dm->lock);
+		return;
+	}
+	const double tolerance = dm->drift_tolerance_ms;
+	const int64_t ref_offset = obs_source_get_sync_offset(dm->ref);
+
+	for (size_t i = 0; i < list->count; ++i) {
+		sync_target *t = list->items[i].get();
+		struct auto_apply_state *st = &t->auto_apply;
+		const measurement_sample &s = samples[i];
+		if (!t->source || !s.success) {
+			st->run_count = 0;
+			continue;
+		}
+
+		const int64_t tgt_offset = obs_source_get_sync_offset(t->source);
+		const double error = s.delay_ms - (double)(ref_offset - tgt_offset) / 1e6;
+		if (fabs(error) < 0.5 * tolerance) {
+			st->run_count = 0;
+			continue;
+		}
+		if (!st->run_count && fabs(error) <= tolerance)
+			continue;
+
+		// Start over whenever the run stops being one steady delay
+		const double spread = std::max(st->run_max_ms, s.delay_ms) - std::min(st->run_min_ms, s.delay_ms);
+		if (!st->run_count || spread > tolerance) {
+			st->run_start_ns = now_ns;
+			st->run_min_ms = st->run_max_ms = s.delay_ms;
+			st->run_sum_ms = 0.0;
+			st->run_count = 0;
+		}
+		st->run_min_ms = std::min(st->run_min_ms, s.delay_ms);
+		st->run_max_ms = std::max(st->run_max_ms, s.delay_ms);
+		st->run_sum_ms += s.delay_ms;
+		st->run_count++;
+
+		if (now_ns - st->run_start_ns < AUTO_APPLY_STABLE_MS * 1000000ULL ||
+		    (st->last_apply_ns && now_ns - st->last_apply_ns < AUTO_APPLY_MIN_INTERVAL_MS * 1000000ULL))
+			continue;
+
+		const double delay_ms = st->run_sum_ms / (double)st->run_count;
+		const int64_t delay_ns = (int64_t)llround(delay_ms * 1000000.0);
+		obs_source_t *source = list->count == 1 ? dm->ref : t->source;
+		const int64_t old_ns = list->count == 1 ? ref_offset : tgt_offset;
+		const int64_t new_ns = list->count == 1 ? delay_ns + tgt_offset : ref_offset - delay_ns;
+		actions[action_count++] = {obs_source_get_ref(source), new_ns};
+		st->last_apply_ns = now_ns;
+		st->run_count = 0;
+
+		char event[256];
+		const time_t now = time(nullptr);
+		char timestamp[10];
+		strftime(timestamp, sizeof(timestamp), "%H:%M:%S", localtime(&now));
+		snprintf(event, sizeof(event), "%s '%s' %+.2f ms (was %+.2f off): %s offset %+.1f -> %+.1f ms",
+			 timestamp, target_name(t)->c_str(), delay_ms, error, list->count == 1 ? "reference" : "target",
+			 (double)old_ns / 1e6, (double)new_ns / 1e6);
+		blog(LOG_INFO, "[ADM] Auto apply: %s", event + strlen(timestamp) + 1);
+		if (dm->auto_apply_events.size() == AUTO_APPLY_HISTORY)
+			dm->auto_apply_events.erase(dm->auto_apply_events.begin());
+		dm->auto_apply_events.push_back(event);
+	}
+	pthread_mutex_unlock(&dm->lock);
+
+	for (size_t i = 0; i < action_count; ++i) {
+		if (!actions[i].source)
+			continue;
+		obs_source_set_sync_offset(actions[i].source, actions[i].offset_ns);
+		obs_source_release(actions[i].source);
+	}
+}
+
+// Consumes every hop the rings hold and publishes the result.  Returns how long
+// to wait before the next pass.
+static uint32_t monitor_pass(audio_sync_data *dm)
+{
+	struct monitor_state *st = &dm->monitor;
+
+	// This pass is the only one running, so it can follow an audio reset itself
+	uint32_t rate;
+	size_t channels;
+	if (audio_output_changed(dm, &rate, &channels)) {
+		apply_audio_output(dm, rate, channels);
+		st->anchored = false;
+		set_result(dm, "Monitor", "Audio output changed; waiting for audio on both sources...", false);
+		return 0;
+	}
+
+	const size_t hop = ms_to_samples(MONITOR_HOP_MS, dm->engine.sample_rate);
+
+	pthread_mutex_lock(&dm->lock);
+	const uint32_t window_ms = dm->window_ms;
+	const uint32_t max_lag_ms = dm->max_lag_ms;
+	const float corr_threshold = dm->corr_threshold;
+	const bool gate = dm->voice_gate;
+	pthread_mutex_unlock(&dm->lock);
+
+	struct target_list list;
+	snapshot_targets(dm, &list);
+
+	const size_t lag = ms_to_samples(max_lag_ms, dm->engine.sample_rate);
+	if (st->hop != hop || st->max_lag != lag)
+		monitor_prepare(st, hop, lag);
+
+	if (!dm->ref || !list.count) {
+		st->anchored = false;
+		return MONITOR_HOP_MS;
+	}
+
+	if (!st->anchored && !monitor_anchor_ref(dm, st))
+		return MONITOR_HOP_MS;
+
+	for (size_t i = 0; i < list.count; ++i) {
+		sync_target *target = list.items[i].get();
+		if (target->source && monitor_target_anchored(st, &target->monitor) &&
+		    monitor_timeline_moved(dm, st, target))
+			target->monitor.anchored = false;
+		if (target->source && !monitor_target_anchored(st, &target->monitor))
+			monitor_anchor_target(dm, st, target);
+	}
+
+	const uint64_t stall_ns = (uint64_t)(window_ms + max_lag_ms) * 1000000ULL;
+	const float decay = expf(-(float)MONITOR_HOP_MS / (float)window_ms);
+	size_t hops_done = 0;
+	enum monitor_step_result step;
+	while ((step = monitor_step(dm, st, &list, decay, stall_ns, gate)) == MONITOR_STEP_DONE)
+		hops_done++;
+
+	// Re-align if we fell out of the reference ring, it was switched or it went quiet
+	if (step == MONITOR_STEP_LOST || os_gettime_ns() - st->last_progress_ns > stall_ns) {
+		st->anchored = false;
+		set_result(dm, "Monitor", "Waiting for audio on both sources...", false);
+		return 0;
+	}
+
+	if (hops_done) {
+		// Report once the accumulators span roughly one analysis window
+		measurement_sample samples[MAX_TARGETS];
+		struct sync_curve curves[MAX_TARGETS];
+		for (size_t i = 0; i < list.count; ++i) {
+			const struct monitor_target *mt = &list.items[i]->monitor;
+			double lag_frames = 0.0;
+			double corr = 0.0;
+			double interval = 0.0;
+
+			if (!monitor_target_anchored(st, mt)) {
+				samples[i].status = "Waiting for audio";
+			} else if (mt->hops * MONITOR_HOP_MS < window_ms) {
+				samples[i].status = "Collecting audio";
+			} else if (monitor_peak(dm, st, mt, decay, &lag_frames, &corr, &interval)) {
+				monitor_curve(dm, st, mt, lag_frames, &curves[i]);
+				samples[i].curve = &curves[i];
+				samples[i].correlation = corr;
+				if (corr >= corr_threshold) {
+					samples[i].delay_ms = lag_frames * 1000.0 / (double)dm->engine.sample_rate;
+					samples[i].interval_ms = interval * 1000.0 / (double)dm->engine.sample_rate;
+					samples[i].success = true;
+				} else {
+					samples[i].status = "Insufficient correlation";
+				}
+			} else {
+				samples[i].status = "Silence";
+			}
+		}
+		auto_apply_results(dm, &list, samples);
+		publish_results(dm, &list, samples, "Monitoring", true);
+	}
+
+	return MONITOR_HOP_MS / 2;
+}
+
+static void monitor_task(void *param);
+
+// Queues the next pass unless stop_monitor() has been called.  Only one pass is
+// ever pending or running, so the monitor state needs no lock of its own.
+static void monitor_schedule(audio_sync_data *dm, uint32_t delay_ms)
+{
+	pthread_mutex_lock(&dm->lock);
+	if (!dm->monitor_stop)
+		dm->monitor_task = task_pool_submit(&dm->pool, monitor_task, dm, TASK_PRIORITY_NORMAL, delay_ms);
+	pthread_mutex_unlock(&dm->lock);
+}
+
+static void monitor_task(void *param)
+{
+	auto *dm = static_cast<audio_sync_data *>(param);
+	const uint64_t start_ns = sync_stats_now_ns();
+	const uint32_t delay_ms = monitor_pass(dm);
+	sync_stats_since(&dm->stats, SYNC_STAT_MONITOR, start_ns);
+	monitor_schedule(dm, delay_ms);
+}
+
+// Schedules the first pass of a stopped monitor on the sources already
+// connected, so any thread can call it.  False if it was running.
+static bool resume_monitor(audio_sync_data *dm)
+{
+	pthread_mutex_lock(&dm->lock);
+	if (dm->monitor_active) {
+		pthread_mutex_unlock(&dm->lock);
 		return false;
 	}
+	dm->monitor_stop = false;
+	dm->monitor_active = true;
+	dm->monitor.anchored = false;
+	pthread_mutex_unlock(&dm->lock);
 
-	out.delay_ms = delay_ms;
-	out.correlation = corr;
-	out.success = true;
-	out.status.clear();
+	monitor_schedule(dm, 0);
 	return true;
 }
 
-static bool perform_measure(struct audio_sync_data *dm)
+static void start_monitor(audio_sync_data *dm)
 {
-	if (dm->debug_enabled) {
-		blog(LOG_INFO, "[ADM DIAG] Starting measurement");
-	}
+	if (!dm)
+		return;
 
 	if (!dm->ref && !dm->ref_name.empty())
 		connect_ref(dm);
-	if (!dm->target && !dm->target_name.empty())
-		connect_target(dm);
+	connect_targets(dm);
 
-	if (!dm || !dm->target || !dm->ref) {
-		set_result(dm, "---", "Select both reference and target sources.", false);
-		return false;
+	if (dm->pool.threads.empty()) {
+		set_result(dm, "Error", "Could not start monitor thread.", false);
+		return;
 	}
 
-	uint64_t last_ref_ns = 0;
-	uint64_t last_tgt_ns = 0;
+	if (resume_monitor(dm))
+		set_result(dm, "Monitor", "Monitoring started.", false);
+}
+
+static void stop_monitor(audio_sync_data *dm)
+{
+	if (!dm)
+		return;
+
 	pthread_mutex_lock(&dm->lock);
-	if (dm->debug_enabled) {
-		blog(LOG_INFO, "[ADM DIAG] ref=%zu tgt=%zu", dm->ref_count, dm->tgt_count);
+	const bool active = dm->monitor_active;
+	dm->monitor_stop = true;
+	const task_handle pass = dm->monitor_task;
+	pthread_mutex_unlock(&dm->lock);
+	if (!active)
+		return;
+
+	// No pass is queued after monitor_stop was set, so this is the last one:
+	// drop it if it is still waiting, or let it finish
+	task_pool_cancel(&dm->pool, pass);
+	task_pool_wait(&dm->pool, pass);
+
+	pthread_mutex_lock(&dm->lock);
+	dm->monitor_active = false;
+	dm->monitor_task.reset();
+	pthread_mutex_unlock(&dm->lock);
+	blog(LOG_INFO, "[ADM Trace] Monitor Stopped");
+}
+
+// Reallocates every capture ring in the new precision.  The rings are rebuilt
+// with their callbacks detached, the monitor stopped and the workspace lock held,
+// so neither the audio thread nor a measurement can touch the old storage.
+// Buffered audio is dropped.
+static void set_ring_format(struct audio_sync_data *dm, enum sample_format format)
+{
+	if (format == dm->ring_format)
+		return;
+
+	pthread_mutex_lock(&dm->lock);
+	const bool monitor = dm->monitor_active;
+	pthread_mutex_unlock(&dm->lock);
+	if (monitor)
+		stop_monitor(dm);
+
+	struct target_list list;
+	snapshot_targets(dm, &list);
+
+	pthread_mutex_lock(&dm->workspace_lock);
+	if (dm->ref)
+		detach_capture(dm, dm->ref, capture_ref, dm);
+	sync_ring_init(&dm->ref_ring, dm->capacity, format);
+	dm->ref_capture.state = {};
+	if (dm->ref)
+		attach_capture(dm, dm->ref, capture_ref, dm);
+
+	for (size_t i = 0; i < list.count; ++i) {
+		struct sync_target *target = list.items[i].get();
+		if (target->source)
+			detach_capture(dm, target->source, capture_target, target);
+		sync_ring_init(&target->ring, dm->capacity, format);
+		target->capture.state = {};
+		if (target->source)
+			attach_capture(dm, target->source, capture_target, target);
 	}
-	bool enough = dm->ref_count >= 1024 && dm->tgt_count >= 1024;
-	last_ref_ns = dm->last_ref_ns;
-	last_tgt_ns = dm->last_tgt_ns;
+
+	pthread_mutex_lock(&dm->lock);
+	dm->ring_format = format;
 	pthread_mutex_unlock(&dm->lock);
+	pthread_mutex_unlock(&dm->workspace_lock);
 
-	const uint64_t now_ns = os_gettime_ns();
-	const uint64_t max_age_ns = (uint64_t)(dm->window_ms + dm->max_lag_ms + 200u) * 1000000ULL; // grace window
+	blog(LOG_INFO, "[ADM] Capture rings now store %s samples (%zu KiB per source)", sample_format_name(format),
+	     dm->capacity * sample_format_size(format) / 1024);
 
-	if (!has_recent_audio(last_ref_ns, now_ns, max_age_ns)) {
-		set_result(dm, "---", "No recent audio on reference source.", false);
+	if (monitor)
+		start_monitor(dm);
+}
+
+// Sizes one capture ring for a new rate; its callback is detached.  True when it reallocated.
+static bool resize_capture(sync_ring *ring, struct capture_filter *cf, size_t frames)
+{
+	const bool reallocated = sync_ring_resize(ring, frames);
+	if (reallocated)
+		voice_activity_init(&cf->vad, ring->capacity);
+	cf->state = {};
+	cf->timing_set.store(false, std::memory_order_relaxed);
+	cf->resume = false;
+	return reallocated;
+}
+
+// The audio output's format when it differs from the one the rings were sized
+// for.  OBS announces no audio reset, so every measurement, monitor pass and
+// API request polls it.
+static bool audio_output_changed(struct audio_sync_data *dm, uint32_t *rate, size_t *channels)
+{
+	audio_t *audio = obs_get_audio();
+	if (!audio)
 		return false;
+	*rate = audio_output_get_sample_rate(audio);
+	*channels = std::min<size_t>(std::max<size_t>(audio_output_get_channels(audio), 1), MAX_AV_PLANES);
+
+	pthread_mutex_lock(&dm->lock);
+	const bool changed = *rate && (*rate != dm->engine.sample_rate || *channels != dm->channels);
+	pthread_mutex_unlock(&dm->lock);
+	return changed;
+}
+
+// Resizes everything for a new output format.  A new rate redesigns the bandpass
+// and sizes the rings for BUFFER_SECONDS again, in place when their power-of-two
+// capacity holds, as it does between 44.1 and 48 kHz; a new channel count changes
+// what the callbacks downmix.  Applied like set_ring_format(), with the callbacks
+// detached and the workspace lock held; the caller keeps the monitor from running.
+// Audio buffered at the old format is dropped.
+static void apply_audio_output(struct audio_sync_data *dm, uint32_t rate, size_t channels)
+{
+	struct target_list list;
+	snapshot_targets(dm, &list);
+
+	pthread_mutex_lock(&dm->workspace_lock);
+	pthread_mutex_lock(&dm->lock);
+	const bool current = rate == dm->engine.sample_rate && channels == dm->channels;
+	pthread_mutex_unlock(&dm->lock);
+	if (current) {
+		// Another thread followed the same change first
+		pthread_mutex_unlock(&dm->workspace_lock);
+		return;
 	}
 
-	if (!has_recent_audio(last_tgt_ns, now_ns, max_age_ns)) {
-		set_result(dm, "---", "No recent audio on target source.", false);
-		return false;
+	if (dm->ref)
+		detach_capture(dm, dm->ref, capture_ref, dm);
+	for (size_t i = 0; i < list.count; ++i) {
+		struct sync_target *target = list.items[i].get();
+		if (target->source)
+			detach_capture(dm, target->source, capture_target, target);
 	}
 
-	if (!enough) {
-		set_result(dm, "---", "Need more buffered audio from both reference and target before measuring.",
-			   false);
-		return false;
+	const size_t frames = ms_to_samples(BUFFER_SECONDS * 1000u, rate);
+	const bool reallocated = resize_capture(&dm->ref_ring, &dm->ref_capture, frames);
+	for (size_t i = 0; i < list.count; ++i)
+		resize_capture(&list.items[i]->ring, &list.items[i]->capture, frames);
+
+	pthread_mutex_lock(&dm->lock);
+	sync_engine_set_sample_rate(&dm->engine, rate);
+	dm->capacity = dm->ref_ring.capacity;
+	dm->channels = channels;
+	pthread_mutex_unlock(&dm->lock);
+
+	if (dm->ref)
+		attach_capture(dm, dm->ref, capture_ref, dm);
+	for (size_t i = 0; i < list.count; ++i) {
+		struct sync_target *target = list.items[i].get();
+		if (target->source)
+			attach_capture(dm, target->source, capture_target, target);
 	}
+	pthread_mutex_unlock(&dm->workspace_lock);
 
-	double delay_ms = 0.0;
-	double corr = 0.0;
+	blog(LOG_WARNING, "[ADM] Audio output now %u Hz, %zu channels; buffered audio dropped, rings %s (%zu frames)",
+	     rate, channels, reallocated ? "reallocated" : "kept", dm->capacity);
+}
 
-	blog(LOG_INFO, "[ADM] Estimating Audio Delay");
-	if (estimate_delay(dm, &delay_ms, &corr)) {
-		std::string target_name_copy;
+// Follows the audio output through an audio reset from any thread but a monitor
+// pass, which calls apply_audio_output() itself.  A running monitor is stopped
+// around the change and picks up again without reconnecting sources.
+static void follow_audio_output(struct audio_sync_data *dm)
+{
+	uint32_t rate;
+	size_t channels;
+	if (!audio_output_changed(dm, &rate, &channels))
+		return;
 
-		pthread_mutex_lock(&dm->lock);
-		target_name_copy = dm->target_name;
-		dm->last_correlation = (float)corr;
+	pthread_mutex_lock(&dm->lock);
+	const bool monitor = dm->monitor_active;
+	pthread_mutex_unlock(&dm->lock);
+	if (monitor)
+		stop_monitor(dm);
+
+	apply_audio_output(dm, rate, channels);
+
+	if (monitor)
+		resume_monitor(dm);
+}
+
+// Makes the given row of the result table drive the headline and Apply
+static void select_target(audio_sync_data *dm, size_t index)
+{
+	pthread_mutex_lock(&dm->lock);
+	if (index >= dm->targets.size() || index == dm->selected_target) {
+		pthread_mutex_unlock(&dm->lock);
+		return;
+	}
+	dm->selected_target = index;
+	const sync_target *t = dm->targets[index].get();
+	dm->last_delay_text = t->delay_text;
+	dm->last_delay_ms = t->delay_ms;
+	dm->last_correlation = t->correlation;
+	dm->last_delay_valid = t->valid;
+	pthread_mutex_unlock(&dm->lock);
+
+	update_dock_ui(dm);
+}
+
+static void apply_sync_offset(audio_sync_data *dm)
+{
+	if (!dm)
+		return;
+
+	pthread_mutex_lock(&dm->lock);
+	bool valid = dm->last_delay_valid;
+	double delay_ms = dm->last_delay_ms;
+	pthread_mutex_unlock(&dm->lock);
+
+	if (!valid) {
+		set_result(dm, "No Data", "Run Measure Now before applying offset.", false);
+		return;
+	}
+
+	obs_source_t *ref = nullptr;
+	pthread_mutex_lock(&dm->lock);
+	ref = dm->ref ? obs_source_get_ref(dm->ref) : nullptr;
+	pthread_mutex_unlock(&dm->lock);
+
+	if (!ref) {
+		set_result(dm, "No Reference", "Select a reference source first.", false);
+		return;
+	}
+
+	int64_t offset_ns = (int64_t)llround(delay_ms * 1000000.0);
+	obs_source_set_sync_offset(ref, offset_ns);
+	obs_source_release(ref);
+
+	char msg[128];
+	snprintf(msg, sizeof(msg), "✓ %+0.1f", delay_ms);
+	set_result(dm, msg, "Sync Offset updated on reference source.", true);
+}
+
+// Tenths of the recording done, so the dock updates ten times per file
+struct offline_progress {
+	struct audio_sync_data *dm;
+	uint64_t shown;
+};
+
+static bool offline_progress_cb(void *param, uint64_t done, uint64_t total)
+{
+	auto *progress = static_cast<struct offline_progress *>(param);
+	struct audio_sync_data *dm = progress->dm;
+
+	pthread_mutex_lock(&dm->lock);
+	const bool stop = task_cancelled(dm->offline_task);
+	pthread_mutex_unlock(&dm->lock);
+
+	const uint64_t tenth = done * 10 / total;
+	if (!stop && tenth > progress->shown && done < total) {
+		progress->shown = tenth;
+		char notes[64];
+		snprintf(notes, sizeof(notes), "%llu of %llu windows measured.", (unsigned long long)done,
+			 (unsigned long long)total);
+		post_result(dm, "Analyzing...", notes, false, true);
+	}
+	return !stop;
+}
+
+// Channel 0 of the recording is the reference and each further channel a
+// target.  Runs at low priority so live measurements are not queued behind it.
+static void offline_analysis_task(void *param)
+{
+	auto *dm = static_cast<audio_sync_data *>(param);
+
+	pthread_mutex_lock(&dm->lock);
+	const std::string path = dm->offline_path;
+	pthread_mutex_unlock(&dm->lock);
+
+	struct wav_file wav;
+	std::string error;
+	std::string notes;
+	bool ok = wav_open(&wav, path.c_str(), &error);
+	if (ok && wav.channels < 2) {
+		error = "Recording needs a reference channel and at least one target channel";
+		ok = false;
+	}
+
+	if (ok) {
+		struct offline_track ref = {&wav, 0, "channel 0"};
+		std::vector<struct offline_track> targets;
+		for (uint32_t c = 1; c < wav.channels && targets.size() < MAX_TARGETS; ++c)
+			targets.push_back({&wav, (int)c, "channel " + std::to_string(c)});
+
+		struct offline_settings settings;
+		settings.engine = read_measure_params(dm);
+		// This task already holds one pool thread; leave one more free for live work
+		settings.workers = std::max<size_t>(1, dm->pool.threads.size() - 1);
+
+		// Keeps offline windows out of the live stage timings
+		struct sync_engine engine = dm->engine;
+		engine.stats = nullptr;
+
+		const uint64_t start_ns = os_gettime_ns();
+		struct offline_progress progress = {dm, 0};
+		std::vector<struct offline_window> windows;
+		ok = offline_analyze(&engine, &settings, &ref, targets.data(), targets.size(), offline_progress_cb,
+				     &progress, &windows, &error);
+
+		if (ok) {
+			const std::string csv_path = path + ".sync.csv";
+			notes = offline_summary(targets.data(), targets.size(), windows);
+			if (offline_write_csv(csv_path.c_str(), targets.data(), targets.size(), windows))
+				notes += "\nDelay curve written to " + csv_path;
+			else
+				notes += "\nCould not write " + csv_path;
+			blog(LOG_INFO, "[ADM] Analyzed %zu windows of %s in %.1f s", windows.size(), path.c_str(),
+			     (double)(os_gettime_ns() - start_ns) / 1e9);
+		}
+	}
+	wav_close(&wav);
+
+	if (ok) {
+		set_result(dm, "Analyzed", notes.c_str(), false);
+	} else {
+		blog(LOG_WARNING, "[ADM] Analysis of %s failed: %s", path.c_str(), error.c_str());
+		set_result(dm, "Analysis failed", error.c_str(), false);
+	}
+
+	pthread_mutex_lock(&dm->lock);
+	dm->offline_path.clear();
+	pthread_mutex_unlock(&dm->lock);
+}
+
+static void analyze_file(audio_sync_data *dm, const std::string &path)
+{
+	if (dm->pool.threads.empty()) {
+		set_result(dm, "Error", "Could not start background measurement thread.", false);
+		return;
+	}
+
+	pthread_mutex_lock(&dm->lock);
+	if (!dm->offline_path.empty()) {
 		pthread_mutex_unlock(&dm->lock);
+		return;
+	}
+	dm->offline_path = path;
+	pthread_mutex_unlock(&dm->lock);
+
+	set_result(dm, "Analyzing...", path.c_str(), false);
+
+	pthread_mutex_lock(&dm->lock);
+	dm->offline_task = task_pool_submit(&dm->pool, offline_analysis_task, dm, TASK_PRIORITY_LOW);
+	pthread_mutex_unlock(&dm->lock);
+}
+
+// ──────────────────────────────────────────────────────────────
+//  Scripting API
+// ──────────────────────────────────────────────────────────────
 
-		char buffer[256];
-		snprintf(buffer, sizeof(buffer), "%+6.1f ms", delay_ms);
-		char notes_buf[256];
-		if (delay_ms > 0) {
-			snprintf(notes_buf, sizeof(notes_buf), "Target '%s' lags reference by %.1f ms (corr=%.2f)",
-				 !target_name_copy.empty() ? target_name_copy.c_str() : "<target>", delay_ms, corr);
-		} else if (delay_ms < 0) {
-			snprintf(notes_buf, sizeof(notes_buf), "Target '%s' leads reference by %.1f ms (corr=%.2f)",
-				 !target_name_copy.empty() ? target_name_copy.c_str() : "<target>", fabs(delay_ms),
-				 corr);
-		} else {
-			snprintf(notes_buf, sizeof(notes_buf), "Target '%s' is aligned with reference (corr=%.2f)",
-				 !target_name_copy.empty() ? target_name_copy.c_str() : "<target>", corr);
-		}
+// Every request takes a JSON object and answers with one holding "ok" and, on
+// failure, "error".  They are offered as obs-websocket vendor requests
+// (CallVendorRequest to API_VENDOR_NAME) and as procedures on the global proc
+// handler that take and return the JSON as strings.  None of them waits for a
+// measurement, so obs-websocket's thread is never held up: the work goes to the
+// UI thread, which owns the source connections, in the order requests arrive.
+// Measure, Average and Apply answer with the result sequence number current when
+// they were accepted.  Their outcome is the next non-live result after it, sent
+// as a ResultPublished vendor event and readable with GetLastResult; an average
+// first posts that it has started, with "averaging" still true.
+#define API_VENDOR_NAME "audio-sync-analyzer"
+
+typedef void (*api_handler_fn)(struct audio_sync_data *dm, obs_data_t *request, obs_data_t *response);
+
+struct api_request {
+	// Vendor request type, and the procedure taking the same JSON
+	const char *type;
+	const char *proc;
+	api_handler_fn handler;
+};
 
-		set_result(dm, buffer, notes_buf, true);
-		dm->last_delay_ms = delay_ms;
-		dm->last_delay_valid = true;
-		return true;
-	}
+// Reference and targets given to SetSources; either can be left as it is
+struct api_sources {
+	bool set_ref = false;
+	std::string ref;
+	bool set_targets = false;
+	std::vector<std::string> targets;
+};
 
-	set_result(dm, "---", "Insufficient correlation; ensure both sources carry similar program audio.", false);
-	return false;
-}
+// Set once obs-websocket has accepted the vendor; g_vendor_open is cleared
+// when its requests are dropped, after which no events are sent either
+static struct websocket_vendor g_vendor;
+static std::atomic<bool> g_vendor_open{false};
 
-static void measure_now(audio_sync_data *dm)
+static void api_fail(obs_data_t *response, const char *error)
 {
-	perform_measure(dm);
+	obs_data_set_bool(response, "ok", false);
+	obs_data_set_string(response, "error", error);
 }
 
-static void *measure_average_worker(void *param)
+// Called before the work is queued, so its result always comes after `sequence`
+static void api_accept(struct audio_sync_data *dm, obs_data_t *response)
 {
-	auto *dm = static_cast<audio_sync_data *>(param);
-	if (!dm)
-		return nullptr;
-
-	std::vector<measurement_sample> samples;
-	samples.reserve(10);
+	pthread_mutex_lock(&dm->lock);
+	const uint64_t sequence = dm->result_seq;
+	pthread_mutex_unlock(&dm->lock);
 
-	for (int i = 0; i < 10; ++i) {
-		pthread_mutex_lock(&dm->lock);
-		bool stop = dm->average_stop;
-		pthread_mutex_unlock(&dm->lock);
-		if (stop)
-			break;
+	obs_data_set_bool(response, "ok", true);
+	obs_data_set_int(response, "sequence", (long long)sequence);
+}
 
-		measurement_sample sample;
-		try_measure_once(dm, sample);
-		samples.push_back(sample);
+// Count, latest, mean, p50/p99 (bucket upper edges) and max in ms of every stage that has run
+static obs_data_t *api_timings(const struct sync_stats *stats)
+{
+	obs_data_t *timings = obs_data_create();
+	for (int s = 0; s < SYNC_STAT_COUNT; ++s) {
+		const struct stat_histogram *h = &stats->stages[s];
+		const uint64_t count = h->count.load(std::memory_order_relaxed);
+		if (count == 0)
+			continue;
 
-		if (i < 9)
-			os_sleep_ms(400);
+		obs_data_t *stage = obs_data_create();
+		obs_data_set_int(stage, "count", (long long)count);
+		obs_data_set_double(stage, "last_ms", (double)h->last_ns.load(std::memory_order_relaxed) / 1e6);
+		obs_data_set_double(stage, "mean_ms",
+				    (double)(h->total_ns.load(std::memory_order_relaxed) / count) / 1e6);
+		obs_data_set_double(stage, "p50_ms", (double)stat_histogram_quantile(h, 0.5) / 1e6);
+		obs_data_set_double(stage, "p99_ms", (double)stat_histogram_quantile(h, 0.99) / 1e6);
+		obs_data_set_double(stage, "max_ms", (double)h->max_ns.load(std::memory_order_relaxed) / 1e6);
+		obs_data_set_obj(timings, sync_stat_key((enum sync_stat)s), stage);
+		obs_data_release(stage);
 	}
+	return timings;
+}
 
-	std::string notes;
-	std::vector<measurement_sample> successes;
-	successes.reserve(samples.size());
+// The latest result per target, what is still running and the stage timings
+static void api_write_result(struct audio_sync_data *dm, obs_data_t *out)
+{
+	const double now_s = (double)os_gettime_ns() / 1e9;
+	obs_data_array_t *targets = obs_data_array_create();
 
-	for (size_t i = 0; i < samples.size(); ++i) {
-		const auto &s = samples[i];
-		if (s.success) {
-			successes.push_back(s);
+	pthread_mutex_lock(&dm->lock);
+	obs_data_set_int(out, "sequence", (long long)dm->result_seq);
+	obs_data_set_bool(out, "live", dm->result_live);
+	obs_data_set_string(out, "time", dm->last_time_text.c_str());
+	obs_data_set_string(out, "headline", dm->last_delay_text.c_str());
+	obs_data_set_string(out, "message", dm->last_notes_text.c_str());
+	obs_data_set_bool(out, "valid", dm->last_delay_valid);
+	if (dm->last_delay_valid)
+		obs_data_set_double(out, "delay_ms", dm->last_delay_ms);
+	obs_data_set_string(out, "reference", dm->ref_name.c_str());
+	obs_data_set_int(out, "selected_target", (long long)dm->selected_target);
+	obs_data_set_bool(out, "averaging", dm->average_in_progress);
+	obs_data_set_bool(out, "monitoring", dm->monitor_active);
+	for (const auto &target : dm->targets) {
+		const sync_target *t = target.get();
+		obs_data_t *item = obs_data_create();
+		obs_data_set_string(item, "name", target_name(t)->c_str());
+		obs_data_set_bool(item, "connected", t->source != nullptr);
+		obs_data_set_bool(item, "success", t->valid);
+		obs_data_set_string(item, "status", t->status.c_str());
+		obs_data_set_double(item, "correlation", t->correlation);
+		if (t->valid) {
+			obs_data_set_double(item, "delay_ms", t->delay_ms);
+			obs_data_set_double(item, "interval_ms", t->interval_ms);
 		}
-		if (dm->debug_enabled) {
-			char line[160];
-			if (s.success) {
-				snprintf(line, sizeof(line), "%2zu: %+6.1f ms (corr=%.2f)", i + 1, s.delay_ms,
-					 s.correlation);
-			} else {
-				snprintf(line, sizeof(line), "%2zu: fail (%s)", i + 1, s.status.c_str());
-			}
-			if (!notes.empty())
-				notes += "\n";
-			notes += line;
+		struct drift_fit fit;
+		if (drift_estimate(&t->drift, now_s, &fit)) {
+			obs_data_set_double(item, "drift_ppm", fit.ppm);
+			obs_data_set_double(item, "drift_interval_ppm", fit.ppm_interval);
 		}
+		obs_data_array_push_back(targets, item);
+		obs_data_release(item);
 	}
+	pthread_mutex_unlock(&dm->lock);
 
-	double avg_delay = 0.0;
-	double avg_corr = 0.0;
-	bool have_result = false;
+	obs_data_set_array(out, "targets", targets);
+	obs_data_array_release(targets);
+	obs_data_t *timings = api_timings(&dm->stats);
+	obs_data_set_obj(out, "timings", timings);
+	obs_data_release(timings);
+}
 
-	if (!successes.empty()) {
-		std::sort(successes.begin(), successes.end(),
-			  [](const measurement_sample &a, const measurement_sample &b) {
-				  return a.correlation > b.correlation;
-			  });
-		const size_t take = std::min<size_t>(4, successes.size());
-		double sum_delay = 0.0;
-		double sum_corr = 0.0;
-		for (size_t i = 0; i < take; ++i) {
-			sum_delay += successes[i].delay_ms;
-			sum_corr += successes[i].correlation;
-		}
-		avg_delay = sum_delay / (double)take;
-		avg_corr = sum_corr / (double)take;
-		have_result = true;
-	}
+static void api_emit_result(struct audio_sync_data *dm)
+{
+	if (!g_vendor_open.load(std::memory_order_acquire))
+		return;
 
-	if (have_result) {
-		char buffer[256];
-		snprintf(buffer, sizeof(buffer), "%+6.1f ms", avg_delay);
-		const char *details = dm->debug_enabled ? notes.c_str() : "Average completed (top 4 used).";
-		set_result(dm, buffer, details, true);
-		pthread_mutex_lock(&dm->lock);
-		dm->last_delay_ms = avg_delay;
-		dm->last_delay_valid = true;
-		dm->last_correlation = (float)avg_corr;
-		pthread_mutex_unlock(&dm->lock);
-	} else {
-		set_result(dm, "Average failed", notes.empty() ? "No successful measurements" : notes.c_str(), false);
-		pthread_mutex_lock(&dm->lock);
-		dm->last_delay_valid = false;
-		pthread_mutex_unlock(&dm->lock);
-	}
+	obs_data_t *event = obs_data_create();
+	api_write_result(dm, event);
+	websocket_vendor_emit(&g_vendor, "ResultPublished", event);
+	obs_data_release(event);
+}
 
-	pthread_mutex_lock(&dm->lock);
-	dm->average_in_progress = false;
-	dm->average_thread_active = false;
-	pthread_mutex_unlock(&dm->lock);
-	blog(LOG_INFO, "[ADM Trace] Measure Thread Complete");
-	return nullptr;
+// Queued UI-thread tasks; the plugin may have shut down by the time they run
+static void api_measure_ui(void *param)
+{
+	UNUSED_PARAMETER(param);
+	if (g_dm)
+		measure_now(g_dm);
 }
 
-static void measure_average(audio_sync_data *dm)
+static void api_average_ui(void *param)
+{
+	UNUSED_PARAMETER(param);
+	if (g_dm)
+		measure_average(g_dm);
+}
+
+static void api_apply_ui(void *param)
+{
+	UNUSED_PARAMETER(param);
+	if (g_dm)
+		apply_sync_offset(g_dm);
+}
+
+static void api_set_sources_ui(void *param)
 {
+	std::unique_ptr<struct api_sources> sources(static_cast<struct api_sources *>(param));
+	struct audio_sync_data *dm = g_dm;
 	if (!dm)
 		return;
 
 	pthread_mutex_lock(&dm->lock);
-	if (dm->average_in_progress) {
-		pthread_mutex_unlock(&dm->lock);
-		return;
-	}
-	dm->average_in_progress = true;
-	dm->average_stop = false;
+	if (sources->set_ref)
+		dm->ref_name = sources->ref;
+	if (sources->set_targets)
+		dm->target_names = sources->targets;
 	pthread_mutex_unlock(&dm->lock);
 
-	if (pthread_create(&dm->average_thread, nullptr, measure_average_worker, dm) != 0) {
-		pthread_mutex_lock(&dm->lock);
-		dm->average_in_progress = false;
-		pthread_mutex_unlock(&dm->lock);
-		set_result(dm, "Error", "Could not start background measurement thread.", false);
+	connect_sources(dm);
+	update_dock_ui(dm);
+}
+
+static bool api_sources_selected(struct audio_sync_data *dm)
+{
+	pthread_mutex_lock(&dm->lock);
+	const bool selected = !dm->ref_name.empty() && !dm->target_names.empty();
+	pthread_mutex_unlock(&dm->lock);
+	return selected;
+}
+
+static void api_measure(struct audio_sync_data *dm, obs_data_t *request, obs_data_t *response)
+{
+	UNUSED_PARAMETER(request);
+	if (!api_sources_selected(dm)) {
+		api_fail(response, "Select both reference and target sources.");
 		return;
 	}
+	api_accept(dm, response);
+	obs_queue_task(OBS_TASK_UI, api_measure_ui, nullptr, false);
+}
 
+static void api_average(struct audio_sync_data *dm, obs_data_t *request, obs_data_t *response)
+{
+	UNUSED_PARAMETER(request);
+	if (!api_sources_selected(dm)) {
+		api_fail(response, "Select both reference and target sources.");
+		return;
+	}
 	pthread_mutex_lock(&dm->lock);
-	dm->average_thread_active = true;
+	const bool running = dm->average_in_progress;
 	pthread_mutex_unlock(&dm->lock);
+	if (running) {
+		api_fail(response, "An average is already running.");
+		return;
+	}
+	api_accept(dm, response);
+	obs_queue_task(OBS_TASK_UI, api_average_ui, nullptr, false);
+}
 
-	set_result(dm, "Averaging...", "Collecting 10 measurements over 1 second.", false);
+static void api_apply(struct audio_sync_data *dm, obs_data_t *request, obs_data_t *response)
+{
+	UNUSED_PARAMETER(request);
 	pthread_mutex_lock(&dm->lock);
-	dm->last_delay_valid = false;
+	const bool valid = dm->last_delay_valid;
 	pthread_mutex_unlock(&dm->lock);
+	if (!valid) {
+		api_fail(response, "Run Measure before applying offset.");
+		return;
+	}
+	api_accept(dm, response);
+	obs_queue_task(OBS_TASK_UI, api_apply_ui, nullptr, false);
 }
 
-static void apply_sync_offset(audio_sync_data *dm)
+static void api_add_missing(obs_data_array_t *missing, const std::string &name)
 {
-	if (!dm)
+	obs_source_t *source = obs_get_source_by_name(name.c_str());
+	if (source) {
+		obs_source_release(source);
 		return;
+	}
+	obs_data_t *item = obs_data_create();
+	obs_data_set_string(item, "name", name.c_str());
+	obs_data_array_push_back(missing, item);
+	obs_data_release(item);
+}
 
-	pthread_mutex_lock(&dm->lock);
-	bool valid = dm->last_delay_valid;
-	double delay_ms = dm->last_delay_ms;
-	pthread_mutex_unlock(&dm->lock);
+// {"reference": name, "targets": [{"name": name}, ...]}, as the settings are saved.
+// Sources that do not exist yet are kept and connected once they appear, as
+// with the dialog; the answer lists them under "missing".
+static void api_set_sources(struct audio_sync_data *dm, obs_data_t *request, obs_data_t *response)
+{
+	UNUSED_PARAMETER(dm);
+	auto sources = std::make_unique<struct api_sources>();
+	sources->set_ref = obs_data_has_user_value(request, "reference");
+	sources->ref = obs_data_get_string(request, "reference");
+
+	obs_data_array_t *targets = obs_data_get_array(request, "targets");
+	if (targets) {
+		sources->set_targets = true;
+		const size_t count = obs_data_array_count(targets);
+		for (size_t i = 0; i < count; ++i) {
+			obs_data_t *item = obs_data_array_item(targets, i);
+			const std::string name = obs_data_get_string(item, "name");
+			obs_data_release(item);
+			if (!name.empty() &&
+			    std::find(sources->targets.begin(), sources->targets.end(), name) == sources->targets.end())
+				sources->targets.push_back(name);
+		}
+		obs_data_array_release(targets);
+	}
 
-	if (!valid) {
-		set_result(dm, "No Data", "Run Measure Now before applying offset.", false);
+	if (!sources->set_ref && !sources->set_targets) {
+		api_fail(response, "Give a reference, targets or both.");
+		return;
+	}
+	if (sources->targets.size() > MAX_TARGETS) {
+		char error[64];
+		snprintf(error, sizeof(error), "At most %u targets can be measured.", (unsigned)MAX_TARGETS);
+		api_fail(response, error);
 		return;
 	}
 
-	obs_source_t *ref = nullptr;
-	pthread_mutex_lock(&dm->lock);
-	ref = dm->ref ? obs_source_get_ref(dm->ref) : nullptr;
-	pthread_mutex_unlock(&dm->lock);
+	obs_data_array_t *missing = obs_data_array_create();
+	if (sources->set_ref && !sources->ref.empty())
+		api_add_missing(missing, sources->ref);
+	for (const std::string &name : sources->targets)
+		api_add_missing(missing, name);
+	obs_data_set_bool(response, "ok", true);
+	obs_data_set_array(response, "missing", missing);
+	obs_data_array_release(missing);
 
-	if (!ref) {
-		set_result(dm, "No Reference", "Select a reference source first.", false);
+	obs_queue_task(OBS_TASK_UI, api_set_sources_ui, sources.release(), false);
+}
+
+static void api_get_last_result(struct audio_sync_data *dm, obs_data_t *request, obs_data_t *response)
+{
+	UNUSED_PARAMETER(request);
+	obs_data_set_bool(response, "ok", true);
+	api_write_result(dm, response);
+}
+
+static const struct api_request k_api_requests[] = {
+	{"Measure", "audio_sync_measure", api_measure},
+	{"Average", "audio_sync_average", api_average},
+	{"Apply", "audio_sync_apply", api_apply},
+	{"SetSources", "audio_sync_set_sources", api_set_sources},
+	{"GetLastResult", "audio_sync_get_last_result", api_get_last_result},
+};
+
+// The proc handler cannot drop a proc again, so its requests may still call in
+// once the plugin's state is gone
+static void api_call(const struct api_request *req, obs_data_t *request, obs_data_t *response)
+{
+	struct audio_sync_data *dm = acquire_dm();
+	if (!dm) {
+		api_fail(response, "Audio Sync Analyzer is not running.");
 		return;
 	}
+	follow_audio_output(dm);
+	req->handler(dm, request, response);
+	release_dm();
+}
+
+static void api_vendor_request(obs_data_t *request, obs_data_t *response, void *param)
+{
+	api_call(static_cast<const struct api_request *>(param), request, response);
+}
+
+static void api_proc(void *param, calldata_t *cd)
+{
+	const char *json = calldata_string(cd, "request");
+	obs_data_t *request = json && *json ? obs_data_create_from_json(json) : obs_data_create();
+	obs_data_t *response = obs_data_create();
+	if (request)
+		api_call(static_cast<const struct api_request *>(param), request, response);
+	else
+		api_fail(response, "Request is not valid JSON.");
+	calldata_set_string(cd, "response", obs_data_get_json(response));
+	obs_data_release(request);
+	obs_data_release(response);
+}
+
+static void api_register_procs()
+{
+	proc_handler_t *ph = obs_get_proc_handler();
+	for (const struct api_request &req : k_api_requests) {
+		char decl[128];
+		snprintf(decl, sizeof(decl), "void %s(in string request, out string response)", req.proc);
+		proc_handler_add(ph, decl, api_proc, (void *)&req);
+	}
+}
 
-	int64_t offset_ns = (int64_t)llround(delay_ms * 1000000.0);
-	obs_source_set_sync_offset(ref, offset_ns);
-	obs_source_release(ref);
+// obs-websocket only offers its vendor API once it has loaded, so this runs from obs_module_post_load()
+static void api_register_vendor()
+{
+	if (!websocket_vendor_register(&g_vendor, API_VENDOR_NAME)) {
+		blog(LOG_INFO, "[ADM] obs-websocket not found; scripted requests use the proc handler only");
+		return;
+	}
+	for (const struct api_request &req : k_api_requests) {
+		if (!websocket_vendor_add_request(&g_vendor, req.type, api_vendor_request, (void *)&req))
+			blog(LOG_WARNING, "[ADM] Could not register vendor request %s", req.type);
+	}
+	g_vendor_open.store(true, std::memory_order_release);
+}
 
-	char msg[128];
-	snprintf(msg, sizeof(msg), "✓ %+0.1f", delay_ms);
-	set_result(dm, msg, "Sync Offset updated on reference source.", true);
+// obs-websocket may unload before this module, so its requests are dropped on
+// OBS_FRONTEND_EVENT_EXIT while it is still there
+static void api_unregister_vendor()
+{
+	if (!g_vendor_open.exchange(false, std::memory_order_acq_rel))
+		return;
+	for (const struct api_request &req : k_api_requests)
+		websocket_vendor_remove_request(&g_vendor, req.type);
 }
 
 // ──────────────────────────────────────────────────────────────
@@ -864,14 +3607,23 @@ static void apply_sync_offset(audio_sync_data *dm)
 #include <QFormLayout>
 #include <QSpinBox>
 #include <QDoubleSpinBox>
+#include <QCheckBox>
 #include <QPushButton>
-#include <QTextEdit>
+#include <QPainter>
+#include <QPlainTextEdit>
+#include <QTextCursor>
+#include <QTextDocument>
+#include <QTimer>
 #include <QScrollBar>
 #include <QVBoxLayout>
 #include <QMainWindow>
 #include <QWidget>
 #include <QToolButton>
 #include <QStyle>
+#include <QHBoxLayout>
+#include <QTableWidget>
+#include <QHeaderView>
+#include <QFileDialog>
 
 static void populate_source_combo(QComboBox *combo, const std::string &current)
 {
@@ -892,13 +3644,203 @@ static void populate_source_combo(QComboBox *combo, const std::string &current)
 		combo->setCurrentIndex(idx);
 }
 
+// Text for the settings dialog: ring memory per source and for `sources` sources
+static QString ring_footprint_text(size_t capacity, enum sample_format format, size_t sources)
+{
+	const double mib = (double)(capacity * sample_format_size(format)) / (1024.0 * 1024.0);
+	return QString("%1 MiB per source, %2 MiB for %3 sources")
+		.arg(mib, 0, 'f', 2)
+		.arg(mib * (double)sources, 0, 'f', 2)
+		.arg((int)sources);
+}
+
+static QComboBox *make_channel_combo(QWidget *parent, size_t channels, int selected)
+{
+	auto *combo = new QComboBox(parent);
+	char label[32];
+	for (int channel = CAPTURE_CHANNEL_MIX; channel < (int)channels; ++channel) {
+		channel_label(channel, channels, label, sizeof(label));
+		combo->addItem(label, channel);
+	}
+	const int idx = combo->findData(selected);
+	combo->setCurrentIndex(idx >= 0 ? idx : 0);
+	return combo;
+}
+
+// One row per audio source: a checkable name and the channel to capture from it
+static void populate_source_list(QTableWidget *table, const std::vector<std::string> &checked,
+				 const std::map<std::string, int> &source_channels, size_t channels)
+{
+	std::vector<std::string> names;
+	obs_enum_sources(
+		[](void *data, obs_source_t *src) {
+			auto *n = static_cast<std::vector<std::string> *>(data);
+			uint32_t flags = obs_source_get_output_flags(src);
+			if (!(flags & OBS_SOURCE_AUDIO))
+				return true;
+			n->push_back(obs_source_get_name(src));
+			return true;
+		},
+		&names);
+
+	table->setRowCount((int)names.size());
+	for (size_t i = 0; i < names.size(); ++i) {
+		auto *item = new QTableWidgetItem(QString::fromUtf8(names[i].c_str()));
+		item->setFlags(item->flags() | Qt::ItemIsUserCheckable);
+		const bool on = std::find(checked.begin(), checked.end(), names[i]) != checked.end();
+		item->setCheckState(on ? Qt::Checked : Qt::Unchecked);
+		table->setItem((int)i, 0, item);
+
+		auto it = source_channels.find(names[i]);
+		const int channel = it != source_channels.end() ? it->second : CAPTURE_CHANNEL_MIX;
+		table->setCellWidget((int)i, 1, make_channel_combo(table, channels, channel));
+	}
+}
+
+// Correlation around the selected target's peak above the history of its delay
+// (blue) and correlation (grey).  The workers already reduced both to about
+// the plot's size, so a repaint only maps points to pixels.
+class SyncPlotWidget : public QWidget {
+public:
+	// Filled by the dock under audio_sync_data::lock, then shown with update()
+	struct sync_curve curve;
+	std::vector<struct sync_history_point> history;
+	size_t historyCount = 0;
+	float threshold = MIN_CORR_THRESHOLD;
+
+	explicit SyncPlotWidget(QWidget *parent = nullptr) : QWidget(parent)
+	{
+		history.resize(SYNC_HISTORY_POINTS + 1);
+		points.reserve(SYNC_HISTORY_POINTS + 1);
+		setMinimumHeight(180);
+		setMaximumWidth(360);
+	}
+
+protected:
+	void paintEvent(QPaintEvent *) override
+	{
+		QPainter painter(this);
+		painter.setRenderHint(QPainter::Antialiasing);
+		const int split = height() / 2;
+		drawCurve(painter, QRect(0, 0, width(), split - 2));
+		drawHistory(painter, QRect(0, split + 2, width(), height() - split - 2));
+	}
+
+private:
+	std::vector<QPointF> points;
+
+	static double corrY(const QRect &r, double corr)
+	{
+		return r.top() + (1.0 - std::clamp(corr, 0.0, 1.0)) * (r.height() - 1);
+	}
+
+	static void drawFrame(QPainter &painter, const QRect &r)
+	{
+		painter.fillRect(r, QColor(24, 24, 24));
+		painter.setPen(QColor(80, 80, 80));
+		painter.drawRect(r.adjusted(0, 0, -1, -1));
+	}
+
+	void drawCurve(QPainter &painter, const QRect &r)
+	{
+		drawFrame(painter, r);
+		if (!curve.count) {
+			painter.setPen(Qt::gray);
+			painter.drawText(r, Qt::AlignCenter, "No correlation yet");
+			return;
+		}
+
+		const double span_ms = curve.last_ms - curve.first_ms;
+		QPen thresholdPen(QColor(200, 120, 40));
+		thresholdPen.setStyle(Qt::DashLine);
+		painter.setPen(thresholdPen);
+		const double ty = corrY(r, threshold);
+		painter.drawLine(QPointF(r.left(), ty), QPointF(r.left() + r.width(), ty));
+
+		const double px = r.left() + (curve.peak_ms - curve.first_ms) / span_ms * r.width();
+		painter.setPen(QColor(90, 90, 90));
+		painter.drawLine(QPointF(px, r.top()), QPointF(px, r.top() + r.height()));
+
+		points.clear();
+		for (size_t i = 0; i < curve.count; ++i)
+			points.emplace_back(r.left() + ((double)i + 0.5) * r.width() / (double)curve.count,
+					    corrY(r, curve.values[i]));
+		painter.setPen(QPen(QColor(46, 154, 254), 1.5));
+		painter.drawPolyline(points.data(), (int)points.size());
+
+		const QRect text = r.adjusted(4, 2, -4, -2);
+		painter.setPen(Qt::gray);
+		const QString first = QString("%1 ms").arg(curve.first_ms, 0, 'f', 0);
+		const QString last = QString("%1 ms").arg(curve.last_ms, 0, 'f', 0);
+		painter.drawText(text, Qt::AlignLeft | Qt::AlignBottom, first);
+		painter.drawText(text, Qt::AlignRight | Qt::AlignBottom, last);
+		painter.drawText(text, Qt::AlignLeft | Qt::AlignTop, "Correlation");
+	}
+
+	void drawHistory(QPainter &painter, const QRect &r)
+	{
+		drawFrame(painter, r);
+		if (!historyCount) {
+			painter.setPen(Qt::gray);
+			painter.drawText(r, Qt::AlignCenter, "No history yet");
+			return;
+		}
+
+		const double t0 = history[0].time_s;
+		const double span_s = std::max(history[historyCount - 1].time_s - t0, SYNC_HISTORY_SLOT_S);
+		double lo = HUGE_VAL;
+		double hi = -HUGE_VAL;
+		for (size_t i = 0; i < historyCount; ++i) {
+			if (std::isnan(history[i].delay_ms))
+				continue;
+			lo = std::min(lo, (double)history[i].delay_ms);
+			hi = std::max(hi, (double)history[i].delay_ms);
+		}
+		// At least a millisecond either side, so jitter does not fill the plot
+		const double mid = lo <= hi ? 0.5 * (lo + hi) : 0.0;
+		lo = std::min(lo, mid - 1.0);
+		hi = std::max(hi, mid + 1.0);
+
+		auto x = [&](size_t i) { return r.left() + (history[i].time_s - t0) / span_s * (r.width() - 1); };
+
+		points.clear();
+		for (size_t i = 0; i < historyCount; ++i)
+			points.emplace_back(x(i), corrY(r, history[i].correlation));
+		painter.setPen(QColor(110, 110, 110));
+		painter.drawPolyline(points.data(), (int)points.size());
+
+		// Slots without a result break the delay line
+		painter.setPen(QPen(QColor(46, 154, 254), 1.5));
+		points.clear();
+		for (size_t i = 0; i <= historyCount; ++i) {
+			if (i < historyCount && !std::isnan(history[i].delay_ms)) {
+				const double y = r.top() + (hi - history[i].delay_ms) / (hi - lo) * (r.height() - 1);
+				points.emplace_back(x(i), y);
+				continue;
+			}
+			if (points.size() > 1)
+				painter.drawPolyline(points.data(), (int)points.size());
+			points.clear();
+		}
+
+		const QRect text = r.adjusted(4, 2, -4, -2);
+		painter.setPen(Qt::gray);
+		painter.drawText(text, Qt::AlignLeft | Qt::AlignTop, QString("%1 ms").arg(hi, 0, 'f', 1));
+		painter.drawText(text, Qt::AlignLeft | Qt::AlignBottom, QString("%1 ms").arg(lo, 0, 'f', 1));
+		painter.drawText(text, Qt::AlignRight | Qt::AlignBottom,
+				 QString("last %1 min").arg(span_s / 60.0, 0, 'f', 1));
+	}
+};
+
 class SyncDockWidget : public QWidget {
 	Q_OBJECT
 public:
 	QLabel *delayLabel;
 	QLabel *corrLabel;
 	QLabel *sourceLabel;
-	QTextEdit *logView;
+	QTableWidget *resultTable;
+	SyncPlotWidget *plot;
+	QPlainTextEdit *logView;
 	audio_sync_data *dm;
 	QToolButton *btnSettings;
 	QPushButton *btnApply;
@@ -924,9 +3866,14 @@ public:
 		btnMeasure->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Fixed);
 		auto *btnAvg = new QPushButton("Avg");
 		btnAvg->setMinimumWidth(56);
+		auto *btnMonitor = new QPushButton("Monitor");
+		btnMonitor->setCheckable(true);
+		btnMonitor->setToolTip("Track the delay continuously in the background");
+		auto *btnFile = new QPushButton("File...");
+		btnFile->setToolTip("Measure a WAV recording over its whole length; channel 0 is the reference");
 
 		btnSettings = new QToolButton();
-		btnSettings->setText(QString::fromUtf8("\u2699")); // gear symbol
+		btnSettings->setText(QString::fromUtf8("⚙")); // gear symbol
 		btnSettings->setStyleSheet("font-size: 18px;");
 		btnSettings->setToolButtonStyle(Qt::ToolButtonTextOnly);
 		btnSettings->setAutoRaise(true);
@@ -936,11 +3883,27 @@ public:
 		btnApply = new QPushButton("Apply");
 		btnApply->setEnabled(false);
 
-		logView = new QTextEdit;
+		// One row per target; the selected row drives the headline and Apply
+		resultTable = new QTableWidget(0, 3);
+		resultTable->setHorizontalHeaderLabels({"Target", "Delay", "Corr"});
+		resultTable->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
+		resultTable->horizontalHeader()->setSectionResizeMode(1, QHeaderView::ResizeToContents);
+		resultTable->horizontalHeader()->setSectionResizeMode(2, QHeaderView::ResizeToContents);
+		resultTable->verticalHeader()->setVisible(false);
+		resultTable->setSelectionBehavior(QAbstractItemView::SelectRows);
+		resultTable->setSelectionMode(QAbstractItemView::SingleSelection);
+		resultTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+		resultTable->setMaximumHeight(140);
+		resultTable->setMaximumWidth(360);
+
+		plot = new SyncPlotWidget;
+
+		logView = new QPlainTextEdit;
 		logView->setReadOnly(true);
 		logView->setMaximumHeight(160);
 		logView->setMaximumWidth(360);
-		logView->setLineWrapMode(QTextEdit::WidgetWidth);
+		logView->setLineWrapMode(QPlainTextEdit::WidgetWidth);
+		logView->setMaximumBlockCount(DOCK_LOG_LINES);
 
 		// Top row: sources + settings on the right
 		auto *topRow = new QHBoxLayout();
@@ -960,33 +3923,138 @@ public:
 		auto *row = new QHBoxLayout();
 		row->addWidget(btnMeasure, 1);
 		row->addWidget(btnAvg);
+		row->addWidget(btnMonitor);
+		row->addWidget(btnFile);
 		lay->addLayout(row);
+		lay->addWidget(resultTable);
+		lay->addWidget(plot);
 		lay->addWidget(logView);
 		lay->addStretch();
 
 		connect(btnMeasure, &QPushButton::clicked, this, [this]() { measure_now(dm); });
 		connect(btnAvg, &QPushButton::clicked, this, [this]() { measure_average(dm); });
+		connect(btnMonitor, &QPushButton::toggled, this, [this](bool on) {
+			if (on)
+				start_monitor(dm);
+			else
+				stop_monitor(dm);
+		});
+		connect(btnFile, &QPushButton::clicked, this, [this]() {
+			const QString path = QFileDialog::getOpenFileName(this, "Analyze Recording", QString(),
+									  "WAV files (*.wav)");
+			if (!path.isEmpty())
+				analyze_file(dm, path.toUtf8().constData());
+		});
 		connect(btnApply, &QPushButton::clicked, this, [this]() { apply_sync_offset(dm); });
 		connect(btnSettings, &QPushButton::clicked, this, [this]() { openSettingsDialog(); });
+		connect(resultTable, &QTableWidget::itemSelectionChanged, this, [this]() {
+			const int row = resultTable->currentRow();
+			if (row >= 0)
+				select_target(dm, (size_t)row);
+		});
 
 		// Initialize labels with current names
-		updateSourceNames(QString::fromStdString(dm->ref_name), QString::fromStdString(dm->target_name));
+		updateSourceNames(QString::fromStdString(dm->ref_name), targetSummary(dm->target_names));
+
+		auto *refreshTimer = new QTimer(this);
+		connect(refreshTimer, &QTimer::timeout, this, [this]() { refresh(); });
+		refreshTimer->start(DOCK_REFRESH_MS);
+		dm->dock_dirty.store(true, std::memory_order_release);
+	}
+
+	static QString targetSummary(const std::vector<std::string> &names)
+	{
+		if (names.empty())
+			return QString();
+		if (names.size() == 1)
+			return QString::fromStdString(names[0]);
+		return QString("%1 targets").arg((int)names.size());
 	}
 
 public slots:
-	void updateResult(const QString &delay, const QString &notes, bool valid)
+	// Runs every DOCK_REFRESH_MS on the UI thread and returns at once unless
+	// something changed, so the UI does the same work at any result rate
+	void refresh()
 	{
-		delayLabel->setText(delay);
+		if (!dm->dock_dirty.exchange(false, std::memory_order_acq_rel))
+			return;
+
+		std::vector<dock_entry> entries;
+		std::vector<target_row> rows;
 		pthread_mutex_lock(&dm->lock);
-		const double corr = dm ? dm->last_correlation : 0.0;
-		const QString ref = QString::fromStdString(dm->ref_name.empty() ? "<ref>" : dm->ref_name);
-		const QString tgt = QString::fromStdString(dm->target_name.empty() ? "<target>" : dm->target_name);
+		const QString delay = QString::fromStdString(dm->last_delay_text);
+		const double corr = dm->last_correlation;
+		const bool valid = dm->last_delay_valid;
+		const QString ref = QString::fromStdString(dm->ref_name);
+		const QString tgt = targetSummary(dm->target_names);
+		for (const auto &t : dm->targets)
+			rows.push_back({*target_name(t.get()), t->delay_text, t->correlation, t->valid});
+		const int selected = (int)dm->selected_target;
+		if (!dm->targets.empty()) {
+			const sync_target *t = dm->targets[std::min(dm->selected_target, dm->targets.size() - 1)].get();
+			plot->curve = t->curve;
+			plot->historyCount = sync_history_copy(&t->history, plot->history.data());
+		} else {
+			plot->curve.count = 0;
+			plot->historyCount = 0;
+		}
+		plot->threshold = dm->corr_threshold;
+		entries.swap(dm->dock_pending);
 		pthread_mutex_unlock(&dm->lock);
+
+		delayLabel->setText(delay);
 		corrLabel->setText(QString("Corr: %1").arg(corr, 0, 'f', 2));
 		updateSourceNames(ref, tgt);
-		logView->setPlainText(notes);
-		logView->verticalScrollBar()->setValue(logView->verticalScrollBar()->maximum());
 		btnApply->setEnabled(valid);
+		updateTargets(rows, selected);
+		plot->update();
+		for (const dock_entry &entry : entries)
+			appendLog(entry);
+	}
+
+	// Adds an entry to the end of the log, or rewrites the last one in place
+	// when both are live; earlier text is never touched
+	void appendLog(const dock_entry &entry)
+	{
+		const QString text = QString("[%1] %2").arg(QString::fromStdString(entry.time),
+							    QString::fromStdString(entry.notes));
+		QTextDocument *doc = logView->document();
+		QTextCursor cursor(doc);
+		cursor.movePosition(QTextCursor::End);
+		if (entry.live && lastEntryLive) {
+			// Old lines may have been trimmed from the top, never from the end
+			cursor.movePosition(QTextCursor::Left, QTextCursor::KeepAnchor,
+					    std::min(lastEntryLength, doc->characterCount() - 1));
+		} else if (!doc->isEmpty()) {
+			cursor.insertBlock();
+		}
+		cursor.insertText(text);
+		lastEntryLength = (int)text.length();
+		lastEntryLive = entry.live;
+		logView->verticalScrollBar()->setValue(logView->verticalScrollBar()->maximum());
+	}
+
+	void updateTargets(const std::vector<target_row> &rows, int selected)
+	{
+		resultTable->setRowCount((int)rows.size());
+		for (size_t i = 0; i < rows.size(); ++i) {
+			const target_row &r = rows[i];
+			const QString corr = r.valid || r.correlation > 0.0
+						     ? QString::number(r.correlation, 'f', 2)
+						     : QString("--");
+			const QString cells[3] = {QString::fromStdString(r.name), QString::fromStdString(r.delay_text),
+						  corr};
+			for (int c = 0; c < 3; ++c) {
+				QTableWidgetItem *item = resultTable->item((int)i, c);
+				if (!item) {
+					item = new QTableWidgetItem();
+					resultTable->setItem((int)i, c, item);
+				}
+				item->setText(cells[c]);
+			}
+		}
+		if (selected >= 0 && selected < (int)rows.size() && resultTable->currentRow() != selected)
+			resultTable->selectRow(selected);
 	}
 
 	void updateSourceNames(const QString &ref, const QString &tgt)
@@ -997,6 +4065,10 @@ public slots:
 	}
 
 private:
+	// Characters in the newest log entry and whether it is live
+	int lastEntryLength = 0;
+	bool lastEntryLive = false;
+
 	void openSettingsDialog()
 	{
 		if (!dm)
@@ -1007,11 +4079,33 @@ private:
 		auto *layout = new QFormLayout(&dlg);
 
 		auto *refCombo = new QComboBox(&dlg);
-		auto *tgtCombo = new QComboBox(&dlg);
+		auto *tgtList = new QTableWidget(0, 2, &dlg);
 		auto *winSpin = new QSpinBox(&dlg);
 		auto *lagSpin = new QSpinBox(&dlg);
 		auto *corrSpin = new QDoubleSpinBox(&dlg);
-
+		auto *driftSpin = new QDoubleSpinBox(&dlg);
+		auto *coarseCheck = new QCheckBox("Decimated first pass, full-rate refinement", &dlg);
+		auto *adaptiveCheck = new QCheckBox("Search near the last confident delay", &dlg);
+		auto *streamCheck = new QCheckBox("Bandpass audio as it arrives instead of per measurement", &dlg);
+		auto *autoApplyCheck = new QCheckBox("Apply stable delay changes seen by Monitor", &dlg);
+		auto *voiceGateCheck = new QCheckBox("Only correlate audio where both sources carry speech", &dlg);
+		auto *taperCombo = new QComboBox(&dlg);
+		for (int kind = 0; kind < TAPER_COUNT; ++kind)
+			taperCombo->addItem(taper_name((enum taper_kind)kind), kind);
+		auto *formatCombo = new QComboBox(&dlg);
+		for (int format = 0; format < SAMPLE_FORMAT_COUNT; ++format)
+			formatCombo->addItem(sample_format_name((enum sample_format)format), format);
+		auto *footprintLabel = new QLabel(&dlg);
+		auto *weightingCombo = new QComboBox(&dlg);
+		for (int kind = 0; kind < WEIGHTING_COUNT; ++kind)
+			weightingCombo->addItem(spectral_weighting_name((enum spectral_weighting)kind), kind);
+
+		tgtList->setMinimumHeight(100);
+		tgtList->setHorizontalHeaderLabels(QStringList() << "Source" << "Channel");
+		tgtList->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
+		tgtList->horizontalHeader()->setSectionResizeMode(1, QHeaderView::ResizeToContents);
+		tgtList->verticalHeader()->setVisible(false);
+		tgtList->setSelectionMode(QAbstractItemView::NoSelection);
 		winSpin->setMinimumWidth(120);
 		lagSpin->setMinimumWidth(120);
 		corrSpin->setMinimumWidth(120);
@@ -1023,32 +4117,112 @@ private:
 		corrSpin->setRange(0.0, 1.0);
 		corrSpin->setSingleStep(0.01);
 		corrSpin->setDecimals(2);
+		driftSpin->setMinimumWidth(120);
+		driftSpin->setRange(0.1, 100.0);
+		driftSpin->setSingleStep(0.5);
+		driftSpin->setDecimals(1);
+		driftSpin->setToolTip("Drift past this from the applied offset is reported as due for a re-apply");
 
 		std::string ref_name;
-		std::string tgt_name;
+		std::vector<std::string> tgt_names;
+		std::map<std::string, int> source_channels;
 		uint32_t window_ms = DEFAULT_WINDOW_MS;
 		uint32_t max_lag_ms = 500;
 		float corr_threshold = MIN_CORR_THRESHOLD;
+		double drift_tolerance_ms = DEFAULT_DRIFT_TOLERANCE_MS;
+		bool auto_apply = false;
+		bool voice_gate = true;
+		bool coarse_search = true;
+		bool adaptive_search = false;
+		bool stream_filter = false;
+		enum taper_kind taper = TAPER_HANN;
+		enum spectral_weighting weighting = WEIGHTING_NONE;
+		enum sample_format ring_format = SAMPLE_FORMAT_F32;
+		size_t sources = 1;
 
 		pthread_mutex_lock(&dm->lock);
 		ref_name = dm->ref_name;
-		tgt_name = dm->target_name;
+		tgt_names = dm->target_names;
+		source_channels = dm->source_channels;
 		window_ms = dm->window_ms;
 		max_lag_ms = dm->max_lag_ms;
 		corr_threshold = dm->corr_threshold;
+		drift_tolerance_ms = dm->drift_tolerance_ms;
+		auto_apply = dm->auto_apply;
+		voice_gate = dm->voice_gate;
+		coarse_search = dm->coarse_search;
+		adaptive_search = dm->adaptive_search;
+		stream_filter = dm->stream_filter.load();
+		taper = dm->taper;
+		weighting = dm->weighting;
+		ring_format = dm->ring_format;
+		sources = 1 + dm->target_names.size();
 		pthread_mutex_unlock(&dm->lock);
 
 		populate_source_combo(refCombo, ref_name);
-		populate_source_combo(tgtCombo, tgt_name);
+		auto it = source_channels.find(ref_name);
+		auto *refChannelCombo = make_channel_combo(&dlg, dm->channels,
+							  it != source_channels.end() ? it->second : CAPTURE_CHANNEL_MIX);
+		auto *refRow = new QHBoxLayout();
+		refRow->addWidget(refCombo, 1);
+		refRow->addWidget(refChannelCombo);
+		populate_source_list(tgtList, tgt_names, source_channels, dm->channels);
 		winSpin->setValue((int)window_ms);
 		lagSpin->setValue((int)max_lag_ms);
 		corrSpin->setValue((double)corr_threshold);
-
-		layout->addRow("Reference Source", refCombo);
-		layout->addRow("Target Source", tgtCombo);
+		driftSpin->setValue(drift_tolerance_ms);
+		autoApplyCheck->setChecked(auto_apply);
+		voiceGateCheck->setChecked(voice_gate);
+		voiceGateCheck->setToolTip("Skip silence, applause and steady noise instead of correlating them");
+		coarseCheck->setChecked(coarse_search);
+		adaptiveCheck->setChecked(adaptive_search);
+		adaptiveCheck->setToolTip("After a confident result, Measure correlates a 250 ms window within a few "
+					  "ms of it, and widens again when that fails");
+		streamCheck->setChecked(stream_filter);
+		taperCombo->setCurrentIndex(taperCombo->findData((int)taper));
+		weightingCombo->setCurrentIndex(weightingCombo->findData((int)weighting));
+		formatCombo->setCurrentIndex(formatCombo->findData((int)ring_format));
+		footprintLabel->setText(ring_footprint_text(dm->capacity, ring_format, sources));
+		const size_t capacity = dm->capacity;
+		QObject::connect(formatCombo, &QComboBox::currentIndexChanged, &dlg,
+				 [formatCombo, footprintLabel, capacity, sources](int) {
+					 const enum sample_format format =
+						 sample_format_from_int(formatCombo->currentData().toInt());
+					 footprintLabel->setText(ring_footprint_text(capacity, format, sources));
+				 });
+
+		layout->addRow("Reference Source", refRow);
+		layout->addRow("Target Sources", tgtList);
 		layout->addRow("Analysis Window (ms)", winSpin);
 		layout->addRow("Max Lag (ms)", lagSpin);
 		layout->addRow("Correlation Threshold", corrSpin);
+		layout->addRow("Drift Tolerance (ms)", driftSpin);
+		layout->addRow("Auto Apply", autoApplyCheck);
+		layout->addRow("Voice Activity Gate", voiceGateCheck);
+		layout->addRow("Coarse-to-fine Search", coarseCheck);
+		layout->addRow("Adaptive Search", adaptiveCheck);
+		layout->addRow("Streaming Filter", streamCheck);
+		layout->addRow("Window Taper", taperCombo);
+		layout->addRow("Spectral Weighting", weightingCombo);
+		layout->addRow("Buffer Precision", formatCombo);
+		layout->addRow("Buffer Memory", footprintLabel);
+
+		// Act right away, independent of OK/Cancel
+		auto *statsRow = new QHBoxLayout();
+		auto *saveStats = new QPushButton("Save...", &dlg);
+		auto *resetStats = new QPushButton("Reset", &dlg);
+		saveStats->setToolTip("Write stage timing histograms and FFT size counts to a text file");
+		statsRow->addWidget(saveStats);
+		statsRow->addWidget(resetStats);
+		statsRow->addStretch();
+		layout->addRow("Statistics", statsRow);
+		QObject::connect(saveStats, &QPushButton::clicked, &dlg, [this, &dlg]() {
+			const QString path = QFileDialog::getSaveFileName(&dlg, "Save Statistics", "audio-sync-stats.txt",
+									  "Text files (*.txt)");
+			if (!path.isEmpty())
+				save_stats(dm, path.toUtf8().constData());
+		});
+		QObject::connect(resetStats, &QPushButton::clicked, &dlg, [this]() { sync_stats_reset(&dm->stats); });
 
 		auto *buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, &dlg);
 		layout->addWidget(buttons);
@@ -1059,60 +4233,68 @@ private:
 			return;
 
 		std::string new_ref = refCombo->currentText().toStdString();
-		std::string new_tgt = tgtCombo->currentText().toStdString();
+		std::vector<std::string> new_tgts;
+		// Choices for unchecked sources are kept too, so re-checking one restores its channel
+		std::map<std::string, int> new_channels;
+		for (int i = 0; i < tgtList->rowCount(); ++i) {
+			QTableWidgetItem *item = tgtList->item(i, 0);
+			auto *channelCombo = static_cast<QComboBox *>(tgtList->cellWidget(i, 1));
+			const std::string name = item->text().toStdString();
+			const int channel = channelCombo->currentData().toInt();
+			if (channel != CAPTURE_CHANNEL_MIX)
+				new_channels[name] = channel;
+			if (item->checkState() == Qt::Checked && new_tgts.size() < MAX_TARGETS)
+				new_tgts.push_back(name);
+		}
+		const int new_ref_channel = refChannelCombo->currentData().toInt();
+		if (new_ref_channel != CAPTURE_CHANNEL_MIX)
+			new_channels[new_ref] = new_ref_channel;
+		else
+			new_channels.erase(new_ref);
 		uint32_t new_win = (uint32_t)winSpin->value();
 		uint32_t new_lag = (uint32_t)lagSpin->value();
 		float new_corr = (float)corrSpin->value();
+		double new_drift_tolerance = driftSpin->value();
+		bool new_auto_apply = autoApplyCheck->isChecked();
+		bool new_voice_gate = voiceGateCheck->isChecked();
+		bool new_coarse = coarseCheck->isChecked();
+		bool new_adaptive = adaptiveCheck->isChecked();
+		bool new_stream = streamCheck->isChecked();
+		enum taper_kind new_taper = taper_from_int(taperCombo->currentData().toInt());
+		enum spectral_weighting new_weighting =
+			spectral_weighting_from_int(weightingCombo->currentData().toInt());
+		enum sample_format new_format = sample_format_from_int(formatCombo->currentData().toInt());
 
 		pthread_mutex_lock(&dm->lock);
 		dm->ref_name = new_ref;
-		dm->target_name = new_tgt;
+		dm->target_names = new_tgts;
+		dm->source_channels = new_channels;
 		dm->window_ms = new_win;
 		dm->max_lag_ms = new_lag;
 		dm->corr_threshold = new_corr;
+		dm->drift_tolerance_ms = new_drift_tolerance;
+		dm->auto_apply = new_auto_apply;
+		dm->voice_gate = new_voice_gate;
+		dm->coarse_search = new_coarse;
+		dm->adaptive_search = new_adaptive;
+		dm->stream_filter.store(new_stream);
+		dm->taper = new_taper;
+		dm->weighting = new_weighting;
 		pthread_mutex_unlock(&dm->lock);
 
-		connect_ref(dm);
-		connect_target(dm);
+		set_ring_format(dm, new_format);
+		connect_sources(dm);
+		update_dock_ui(dm);
 	}
 };
 
 static QPointer<QDockWidget> g_syncDock;
 
-// Called from set_result after every measurement; pulls copies from dm to avoid dangling pointers
+// Safe from any thread and cheap enough to call per result: the dock notices on
+// its next refresh and copies what it shows in one go
 static void update_dock_ui(audio_sync_data *dm)
 {
-	blog(LOG_INFO, "[ADM DEBUG] Entering update dock ui");
-	if (!g_syncDock)
-		return;
-
-	auto *widget = qobject_cast<SyncDockWidget *>(g_syncDock->widget());
-	if (!widget)
-		return;
-
-	std::string delay_copy;
-	std::string notes_copy;
-	double corr_copy = 0.0;
-	std::string ref_name;
-	std::string tgt_name;
-	pthread_mutex_lock(&dm->lock);
-	delay_copy = dm->last_delay_text;
-	notes_copy = dm->last_delay_valid ? dm->last_notes : "";
-	corr_copy = dm->last_correlation;
-	ref_name = dm->ref_name;
-	tgt_name = dm->target_name;
-	bool valid = dm->last_delay_valid;
-	pthread_mutex_unlock(&dm->lock);
-
-	QMetaObject::invokeMethod(
-		widget,
-		[widget, delay_copy, notes_copy, corr_copy, ref_name, tgt_name, valid] {
-			Q_UNUSED(corr_copy);
-			widget->updateResult(QString::fromStdString(delay_copy), QString::fromStdString(notes_copy),
-					     valid);
-			widget->updateSourceNames(QString::fromStdString(ref_name), QString::fromStdString(tgt_name));
-		},
-		Qt::QueuedConnection);
+	dm->dock_dirty.store(true, std::memory_order_release);
 }
 
 static const char *k_dock_id = "audio-sync-analyzer";
@@ -1147,34 +4329,44 @@ static void destroy_dock_widget()
 
 static void audio_sync_frontend_shutdown()
 {
-	if (!g_dm)
+	// Without an EXIT event the requests stay registered, but send no more events
+	g_vendor_open.store(false, std::memory_order_release);
+	struct audio_sync_data *dm = retire_dm();
+	if (!dm)
 		return;
 
 	destroy_dock_widget();
 
-	pthread_mutex_lock(&g_dm->lock);
-	bool join_needed = g_dm->average_thread_active;
-	g_dm->average_stop = true;
-	pthread_mutex_unlock(&g_dm->lock);
-	if (join_needed)
-		pthread_join(g_dm->average_thread, nullptr);
-
-	if (g_dm->target) {
-		obs_source_remove_audio_capture_callback(g_dm->target, capture_target, g_dm);
-		obs_source_release(g_dm->target);
-		g_dm->target = nullptr;
-	}
-	if (g_dm->ref) {
-		obs_source_remove_audio_capture_callback(g_dm->ref, capture_ref, g_dm);
-		obs_source_release(g_dm->ref);
-		g_dm->ref = nullptr;
-	}
+	pthread_mutex_lock(&dm->lock);
+	const task_handle measure = dm->measure_task;
+	const task_handle average = dm->average_task;
+	const task_handle offline = dm->offline_task;
+	pthread_mutex_unlock(&dm->lock);
+	// A running average or file analysis notices the cancellation before its next window
+	task_pool_cancel(&dm->pool, average);
+	task_pool_cancel(&dm->pool, offline);
+	task_pool_wait(&dm->pool, average);
+	task_pool_wait(&dm->pool, offline);
+	task_pool_wait(&dm->pool, measure);
+
+	stop_monitor(dm);
+	task_pool_shutdown(&dm->pool);
+
+	for (auto &target : dm->targets)
+		disconnect_target(target.get());
+	dm->targets.clear();
+	disconnect_ref(dm);
+
+	pthread_mutex_destroy(&dm->workspace_lock);
+	pthread_mutex_destroy(&dm->lock);
+	delete dm;
+}
 
-	pthread_mutex_destroy(&g_dm->lock);
-	bfree(g_dm->ref_buffer);
-	bfree(g_dm->tgt_buffer);
-	delete g_dm;
-	g_dm = nullptr;
+static void frontend_event_cb(enum obs_frontend_event event, void *private_data)
+{
+	UNUSED_PARAMETER(private_data);
+	if (event == OBS_FRONTEND_EVENT_EXIT)
+		api_unregister_vendor();
 }
 
 static void tools_menu_action(void *data)
@@ -1200,25 +4392,45 @@ static void audio_sync_frontend_init()
 
 	g_dm = new audio_sync_data();
 	pthread_mutex_init(&g_dm->lock, nullptr);
-	g_dm->sample_rate = audio_output_get_sample_rate(obs_get_audio());
+	pthread_mutex_init(&g_dm->workspace_lock, nullptr);
+	sync_engine_init(&g_dm->engine, audio_output_get_sample_rate(obs_get_audio()), &g_dm->pool, blogva);
+	g_dm->engine.stats = &g_dm->stats;
 	g_dm->audio_format = AUDIO_FORMAT_FLOAT_PLANAR;
-	g_dm->capacity = ms_to_samples(BUFFER_SECONDS * 1000u, g_dm->sample_rate);
-	g_dm->ref_buffer = static_cast<float *>(bzalloc(g_dm->capacity * sizeof(float)));
-	g_dm->tgt_buffer = static_cast<float *>(bzalloc(g_dm->capacity * sizeof(float)));
-	g_dm->tgt_pos = g_dm->ref_pos = 0;
-	g_dm->tgt_count = g_dm->ref_count = 0;
+	g_dm->channels = std::min<size_t>(std::max<size_t>(audio_output_get_channels(obs_get_audio()), 1), MAX_AV_PLANES);
+	g_dm->ref_channel = CAPTURE_CHANNEL_MIX;
+	sync_ring_init(&g_dm->ref_ring, ms_to_samples(BUFFER_SECONDS * 1000u, g_dm->engine.sample_rate));
+	g_dm->capacity = g_dm->ref_ring.capacity;
+	voice_activity_init(&g_dm->ref_capture.vad, g_dm->capacity);
+	g_dm->ring_format = SAMPLE_FORMAT_F32;
+	g_dm->selected_target = 0;
 	g_dm->last_delay_valid = false;
 	g_dm->window_ms = DEFAULT_WINDOW_MS;
 	g_dm->max_lag_ms = 500;
 	g_dm->corr_threshold = MIN_CORR_THRESHOLD;
+	g_dm->drift_tolerance_ms = DEFAULT_DRIFT_TOLERANCE_MS;
+	g_dm->auto_apply = false;
+	g_dm->voice_gate = true;
+	g_dm->coarse_search = true;
+	g_dm->adaptive_search = false;
+	g_dm->stream_filter = false;
+	g_dm->taper = TAPER_HANN;
+	g_dm->weighting = WEIGHTING_NONE;
 	g_dm->debug_enabled = false;
 	g_dm->average_in_progress = false;
-	g_dm->average_stop = false;
-	g_dm->average_thread_active = false;
-
-	design_bandpass_filter(BANDPASS_LOW_Hz, BANDPASS_HIGH_Hz, g_dm->sample_rate, &g_dm->bp_coeffs);
-
+	g_dm->monitor_active = false;
+	g_dm->monitor_stop = false;
+
+	// One worker per core, enough for every target of a measurement to run at once
+	const int cores = os_get_logical_cores();
+	const size_t workers = std::min<size_t>(std::max(cores, 2), MAX_TARGETS);
+	if (!task_pool_init(&g_dm->pool, workers))
+		blog(LOG_WARNING, "[ADM] Could not start worker threads; measurements run on the UI thread");
+
+	register_sync_filter();
+	signal_handler_connect(obs_get_signal_handler(), "source_rename", source_renamed, nullptr);
+	api_register_procs();
 	obs_frontend_add_save_callback(frontend_save_cb, g_dm);
+	obs_frontend_add_event_callback(frontend_event_cb, nullptr);
 	obs_frontend_add_tools_menu_item("Audio Sync Analyzer", tools_menu_action, nullptr);
 
 	create_dock_widget();
@@ -1230,9 +4442,16 @@ extern "C" void audio_sync_frontend_init_module()
 	audio_sync_frontend_init();
 }
 
+extern "C" void audio_sync_frontend_post_load_module()
+{
+	api_register_vendor();
+}
+
 extern "C" void audio_sync_frontend_shutdown_module()
 {
 	obs_frontend_remove_save_callback(frontend_save_cb, g_dm);
+	obs_frontend_remove_event_callback(frontend_event_cb, nullptr);
+	signal_handler_disconnect(obs_get_signal_handler(), "source_rename", source_renamed, nullptr);
 	audio_sync_frontend_shutdown();
 }
 
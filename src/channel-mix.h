@@ -0,0 +1,88 @@
+/*
+Audio Sync Analyzer - Capture channel selection and downmix
+Copyright (C) 2025
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+
+#if !defined(SYNC_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define CHANNEL_MIX_SSE2 1
+#elif !defined(SYNC_NO_SIMD) && (defined(__aarch64__) || defined(_M_ARM64))
+#include <arm_neon.h>
+#define CHANNEL_MIX_NEON 1
+#endif
+
+// Channel selection stored per source; 0 and up pick one plane
+#define CAPTURE_CHANNEL_MIX -1
+
+// Display name for a channel selection, "Left"/"Right" on stereo output
+static inline void channel_label(int channel, size_t channels, char *buf, size_t size)
+{
+	if (channel == CAPTURE_CHANNEL_MIX)
+		snprintf(buf, size, "Mix (all channels)");
+	else if (channels == 2)
+		snprintf(buf, size, "%s", channel == 0 ? "Left" : "Right");
+	else
+		snprintf(buf, size, "Channel %d", channel + 1);
+}
+
+// dst[i] = dst[i] + src[i]
+static inline void channel_mix_add(float *dst, const float *src, size_t frames)
+{
+	size_t i = 0;
+#if defined(CHANNEL_MIX_SSE2)
+	for (; i + 8 <= frames; i += 8) {
+		const __m128 a = _mm_add_ps(_mm_loadu_ps(dst + i), _mm_loadu_ps(src + i));
+		const __m128 b = _mm_add_ps(_mm_loadu_ps(dst + i + 4), _mm_loadu_ps(src + i + 4));
+		_mm_storeu_ps(dst + i, a);
+		_mm_storeu_ps(dst + i + 4, b);
+	}
+#elif defined(CHANNEL_MIX_NEON)
+	for (; i + 8 <= frames; i += 8) {
+		const float32x4_t a = vaddq_f32(vld1q_f32(dst + i), vld1q_f32(src + i));
+		const float32x4_t b = vaddq_f32(vld1q_f32(dst + i + 4), vld1q_f32(src + i + 4));
+		vst1q_f32(dst + i, a);
+		vst1q_f32(dst + i + 4, b);
+	}
+#endif
+	for (; i < frames; ++i)
+		dst[i] += src[i];
+}
+
+// dst[i] = dst[i] * scale
+static inline void channel_mix_scale(float *dst, float scale, size_t frames)
+{
+	size_t i = 0;
+#if defined(CHANNEL_MIX_SSE2)
+	const __m128 s = _mm_set1_ps(scale);
+	for (; i + 4 <= frames; i += 4)
+		_mm_storeu_ps(dst + i, _mm_mul_ps(_mm_loadu_ps(dst + i), s));
+#elif defined(CHANNEL_MIX_NEON)
+	const float32x4_t s = vdupq_n_f32(scale);
+	for (; i + 4 <= frames; i += 4)
+		vst1q_f32(dst + i, vmulq_f32(vld1q_f32(dst + i), s));
+#endif
+	for (; i < frames; ++i)
+		dst[i] *= scale;
+}
+
+// Averages frames [offset, offset + frames) of `count` planes into dst.  Branches
+// once per plane, never per sample.
+static inline void channel_mix(const float *const *planes, size_t count, size_t offset, size_t frames, float *dst)
+{
+	memcpy(dst, planes[0] + offset, frames * sizeof(float));
+	for (size_t c = 1; c < count; ++c)
+		channel_mix_add(dst, planes[c] + offset, frames);
+	if (count > 1)
+		channel_mix_scale(dst, 1.0f / (float)count, frames);
+}
@@ -0,0 +1,178 @@
+/*
+Audio Sync Analyzer - Clock drift estimation
+Copyright (C) 2025
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+*/
+
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+// Fits a straight line through a target's delay over time.  Its slope is the
+// clock-rate skew between the target and the reference: a delay that grows by
+// 1 ms every 1000 s is a skew of +1 ppm.
+//
+// Results arrive far more often than the drift can change them (the monitor
+// reports every 125 ms from overlapping windows), so they are first averaged
+// into fixed bins, weighted by their confidence intervals.  The line is fitted
+// through the bin means, one point per bin.  A jump between neighbouring bins
+// (a source was restarted or its buffering changed) starts a fresh fit.
+
+// Span of one bin and the number kept: one hour of history
+#define DRIFT_BIN_S 10.0
+#define DRIFT_BINS 360u
+// The fit is reported once it spans this long and has this many bins
+#define DRIFT_MIN_SPAN_S 60.0
+#define DRIFT_MIN_BINS 4u
+// Difference between neighbouring bins that is treated as a step, not drift
+#define DRIFT_STEP_MS 5.0
+// Intervals below this would let a single result dominate its bin
+#define DRIFT_MIN_INTERVAL_MS 0.05
+
+struct drift_bin {
+	double time_s;
+	double delay_ms;
+};
+
+struct drift_estimator {
+	// Closed bins as a ring; the oldest is at (head + DRIFT_BINS - count) % DRIFT_BINS
+	struct drift_bin bins[DRIFT_BINS];
+	size_t head = 0;
+	size_t count = 0;
+
+	// Bin being filled
+	double bin_start_s = 0.0;
+	double sum_w = 0.0;
+	double sum_wt = 0.0;
+	double sum_wd = 0.0;
+};
+
+struct drift_fit {
+	// Skew and the half-width of its ~95% confidence interval
+	double ppm = 0.0;
+	double ppm_interval = 0.0;
+	// Fitted delay at the time the fit was taken for
+	double delay_ms = 0.0;
+	double span_s = 0.0;
+	size_t bins = 0;
+};
+
+static inline void drift_reset(struct drift_estimator *est)
+{
+	est->head = 0;
+	est->count = 0;
+	est->sum_w = 0.0;
+	est->sum_wt = 0.0;
+	est->sum_wd = 0.0;
+}
+
+static inline const struct drift_bin *drift_last_bin(const struct drift_estimator *est)
+{
+	return est->count ? &est->bins[(est->head + DRIFT_BINS - 1) % DRIFT_BINS] : nullptr;
+}
+
+static inline void drift_close_bin(struct drift_estimator *est)
+{
+	if (est->sum_w <= 0.0)
+		return;
+
+	const struct drift_bin bin = {est->sum_wt / est->sum_w, est->sum_wd / est->sum_w};
+	const struct drift_bin *last = drift_last_bin(est);
+	if (last && std::fabs(bin.delay_ms - last->delay_ms) > DRIFT_STEP_MS)
+		est->count = 0;
+
+	est->bins[est->head] = bin;
+	est->head = (est->head + 1) % DRIFT_BINS;
+	if (est->count < DRIFT_BINS)
+		est->count++;
+	est->sum_w = 0.0;
+	est->sum_wt = 0.0;
+	est->sum_wd = 0.0;
+}
+
+// Adds one successful measurement taken at time_s (any monotonic clock, in seconds)
+static inline void drift_add(struct drift_estimator *est, double time_s, double delay_ms, double interval_ms)
+{
+	if (est->sum_w > 0.0 && time_s - est->bin_start_s >= DRIFT_BIN_S)
+		drift_close_bin(est);
+	if (est->sum_w <= 0.0)
+		est->bin_start_s = time_s;
+
+	const double interval = std::fmax(interval_ms, DRIFT_MIN_INTERVAL_MS);
+	const double w = 1.0 / (interval * interval);
+	est->sum_w += w;
+	est->sum_wt += w * time_s;
+	est->sum_wd += w * delay_ms;
+}
+
+// Least-squares line through the closed bins and the one being filled, evaluated
+// at time_s.  Returns false until the history is long enough to trust.
+static inline bool drift_estimate(const struct drift_estimator *est, double time_s, struct drift_fit *out)
+{
+	struct drift_bin points[DRIFT_BINS + 1];
+	size_t n = 0;
+	for (size_t i = 0; i < est->count; ++i)
+		points[n++] = est->bins[(est->head + DRIFT_BINS - est->count + i) % DRIFT_BINS];
+	if (est->sum_w > 0.0) {
+		const struct drift_bin open = {est->sum_wt / est->sum_w, est->sum_wd / est->sum_w};
+		// The open bin would be dropped by the step check when it closes, so leave it out now
+		if (!n || std::fabs(open.delay_ms - points[n - 1].delay_ms) <= DRIFT_STEP_MS)
+			points[n++] = open;
+	}
+	if (n < DRIFT_MIN_BINS || points[n - 1].time_s - points[0].time_s < DRIFT_MIN_SPAN_S)
+		return false;
+
+	double mean_t = 0.0;
+	double mean_d = 0.0;
+	for (size_t i = 0; i < n; ++i) {
+		mean_t += points[i].time_s;
+		mean_d += points[i].delay_ms;
+	}
+	mean_t /= (double)n;
+	mean_d /= (double)n;
+
+	double sxx = 0.0;
+	double sxy = 0.0;
+	for (size_t i = 0; i < n; ++i) {
+		const double dt = points[i].time_s - mean_t;
+		sxx += dt * dt;
+		sxy += dt * (points[i].delay_ms - mean_d);
+	}
+	const double slope = sxy / sxx;
+
+	double ssr = 0.0;
+	for (size_t i = 0; i < n; ++i) {
+		const double r = points[i].delay_ms - mean_d - slope * (points[i].time_s - mean_t);
+		ssr += r * r;
+	}
+	const double slope_se = std::sqrt(ssr / (double)(n - 2) / sxx);
+
+	// ms per second is thousandths, so ppm is the slope times 1000
+	out->ppm = slope * 1000.0;
+	out->ppm_interval = 1.96 * slope_se * 1000.0;
+	out->delay_ms = mean_d + slope * (time_s - mean_t);
+	out->span_s = points[n - 1].time_s - points[0].time_s;
+	out->bins = n;
+	return true;
+}
+
+// Seconds from the fit's time until the delay moves more than tolerance_ms away
+// from compensated_ms: 0 if it already has, INFINITY if the fit never gets there.
+static inline double drift_time_to_tolerance(const struct drift_fit *fit, double compensated_ms, double tolerance_ms)
+{
+	const double error = fit->delay_ms - compensated_ms;
+	if (std::fabs(error) > tolerance_ms)
+		return 0.0;
+
+	const double slope = fit->ppm / 1000.0;
+	if (slope == 0.0)
+		return INFINITY;
+	const double edge = slope > 0.0 ? tolerance_ms : -tolerance_ms;
+	return (edge - error) / slope;
+}
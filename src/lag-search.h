@@ -0,0 +1,421 @@
+/*
+Audio Sync Analyzer - Normalized lag search kernel
+Copyright (C) 2025
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+// SYNC_NO_SIMD leaves every kernel on its scalar path, for comparing the two
+#if !defined(SYNC_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define LAG_SEARCH_SSE2 1
+#elif !defined(SYNC_NO_SIMD) && (defined(__aarch64__) || defined(_M_ARM64))
+#include <arm_neon.h>
+#define LAG_SEARCH_NEON 1
+#endif
+
+// Lags with less overlap than this are never scored at the full sample rate
+#define LAG_SEARCH_MIN_OVERLAP 1024
+// Lags prepared per pass; the block arrays stay in L1
+#define LAG_SEARCH_BLOCK 1024
+
+// The search scores every lag in [-max_lag, max_lag] as
+//
+//     corr[lag] / sqrt(energy_ref(lag) * energy_tgt(lag))
+//
+// and keeps the first maximum in ascending lag order.  Lags are processed in
+// blocks: lag_search_prepare() lays the energy products and raw correlations
+// of a block out as contiguous arrays (positive and negative lags index the
+// prefix sums in opposite directions, so the kernel never branches on sign),
+// then lag_search_kernel() scores them.
+//
+// The SIMD kernel screens four lags at a time with a single-precision
+// reciprocal square root and only scores lags that could beat the running
+// maximum with the exact double-precision expression.  The screening margin
+// is far wider than the rsqrt error, so the selected lag, its correlation and
+// the number of scored lags match the scalar loop bit for bit.
+
+struct lag_search_result {
+	double best_corr;
+	int best_lag;
+	size_t valid_count;
+};
+
+#if defined(LAG_SEARCH_SSE2)
+typedef __m128d lag_v2;
+static inline lag_v2 lag_v2_set1(double v)
+{
+	return _mm_set1_pd(v);
+}
+static inline lag_v2 lag_v2_load(const double *p)
+{
+	return _mm_loadu_pd(p);
+}
+// {p[0], p[-1]}
+static inline lag_v2 lag_v2_load_rev(const double *p)
+{
+	const __m128d v = _mm_loadu_pd(p - 1);
+	return _mm_shuffle_pd(v, v, 1);
+}
+static inline lag_v2 lag_v2_sub(lag_v2 a, lag_v2 b)
+{
+	return _mm_sub_pd(a, b);
+}
+static inline void lag_v2_store_mul(double *p, lag_v2 a, lag_v2 b)
+{
+	_mm_storeu_pd(p, _mm_mul_pd(a, b));
+}
+#elif defined(LAG_SEARCH_NEON)
+typedef float64x2_t lag_v2;
+static inline lag_v2 lag_v2_set1(double v)
+{
+	return vdupq_n_f64(v);
+}
+static inline lag_v2 lag_v2_load(const double *p)
+{
+	return vld1q_f64(p);
+}
+static inline lag_v2 lag_v2_load_rev(const double *p)
+{
+	const float64x2_t v = vld1q_f64(p - 1);
+	return vextq_f64(v, v, 1);
+}
+static inline lag_v2 lag_v2_sub(lag_v2 a, lag_v2 b)
+{
+	return vsubq_f64(a, b);
+}
+static inline void lag_v2_store_mul(double *p, lag_v2 a, lag_v2 b)
+{
+	vst1q_f64(p, vmulq_f64(a, b));
+}
+#endif
+
+// Fills energy[j] and corr[j] for lag = first + j, j < count.  Every lag must
+// leave a non-empty overlap, |lag| < frames.  Within each sign range one
+// prefix array is walked forwards and the other backwards, and the raw
+// correlations are contiguous in corr_time, so both halves vectorize.
+static inline void lag_search_prepare(const double *ref_prefix, const double *tgt_prefix, const float *corr_time,
+				      size_t frames, size_t nfft, int first, size_t count, double *energy, float *corr)
+{
+	const double ref_total = ref_prefix[frames];
+	const double tgt_total = tgt_prefix[frames];
+	const size_t negative = first < 0 ? std::min((size_t)-first, count) : 0;
+
+	// Negative lags: the reference is shifted forward by a = -lag, which falls as j rises
+	if (negative) {
+		const size_t a0 = (size_t)-first;
+		const double *ref = ref_prefix + a0;
+		const double *tgt = tgt_prefix + (frames - a0);
+		size_t j = 0;
+#if defined(LAG_SEARCH_SSE2) || defined(LAG_SEARCH_NEON)
+		const lag_v2 ref_k = lag_v2_set1(ref_total);
+		const lag_v2 tgt_k = lag_v2_set1(tgt_prefix[0]);
+		for (; j + 2 <= negative; j += 2)
+			lag_v2_store_mul(energy + j, lag_v2_sub(ref_k, lag_v2_load_rev(ref - j)),
+					 lag_v2_sub(lag_v2_load(tgt + j), tgt_k));
+#endif
+		for (; j < negative; ++j)
+			energy[j] = (ref_total - ref[-(ptrdiff_t)j]) * (tgt[j] - tgt_prefix[0]);
+		std::copy(corr_time + (nfft - a0), corr_time + (nfft - a0) + negative, corr);
+	}
+
+	// Lags >= 0: the target is shifted forward by lag, the overlap shrinks as j rises
+	if (negative < count) {
+		const size_t lag0 = (size_t)(first + (int)negative);
+		const size_t positive = count - negative;
+		const double *ref = ref_prefix + (frames - lag0);
+		const double *tgt = tgt_prefix + lag0;
+		double *out = energy + negative;
+		size_t j = 0;
+#if defined(LAG_SEARCH_SSE2) || defined(LAG_SEARCH_NEON)
+		const lag_v2 ref_k = lag_v2_set1(ref_prefix[0]);
+		const lag_v2 tgt_k = lag_v2_set1(tgt_total);
+		for (; j + 2 <= positive; j += 2)
+			lag_v2_store_mul(out + j, lag_v2_sub(lag_v2_load_rev(ref - j), ref_k),
+					 lag_v2_sub(tgt_k, lag_v2_load(tgt + j)));
+#endif
+		for (; j < positive; ++j)
+			out[j] = (ref[-(ptrdiff_t)j] - ref_prefix[0]) * (tgt_total - tgt[j]);
+		std::copy(corr_time + lag0, corr_time + lag0 + positive, corr + negative);
+	}
+}
+
+// Exact score of one lag; this is the reference every SIMD path must reproduce
+static inline void lag_search_score(double energy, float corr, int lag, struct lag_search_result *res)
+{
+	const double denom = sqrt(energy);
+	if (denom < 1e-8)
+		return;
+
+	const double value = corr / denom;
+	res->valid_count++;
+	if (value > res->best_corr) {
+		res->best_corr = value;
+		res->best_lag = lag;
+	}
+}
+
+// Smallest energy whose square root passes the 1e-8 floor in lag_search_score()
+static inline double lag_search_min_energy()
+{
+	double e = 1e-16;
+	while (sqrt(e) >= 1e-8)
+		e = nextafter(e, 0.0);
+	while (sqrt(e) < 1e-8)
+		e = nextafter(e, 1.0);
+	return e;
+}
+
+// Screening: |approx - exact| is below 2^-11 * |exact| after the rsqrt, so any
+// lag that could beat the running maximum satisfies approx + margin >= best.
+#define LAG_SEARCH_REL_MARGIN (1.0f / 256.0f)
+#define LAG_SEARCH_ABS_MARGIN 1e-6f
+// Outside this range the float energy may be denormal or infinite; such lags are always scored exactly
+#define LAG_SEARCH_SCREEN_MIN 1e-30f
+#define LAG_SEARCH_SCREEN_MAX 1e30f
+
+static inline void lag_search_kernel(const double *energy, const float *corr, size_t count, int first_lag,
+				     struct lag_search_result *res)
+{
+	size_t j = 0;
+
+#if defined(LAG_SEARCH_SSE2) || defined(LAG_SEARCH_NEON)
+	static const double min_energy = lag_search_min_energy();
+	float best_f = (float)res->best_corr;
+	size_t valid = 0;
+#endif
+
+#if defined(LAG_SEARCH_SSE2)
+	const __m128d min_e = _mm_set1_pd(min_energy);
+	const __m128 screen_min = _mm_set1_ps(LAG_SEARCH_SCREEN_MIN);
+	const __m128 screen_max = _mm_set1_ps(LAG_SEARCH_SCREEN_MAX);
+	const __m128 rel = _mm_set1_ps(LAG_SEARCH_REL_MARGIN);
+	const __m128 abs_margin = _mm_set1_ps(LAG_SEARCH_ABS_MARGIN);
+	const __m128 sign = _mm_set1_ps(-0.0f);
+
+	for (; j + 4 <= count; j += 4) {
+		const __m128d e0 = _mm_loadu_pd(energy + j);
+		const __m128d e1 = _mm_loadu_pd(energy + j + 2);
+		const int ok = _mm_movemask_pd(_mm_cmpge_pd(e0, min_e)) |
+			       (_mm_movemask_pd(_mm_cmpge_pd(e1, min_e)) << 2);
+		valid += (size_t)((ok & 1) + ((ok >> 1) & 1) + ((ok >> 2) & 1) + (ok >> 3));
+
+		const __m128 ef = _mm_movelh_ps(_mm_cvtpd_ps(e0), _mm_cvtpd_ps(e1));
+		const __m128 approx = _mm_mul_ps(_mm_loadu_ps(corr + j), _mm_rsqrt_ps(ef));
+		const __m128 margin = _mm_add_ps(_mm_mul_ps(_mm_andnot_ps(sign, approx), rel), abs_margin);
+		const __m128 beats = _mm_cmpge_ps(_mm_add_ps(approx, margin), _mm_set1_ps(best_f));
+		const __m128 unscreened = _mm_or_ps(_mm_cmplt_ps(ef, screen_min), _mm_cmpgt_ps(ef, screen_max));
+		int candidates = _mm_movemask_ps(_mm_or_ps(beats, unscreened)) & ok;
+		if (!candidates)
+			continue;
+
+		// Rare: score the candidates exactly, in lag order
+		const size_t scored = res->valid_count;
+		for (int l = 0; l < 4; ++l) {
+			if (candidates & (1 << l))
+				lag_search_score(energy[j + l], corr[j + l], first_lag + (int)(j + l), res);
+		}
+		res->valid_count = scored;
+		best_f = (float)res->best_corr;
+	}
+#elif defined(LAG_SEARCH_NEON)
+	const float64x2_t min_e = vdupq_n_f64(min_energy);
+	const float32x4_t screen_min = vdupq_n_f32(LAG_SEARCH_SCREEN_MIN);
+	const float32x4_t screen_max = vdupq_n_f32(LAG_SEARCH_SCREEN_MAX);
+	const float32x4_t rel = vdupq_n_f32(LAG_SEARCH_REL_MARGIN);
+	const float32x4_t abs_margin = vdupq_n_f32(LAG_SEARCH_ABS_MARGIN);
+
+	for (; j + 4 <= count; j += 4) {
+		const float64x2_t e0 = vld1q_f64(energy + j);
+		const float64x2_t e1 = vld1q_f64(energy + j + 2);
+		const uint32x4_t ok = vcombine_u32(vmovn_u64(vcgeq_f64(e0, min_e)), vmovn_u64(vcgeq_f64(e1, min_e)));
+		valid += vaddvq_u32(vshrq_n_u32(ok, 31));
+
+		const float32x4_t ef = vcombine_f32(vcvt_f32_f64(e0), vcvt_f32_f64(e1));
+		// vrsqrte is only good to ~8 bits; one Newton step brings it well inside the margin
+		float32x4_t r = vrsqrteq_f32(ef);
+		r = vmulq_f32(r, vrsqrtsq_f32(vmulq_f32(ef, r), r));
+		const float32x4_t approx = vmulq_f32(vld1q_f32(corr + j), r);
+		const float32x4_t margin = vaddq_f32(vmulq_f32(vabsq_f32(approx), rel), abs_margin);
+		const uint32x4_t beats = vcgeq_f32(vaddq_f32(approx, margin), vdupq_n_f32(best_f));
+		const uint32x4_t unscreened = vorrq_u32(vcltq_f32(ef, screen_min), vcgtq_f32(ef, screen_max));
+		const uint32x4_t candidates = vandq_u32(vorrq_u32(beats, unscreened), ok);
+		if (!vmaxvq_u32(candidates))
+			continue;
+
+		uint32_t lanes[4];
+		vst1q_u32(lanes, candidates);
+		const size_t scored = res->valid_count;
+		for (int l = 0; l < 4; ++l) {
+			if (lanes[l])
+				lag_search_score(energy[j + l], corr[j + l], first_lag + (int)(j + l), res);
+		}
+		res->valid_count = scored;
+		best_f = (float)res->best_corr;
+	}
+#endif
+
+#if defined(LAG_SEARCH_SSE2) || defined(LAG_SEARCH_NEON)
+	res->valid_count += valid;
+#endif
+
+	// Scalar fallback, and the tail that does not fill a vector
+	for (; j < count; ++j)
+		lag_search_score(energy[j], corr[j], first_lag + (int)j, res);
+}
+
+// Normalized peak over +/- max_lag; corr_time holds negative lags wrapped to the end.
+// Lags overlapping by fewer than min_overlap frames are skipped.
+// best_lag is 0 and best_corr -1 when no lag could be scored.
+static inline struct lag_search_result lag_search(const double *ref_prefix, const double *tgt_prefix,
+						  const float *corr_time, size_t frames, size_t nfft, int max_lag,
+						  size_t min_overlap)
+{
+	struct lag_search_result res = {-1.0, 0, 0};
+	if (frames < min_overlap || min_overlap == 0 || max_lag < 0)
+		return res;
+
+	const int limit = (int)std::min((size_t)max_lag, frames - min_overlap);
+	double energy[LAG_SEARCH_BLOCK];
+	float corr[LAG_SEARCH_BLOCK];
+
+	for (int first = -limit; first <= limit; first += LAG_SEARCH_BLOCK) {
+		const size_t count = std::min((size_t)(limit - first + 1), (size_t)LAG_SEARCH_BLOCK);
+		lag_search_prepare(ref_prefix, tgt_prefix, corr_time, frames, nfft, first, count, energy, corr);
+		lag_search_kernel(energy, corr, count, first, &res);
+	}
+	return res;
+}
+
+// Largest raw correlation within +/- max_lag, for weighted (whitened) correlations
+// whose values are not normalized by the overlap energy.
+static inline struct lag_search_result lag_search_peak(const float *corr_time, size_t frames, size_t nfft, int max_lag,
+						       size_t min_overlap)
+{
+	struct lag_search_result res = {-HUGE_VAL, 0, 0};
+	if (frames < min_overlap || min_overlap == 0 || max_lag < 0)
+		return res;
+
+	const int limit = (int)std::min((size_t)max_lag, frames - min_overlap);
+	for (int lag = -limit; lag <= limit; ++lag) {
+		const float value = corr_time[lag >= 0 ? (size_t)lag : nfft - (size_t)(-lag)];
+		if ((double)value > res.best_corr) {
+			res.best_corr = value;
+			res.best_lag = lag;
+		}
+	}
+	res.valid_count = (size_t)(2 * limit + 1);
+	return res;
+}
+
+static inline double lag_search_dot(const float *a, const float *b, size_t n)
+{
+	// Four chains keep the adds from serializing on one accumulator
+	double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		s0 += (double)a[i] * (double)b[i];
+		s1 += (double)a[i + 1] * (double)b[i + 1];
+		s2 += (double)a[i + 2] * (double)b[i + 2];
+		s3 += (double)a[i + 3] * (double)b[i + 3];
+	}
+	for (; i < n; ++i)
+		s0 += (double)a[i] * (double)b[i];
+	return (s0 + s1) + (s2 + s3);
+}
+
+// energy_ref * energy_tgt over the overlap at `lag`; |lag| must be below frames
+static inline double lag_search_energy(const double *ref_prefix, const double *tgt_prefix, size_t frames, int lag)
+{
+	const size_t abs_lag = (size_t)std::abs(lag);
+	const size_t overlap = frames - abs_lag;
+	if (lag >= 0)
+		return (ref_prefix[overlap] - ref_prefix[0]) * (tgt_prefix[frames] - tgt_prefix[abs_lag]);
+	return (ref_prefix[frames] - ref_prefix[abs_lag]) * (tgt_prefix[overlap] - tgt_prefix[0]);
+}
+
+// Raw time-domain correlation sum ref[n] * tgt[n + lag] over the overlap
+static inline float lag_search_correlate(const float *ref, const float *tgt, size_t frames, int lag)
+{
+	const size_t abs_lag = (size_t)std::abs(lag);
+	const size_t overlap = frames - abs_lag;
+	if (lag >= 0)
+		return (float)lag_search_dot(ref, tgt + abs_lag, overlap);
+	return (float)lag_search_dot(ref + abs_lag, tgt, overlap);
+}
+
+// Normalized correlation at one lag, as lag_search() scores it.  Returns false
+// when the lag has too little overlap or no energy.
+static inline bool lag_search_value(const double *ref_prefix, const double *tgt_prefix, size_t frames, int lag,
+				    float corr, size_t min_overlap, double *value)
+{
+	if ((size_t)std::abs(lag) + min_overlap > frames)
+		return false;
+
+	const double denom = sqrt(lag_search_energy(ref_prefix, tgt_prefix, frames, lag));
+	if (denom < 1e-8)
+		return false;
+
+	*value = corr / denom;
+	return true;
+}
+
+// Time-domain search over lags [lo, hi] of the full-rate windows, scored the
+// same way as lag_search().  Meant for a handful of lags around a coarse peak;
+// each lag costs one dot product over the overlap.
+static inline struct lag_search_result lag_search_refine(const float *ref, const float *tgt,
+							 const double *ref_prefix, const double *tgt_prefix,
+							 size_t frames, int lo, int hi, size_t min_overlap)
+{
+	struct lag_search_result res = {-1.0, 0, 0};
+	if (frames < min_overlap || min_overlap == 0)
+		return res;
+
+	const int limit = (int)(frames - min_overlap);
+	lo = std::max(lo, -limit);
+	hi = std::min(hi, limit);
+
+	for (int lag = lo; lag <= hi; ++lag) {
+		const double energy = lag_search_energy(ref_prefix, tgt_prefix, frames, lag);
+		lag_search_score(energy, lag_search_correlate(ref, tgt, frames, lag), lag, &res);
+	}
+	return res;
+}
+
+// Sub-sample position of a peak from the three normalized correlations around
+// it: the vertex of the parabola through (-1, before), (0, peak), (1, after).
+// The offset is clamped to half a lag; curvature is the (negative) second difference.
+static inline bool lag_search_parabolic(double before, double peak, double after, double *offset,
+					double *curvature)
+{
+	const double c = before - 2.0 * peak + after;
+	if (!(c < 0.0))
+		return false;
+
+	*offset = std::min(0.5, std::max(-0.5, 0.5 * (before - after) / c));
+	*curvature = c;
+	return true;
+}
+
+// Approximate 95% half-width, in lags, of a correlation-peak delay estimate.
+// A peak of height rho with curvature rho'' estimated from n effective samples
+// has Var(delay) ~= (1 - rho^2) / (n * rho * |rho''|): the usual small-error
+// bound, with the signal bandwidth read off the peak's sharpness.
+static inline double lag_search_interval(double peak, double curvature, double effective_frames)
+{
+	const double rho = std::min(std::max(peak, 1e-6), 1.0);
+	if (!(curvature < 0.0) || effective_frames <= 0.0)
+		return 0.5;
+
+	return 1.96 * sqrt((1.0 - rho * rho) / (effective_frames * rho * -curvature));
+}
@@ -0,0 +1,443 @@
+/*
+Audio Sync Analyzer - Offline analysis of recorded files
+Copyright (C) 2025
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+*/
+
+#include "offline-analysis.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include "drift-estimator.h"
+#include "task-pool.h"
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define WAV_FORMAT_PCM 1u
+#define WAV_FORMAT_FLOAT 3u
+#define WAV_FORMAT_EXTENSIBLE 0xfffeu
+// RF64 stores 64-bit sizes in its ds64 chunk and this in the 32-bit fields
+#define WAV_SIZE_IN_DS64 0xffffffffu
+
+static uint64_t read_le(const uint8_t *p, size_t bytes)
+{
+	uint64_t v = 0;
+	for (size_t i = 0; i < bytes; ++i)
+		v |= (uint64_t)p[i] << (8 * i);
+	return v;
+}
+
+static bool wav_map(struct wav_file *wav, const char *path, std::string *error)
+{
+#if defined(_WIN32)
+	const int wide_len = MultiByteToWideChar(CP_UTF8, 0, path, -1, nullptr, 0);
+	std::vector<wchar_t> wide((size_t)std::max(wide_len, 1));
+	MultiByteToWideChar(CP_UTF8, 0, path, -1, wide.data(), wide_len);
+
+	HANDLE file = CreateFileW(wide.data(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+				  FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		*error = "Could not open file";
+		return false;
+	}
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+		CloseHandle(file);
+		*error = "Could not read file size";
+		return false;
+	}
+	HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	void *map = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+	if (!map) {
+		if (mapping)
+			CloseHandle(mapping);
+		CloseHandle(file);
+		*error = "Could not map file";
+		return false;
+	}
+	wav->file_handle = file;
+	wav->mapping_handle = mapping;
+	wav->map = map;
+	wav->map_size = (uint64_t)size.QuadPart;
+#else
+	const int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		*error = "Could not open file";
+		return false;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0) {
+		close(fd);
+		*error = "Could not read file size";
+		return false;
+	}
+	void *map = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	// The mapping keeps the file referenced
+	close(fd);
+	if (map == MAP_FAILED) {
+		*error = "Could not map file";
+		return false;
+	}
+	wav->map = map;
+	wav->map_size = (uint64_t)st.st_size;
+#endif
+	return true;
+}
+
+void wav_close(struct wav_file *wav)
+{
+	if (wav->map) {
+#if defined(_WIN32)
+		UnmapViewOfFile(wav->map);
+		CloseHandle((HANDLE)wav->mapping_handle);
+		CloseHandle((HANDLE)wav->file_handle);
+		wav->mapping_handle = nullptr;
+		wav->file_handle = nullptr;
+#else
+		munmap(wav->map, (size_t)wav->map_size);
+#endif
+	}
+	*wav = wav_file();
+}
+
+bool wav_open(struct wav_file *wav, const char *path, std::string *error)
+{
+	wav_close(wav);
+	if (!wav_map(wav, path, error))
+		return false;
+	wav->path = path;
+
+	const uint8_t *base = static_cast<const uint8_t *>(wav->map);
+	const uint64_t size = wav->map_size;
+	const bool rf64 = size >= 12 && !memcmp(base, "RF64", 4);
+	if (size < 12 || (memcmp(base, "RIFF", 4) && !rf64) || memcmp(base + 8, "WAVE", 4)) {
+		wav_close(wav);
+		*error = "Not a WAV file";
+		return false;
+	}
+
+	uint32_t format = 0;
+	uint32_t block_align = 0;
+	uint64_t ds64_data_size = 0;
+	uint64_t data_offset = 0;
+	uint64_t data_size = 0;
+	for (uint64_t pos = 12; pos + 8 <= size;) {
+		const uint8_t *id = base + pos;
+		uint64_t chunk = read_le(id + 4, 4);
+		const uint8_t *body = id + 8;
+		if (!memcmp(id, "ds64", 4) && chunk >= 16) {
+			ds64_data_size = read_le(body + 8, 8);
+		} else if (!memcmp(id, "fmt ", 4) && chunk >= 16) {
+			format = (uint32_t)read_le(body, 2);
+			wav->channels = (uint32_t)read_le(body + 2, 2);
+			wav->sample_rate = (uint32_t)read_le(body + 4, 4);
+			block_align = (uint32_t)read_le(body + 12, 2);
+			wav->bits = (uint32_t)read_le(body + 14, 2);
+			// The extensible format keeps the real one at the start of the subformat GUID
+			if (format == WAV_FORMAT_EXTENSIBLE && chunk >= 26)
+				format = (uint32_t)read_le(body + 24, 2);
+		} else if (!memcmp(id, "data", 4)) {
+			if (rf64 && chunk == WAV_SIZE_IN_DS64)
+				chunk = ds64_data_size;
+			data_offset = pos + 8;
+			// Recorders that were cut off leave a size running past the end of the file
+			data_size = std::min(chunk, size - data_offset);
+			break;
+		}
+		pos += 8 + chunk + (chunk & 1);
+	}
+
+	const bool pcm = format == WAV_FORMAT_PCM && (wav->bits == 16 || wav->bits == 24 || wav->bits == 32);
+	const bool flt = format == WAV_FORMAT_FLOAT && wav->bits == 32;
+	if (!data_offset || !wav->channels || !wav->sample_rate || (!pcm && !flt) ||
+	    block_align != wav->channels * (wav->bits / 8)) {
+		wav_close(wav);
+		*error = "Unsupported WAV format (needs 16/24/32-bit PCM or 32-bit float)";
+		return false;
+	}
+
+	wav->is_float = flt;
+	wav->samples = base + data_offset;
+	wav->frames = data_size / block_align;
+	return true;
+}
+
+static inline float wav_sample(const uint8_t *p, uint32_t bits, bool is_float)
+{
+	if (is_float) {
+		float v;
+		memcpy(&v, p, sizeof(v));
+		return v;
+	}
+	// Shift into the top of an int32 so every width sign-extends the same way
+	const int32_t v = (int32_t)((uint32_t)read_le(p, bits / 8) << (32 - bits));
+	return (float)v * (1.0f / 2147483648.0f);
+}
+
+void wav_read(const struct wav_file *wav, int channel, uint64_t start, size_t frames, float *dst)
+{
+	const size_t bytes = wav->bits / 8;
+	const size_t stride = bytes * wav->channels;
+	const size_t available = start < wav->frames ? (size_t)std::min<uint64_t>(frames, wav->frames - start) : 0;
+	const uint8_t *frame = available ? wav->samples + start * stride : wav->samples;
+
+	if (channel >= 0 && (uint32_t)channel < wav->channels) {
+		const uint8_t *p = frame + (size_t)channel * bytes;
+		for (size_t i = 0; i < available; ++i, p += stride)
+			dst[i] = wav_sample(p, wav->bits, wav->is_float);
+	} else {
+		const float scale = 1.0f / (float)wav->channels;
+		for (size_t i = 0; i < available; ++i, frame += stride) {
+			float sum = 0.0f;
+			for (size_t c = 0; c < wav->channels; ++c)
+				sum += wav_sample(frame + c * bytes, wav->bits, wav->is_float);
+			dst[i] = sum * scale;
+		}
+	}
+	std::fill(dst + available, dst + frames, 0.0f);
+}
+
+// One worker of offline_analyze(); workers pull windows until none are left
+struct offline_job {
+	const struct sync_engine *engine;
+	const struct offline_settings *settings;
+	const struct offline_track *ref;
+	const struct offline_track *targets;
+	size_t count;
+	size_t frames;
+	uint64_t hop;
+	std::atomic<size_t> *next;
+	std::atomic<size_t> *done;
+	std::atomic<bool> *stop;
+	std::vector<struct offline_window> *out;
+	std::vector<uint8_t> *measured;
+	// Set on the job run by the calling thread only
+	offline_progress_fn progress;
+	void *progress_param;
+};
+
+static void offline_job_run(void *param)
+{
+	struct offline_job *job = static_cast<struct offline_job *>(param);
+	const size_t windows = job->out->size();
+
+	struct correlation_workspace ws;
+	std::vector<struct target_workspace> tws(job->count);
+	std::vector<float> ref(job->frames);
+	std::vector<std::vector<float>> tgt(job->count, std::vector<float>(job->frames));
+	const float *tgt_ptrs[MAX_TARGETS];
+	for (size_t i = 0; i < job->count; ++i)
+		tgt_ptrs[i] = tgt[i].data();
+
+	while (!job->stop->load(std::memory_order_relaxed)) {
+		const size_t w = job->next->fetch_add(1, std::memory_order_relaxed);
+		if (w >= windows)
+			break;
+
+		const uint64_t start = (uint64_t)w * job->hop;
+		wav_read(job->ref->file, job->ref->channel, start, job->frames, ref.data());
+		for (size_t i = 0; i < job->count; ++i)
+			wav_read(job->targets[i].file, job->targets[i].channel, start, job->frames, tgt[i].data());
+
+		sync_engine_measure(job->engine, &job->settings->engine, &ws, tws.data(), ref.data(), tgt_ptrs,
+				    job->count, job->frames, (*job->out)[w].targets.data());
+		(*job->measured)[w] = 1;
+		const size_t done = job->done->fetch_add(1, std::memory_order_relaxed) + 1;
+
+		if (job->progress && !job->progress(job->progress_param, done, windows))
+			job->stop->store(true, std::memory_order_relaxed);
+	}
+}
+
+bool offline_analyze(const struct sync_engine *engine, const struct offline_settings *settings,
+		     const struct offline_track *ref, const struct offline_track *targets, size_t count,
+		     offline_progress_fn progress, void *progress_param, std::vector<struct offline_window> *out,
+		     std::string *error)
+{
+	out->clear();
+	if (count == 0 || count > MAX_TARGETS) {
+		*error = "Needs between 1 and 16 target tracks";
+		return false;
+	}
+
+	const uint32_t sample_rate = ref->file->sample_rate;
+	uint64_t length = ref->file->frames;
+	for (size_t i = 0; i < count; ++i) {
+		if (targets[i].file->sample_rate != sample_rate) {
+			*error = "All tracks must have the same sample rate";
+			return false;
+		}
+		length = std::min(length, targets[i].file->frames);
+	}
+
+	// Windows are measured at the recording's rate, whatever the engine was set up for
+	struct sync_engine serial = *engine;
+	if (serial.sample_rate != sample_rate)
+		sync_engine_init(&serial, sample_rate, engine->pool, engine->log);
+	serial.pool = nullptr;
+	// Thousands of windows would flood the log with per-window lines
+	if (!settings->engine.debug)
+		serial.log = nullptr;
+
+	const size_t frames = ms_to_samples(settings->engine.window_ms, sample_rate);
+	const uint64_t hop = std::max<uint64_t>(1, ms_to_samples(settings->hop_ms, sample_rate));
+	if (frames < 1024 || length < frames) {
+		*error = "Recording is shorter than one analysis window";
+		return false;
+	}
+
+	const size_t windows = (size_t)((length - frames) / hop + 1);
+	out->resize(windows);
+	for (size_t w = 0; w < windows; ++w) {
+		(*out)[w].time_s = ((double)((uint64_t)w * hop) + 0.5 * (double)frames) / (double)sample_rate;
+		(*out)[w].targets.assign(count, measurement_sample());
+	}
+
+	size_t workers = settings->workers;
+	if (workers == 0)
+		workers = engine->pool ? engine->pool->threads.size() + 1 : 1;
+	workers = std::max<size_t>(1, std::min(workers, windows));
+	if (!engine->pool)
+		workers = 1;
+
+	std::atomic<size_t> next{0};
+	std::atomic<size_t> done{0};
+	std::atomic<bool> stop{false};
+	std::vector<uint8_t> measured(windows, 0);
+	std::vector<struct offline_job> jobs(workers);
+	std::vector<void *> job_params(workers);
+	for (size_t w = 0; w < workers; ++w) {
+		jobs[w] = {&serial, settings, ref, targets, count, frames, hop, &next, &done, &stop, out, &measured,
+			   w == 0 ? progress : nullptr, progress_param};
+		job_params[w] = &jobs[w];
+	}
+
+	struct task_batch batch;
+	if (engine->pool)
+		task_pool_parallel(engine->pool, &batch, offline_job_run, job_params.data(), workers,
+				   TASK_PRIORITY_LOW);
+	else
+		offline_job_run(job_params[0]);
+
+	if (!stop.load(std::memory_order_relaxed))
+		return true;
+
+	// Keep what was measured before the stop
+	size_t kept = 0;
+	for (size_t w = 0; w < windows; ++w) {
+		if (measured[w])
+			(*out)[kept++] = std::move((*out)[w]);
+	}
+	out->resize(kept);
+	*error = "Cancelled";
+	return false;
+}
+
+static FILE *open_utf8(const char *path)
+{
+#if defined(_WIN32)
+	const int wide_len = MultiByteToWideChar(CP_UTF8, 0, path, -1, nullptr, 0);
+	std::vector<wchar_t> wide((size_t)std::max(wide_len, 1));
+	MultiByteToWideChar(CP_UTF8, 0, path, -1, wide.data(), wide_len);
+	return _wfopen(wide.data(), L"w");
+#else
+	return fopen(path, "w");
+#endif
+}
+
+bool offline_write_csv(const char *path, const struct offline_track *targets, size_t count,
+		       const std::vector<struct offline_window> &windows)
+{
+	FILE *f = path ? open_utf8(path) : stdout;
+	if (!f)
+		return false;
+
+	fprintf(f, "time_s");
+	for (size_t i = 0; i < count; ++i) {
+		const char *name = targets[i].name.c_str();
+		fprintf(f, ",%s delay_ms,%s interval_ms,%s correlation", name, name, name);
+	}
+	fprintf(f, "\n");
+
+	for (const auto &w : windows) {
+		fprintf(f, "%.3f", w.time_s);
+		for (size_t i = 0; i < count; ++i) {
+			const measurement_sample &s = w.targets[i];
+			if (s.success)
+				fprintf(f, ",%.3f,%.3f,%.4f", s.delay_ms, s.interval_ms, s.correlation);
+			else
+				fprintf(f, ",,,%.4f", s.correlation);
+		}
+		fprintf(f, "\n");
+	}
+
+	const bool ok = !ferror(f);
+	if (path)
+		fclose(f);
+	return ok;
+}
+
+static double median(std::vector<double> *values)
+{
+	std::sort(values->begin(), values->end());
+	const size_t n = values->size();
+	return n % 2 ? (*values)[n / 2] : 0.5 * ((*values)[n / 2 - 1] + (*values)[n / 2]);
+}
+
+std::string offline_summary(const struct offline_track *targets, size_t count,
+			    const std::vector<struct offline_window> &windows)
+{
+	std::string text;
+	const size_t tenth = std::max<size_t>(1, windows.size() / 10);
+	for (size_t i = 0; i < count; ++i) {
+		std::vector<double> all, head, tail;
+		struct drift_estimator drift;
+		for (size_t w = 0; w < windows.size(); ++w) {
+			const measurement_sample &s = windows[w].targets[i];
+			if (!s.success)
+				continue;
+			drift_add(&drift, windows[w].time_s, s.delay_ms, s.interval_ms);
+			all.push_back(s.delay_ms);
+			if (w < tenth)
+				head.push_back(s.delay_ms);
+			if (w + tenth >= windows.size())
+				tail.push_back(s.delay_ms);
+		}
+
+		char line[256];
+		if (all.empty()) {
+			snprintf(line, sizeof(line), "Target '%s': no window above the threshold",
+				 targets[i].name.c_str());
+		} else {
+			const double change = !head.empty() && !tail.empty() ? median(&tail) - median(&head) : 0.0;
+			snprintf(line, sizeof(line),
+				 "Target '%s': median %+.2f ms, drift %+.2f ms over the file (%zu/%zu windows)",
+				 targets[i].name.c_str(), median(&all), change, all.size(), windows.size());
+			struct drift_fit fit;
+			if (drift_estimate(&drift, windows.back().time_s, &fit)) {
+				const size_t len = strlen(line);
+				snprintf(line + len, sizeof(line) - len, ", %+.1f ±%.1f ppm", fit.ppm, fit.ppm_interval);
+			}
+		}
+		if (!text.empty())
+			text += "\n";
+		text += line;
+	}
+	return text;
+}
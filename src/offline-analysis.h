@@ -0,0 +1,98 @@
+/*
+Audio Sync Analyzer - Offline analysis of recorded files
+Copyright (C) 2025
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "channel-mix.h"
+#include "sync-engine.h"
+
+// Runs the live measurement on sliding windows across whole recordings.  Files
+// are memory-mapped and each window is decoded only when a worker reaches it,
+// so an hour-long recording never has to fit in memory and the windows are
+// measured in parallel on the worker pool.
+
+#define OFFLINE_DEFAULT_HOP_MS 1000u
+
+// A WAV file mapped read-only.  Only integer PCM of 16, 24 or 32 bits and
+// 32-bit float are decoded; RF64 covers recordings past 4 GiB.
+struct wav_file {
+	const uint8_t *samples = nullptr;
+	uint64_t frames = 0;
+	uint32_t channels = 0;
+	uint32_t sample_rate = 0;
+	uint32_t bits = 0;
+	bool is_float = false;
+	std::string path;
+
+	void *map = nullptr;
+	uint64_t map_size = 0;
+#if defined(_WIN32)
+	void *file_handle = nullptr;
+	void *mapping_handle = nullptr;
+#endif
+};
+
+// Maps `path` and parses its header.  On failure *error says why and nothing stays open.
+bool wav_open(struct wav_file *wav, const char *path, std::string *error);
+void wav_close(struct wav_file *wav);
+
+// Decodes frames [start, start + frames) into dst.  `channel` picks one channel;
+// CAPTURE_CHANNEL_MIX (-1) averages all of them.  Frames past the end read as silence.
+void wav_read(const struct wav_file *wav, int channel, uint64_t start, size_t frames, float *dst);
+
+// One track of a recording: a channel of an opened file
+struct offline_track {
+	const struct wav_file *file;
+	int channel;
+	std::string name;
+};
+
+struct offline_settings {
+	struct sync_engine_settings engine;
+	// Spacing of window starts; windows overlap when it is shorter than window_ms
+	uint32_t hop_ms = OFFLINE_DEFAULT_HOP_MS;
+	// Windows measured at once, counting the calling thread.  0 uses every pool
+	// thread plus the caller; a caller that is itself a pool worker can pass
+	// fewer to leave threads free for interactive work.
+	size_t workers = 0;
+};
+
+// Results of one window, stacked per target in the order they were given
+struct offline_window {
+	double time_s;
+	std::vector<measurement_sample> targets;
+};
+
+// Called on the calling thread only, between windows.  Returning false stops
+// the analysis; windows not reached yet are dropped from the result.
+typedef bool (*offline_progress_fn)(void *param, uint64_t done, uint64_t total);
+
+// Measures every target against the reference in windows of settings->engine.window_ms
+// every hop_ms.  All tracks must share one sample rate and are taken to start
+// together.  Uses the engine's pool when set.
+bool offline_analyze(const struct sync_engine *engine, const struct offline_settings *settings,
+		     const struct offline_track *ref, const struct offline_track *targets, size_t count,
+		     offline_progress_fn progress, void *progress_param, std::vector<struct offline_window> *out,
+		     std::string *error);
+
+// Delay-vs-time curve: one row per window with delay, interval and correlation
+// per target, empty fields where a window had no result.  A null path writes to stdout.
+bool offline_write_csv(const char *path, const struct offline_track *targets, size_t count,
+		       const std::vector<struct offline_window> &windows);
+
+// Per target: windows with a result, median delay, the change in delay from
+// the first to the last tenth of the recording, and the fitted clock skew
+std::string offline_summary(const struct offline_track *targets, size_t count,
+			    const std::vector<struct offline_window> &windows);
@@ -24,6 +24,7 @@ OBS_DECLARE_MODULE()
 OBS_MODULE_USE_DEFAULT_LOCALE(PLUGIN_NAME, "en-US")
 
 void audio_sync_frontend_init_module(void);
+void audio_sync_frontend_post_load_module(void);
 void audio_sync_frontend_shutdown_module(void);
 
 bool obs_module_load(void)
@@ -34,6 +35,11 @@ bool obs_module_load(void)
 	return true;
 }
 
+void obs_module_post_load(void)
+{
+	audio_sync_frontend_post_load_module();
+}
+
 void obs_module_unload(void)
 {
 	audio_sync_frontend_shutdown_module();
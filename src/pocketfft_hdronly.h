@@ -2388,9 +2388,17 @@ template<typename T> void radbg(size_t ido, size_t ip, size_t l1,
     template<typename T> void exec(T c[], T0 fct, bool r2hc) const
       {
       if (length==1) { c[0]*=fct; return; }
-      size_t nf=fact.size();
       arr<T> ch(length);
-      T *p1=c, *p2=ch.data();
+      exec(c, ch.data(), fct, r2hc);
+      }
+
+    // audio-sync-analyzer: variant taking caller-owned scratch of `length`
+    // elements so repeated transforms do not allocate
+    template<typename T> void exec(T c[], T scratch[], T0 fct, bool r2hc) const
+      {
+      if (length==1) { c[0]*=fct; return; }
+      size_t nf=fact.size();
+      T *p1=c, *p2=scratch;
 
       if (r2hc)
         for(size_t k1=0, l1=length; k1<nf;++k1)
@@ -2688,6 +2696,11 @@ template<typename T0> class pocketfft_r
     template<typename T> POCKETFFT_NOINLINE void exec(T c[], T0 fct, bool fwd) const
       { packplan ? packplan->exec(c,fct,fwd) : blueplan->exec_r(c,fct,fwd); }
 
+    // audio-sync-analyzer: scratch must hold length() elements; only the
+    // FFTPACK path can use it, Bluestein plans still allocate internally
+    template<typename T> POCKETFFT_NOINLINE void exec(T c[], T scratch[], T0 fct, bool fwd) const
+      { packplan ? packplan->exec(c,scratch,fct,fwd) : blueplan->exec_r(c,fct,fwd); }
+
     size_t length() const { return len; }
   };
 
@@ -0,0 +1,283 @@
+/*
+Audio Sync Analyzer - Capture ring sample formats
+Copyright (C) 2025
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if !defined(SYNC_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define SAMPLE_FORMAT_SSE2 1
+#if defined(__F16C__)
+#include <immintrin.h>
+#define SAMPLE_FORMAT_F16C 1
+#endif
+#elif !defined(SYNC_NO_SIMD) && (defined(__aarch64__) || defined(_M_ARM64))
+#include <arm_neon.h>
+#define SAMPLE_FORMAT_NEON 1
+#endif
+
+// Storage precision of a capture ring.  Stored in settings by value; append new formats at the end.
+enum sample_format {
+	SAMPLE_FORMAT_F32 = 0,
+	// Full scale maps to +/-32767; louder samples saturate
+	SAMPLE_FORMAT_S16 = 1,
+	// IEEE half precision, about 11 significant bits over the full float range we see
+	SAMPLE_FORMAT_F16 = 2,
+	SAMPLE_FORMAT_COUNT
+};
+
+static inline const char *sample_format_name(enum sample_format format)
+{
+	switch (format) {
+	case SAMPLE_FORMAT_S16:
+		return "16-bit integer";
+	case SAMPLE_FORMAT_F16:
+		return "16-bit float";
+	default:
+		return "32-bit float";
+	}
+}
+
+static inline enum sample_format sample_format_from_int(long long value)
+{
+	return value > 0 && value < SAMPLE_FORMAT_COUNT ? (enum sample_format)value : SAMPLE_FORMAT_F32;
+}
+
+static inline size_t sample_format_size(enum sample_format format)
+{
+	return format == SAMPLE_FORMAT_F32 ? sizeof(float) : sizeof(uint16_t);
+}
+
+#define SAMPLE_S16_SCALE 32767.0f
+
+static inline int16_t sample_to_s16(float v)
+{
+	v *= SAMPLE_S16_SCALE;
+	v = v < -SAMPLE_S16_SCALE ? -SAMPLE_S16_SCALE : (v > SAMPLE_S16_SCALE ? SAMPLE_S16_SCALE : v);
+	return (int16_t)(v < 0.0f ? v - 0.5f : v + 0.5f);
+}
+
+// Round-to-nearest-even float -> half without F16C (after F. Giesen's float_to_half_fast3_rtne)
+static inline uint16_t sample_to_f16(float v)
+{
+	uint32_t f;
+	memcpy(&f, &v, sizeof(f));
+	const uint32_t sign = f & 0x80000000u;
+	f ^= sign;
+
+	uint16_t o;
+	if (f >= (143u << 23)) {
+		// Overflow to infinity; NaN stays NaN
+		o = f > (255u << 23) ? 0x7e00 : 0x7c00;
+	} else if (f < (113u << 23)) {
+		// Subnormal half: let the FPU round by adding 0.5
+		float t;
+		const uint32_t denorm_magic = ((127u - 15u) + (23u - 10u) + 1u) << 23;
+		memcpy(&t, &f, sizeof(t));
+		float magic;
+		memcpy(&magic, &denorm_magic, sizeof(magic));
+		t += magic;
+		uint32_t u;
+		memcpy(&u, &t, sizeof(u));
+		o = (uint16_t)(u - denorm_magic);
+	} else {
+		const uint32_t mant_odd = (f >> 13) & 1u;
+		f += ((uint32_t)(15 - 127) << 23) + 0xfffu;
+		f += mant_odd;
+		o = (uint16_t)(f >> 13);
+	}
+	return (uint16_t)(o | (sign >> 16));
+}
+
+static inline float sample_from_f16(uint16_t h)
+{
+	const uint32_t sign = (uint32_t)(h & 0x8000u) << 16;
+	const uint32_t exp = (h >> 10) & 0x1fu;
+	const uint32_t mant = h & 0x3ffu;
+
+	uint32_t f;
+	if (exp == 0x1f) {
+		f = sign | 0x7f800000u | (mant << 13);
+	} else if (exp != 0) {
+		f = sign | ((exp + 112u) << 23) | (mant << 13);
+	} else {
+		// Zero or subnormal: mant * 2^-24
+		const float v = (float)mant * (1.0f / 16777216.0f);
+		memcpy(&f, &v, sizeof(f));
+		f |= sign;
+	}
+	float v;
+	memcpy(&v, &f, sizeof(v));
+	return v;
+}
+
+#if defined(SAMPLE_FORMAT_SSE2) && !defined(SAMPLE_FORMAT_F16C)
+// The scalar conversions above on four lanes at once, for SSE2 without F16C:
+// every case is computed and the right one picked with compare masks, so the
+// result matches bit for bit without a branch per sample
+static inline __m128i sample_select_sse2(__m128i mask, __m128i a, __m128i b)
+{
+	return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+// Four floats to halves, one per 32-bit lane
+static inline __m128i sample_to_f16_sse2(__m128 v)
+{
+	const __m128i denorm_magic = _mm_set1_epi32((int)(((127u - 15u) + (23u - 10u) + 1u) << 23));
+	__m128i f = _mm_castps_si128(v);
+	const __m128i sign = _mm_and_si128(f, _mm_set1_epi32((int)0x80000000u));
+	f = _mm_xor_si128(f, sign);
+
+	// With the sign cleared the bits compare correctly as signed integers
+	const __m128i overflow = _mm_cmpgt_epi32(f, _mm_set1_epi32((int)((143u << 23) - 1u)));
+	const __m128i nan = _mm_cmpgt_epi32(f, _mm_set1_epi32((int)(255u << 23)));
+	const __m128i subnormal = _mm_cmplt_epi32(f, _mm_set1_epi32((int)(113u << 23)));
+
+	const __m128i inf_nan = sample_select_sse2(nan, _mm_set1_epi32(0x7e00), _mm_set1_epi32(0x7c00));
+	const __m128 t = _mm_add_ps(_mm_castsi128_ps(f), _mm_castsi128_ps(denorm_magic));
+	const __m128i denorm = _mm_sub_epi32(_mm_castps_si128(t), denorm_magic);
+	const __m128i mant_odd = _mm_and_si128(_mm_srli_epi32(f, 13), _mm_set1_epi32(1));
+	__m128i normal = _mm_add_epi32(f, _mm_set1_epi32((int)(((uint32_t)(15 - 127) << 23) + 0xfffu)));
+	normal = _mm_srli_epi32(_mm_add_epi32(normal, mant_odd), 13);
+
+	__m128i o = sample_select_sse2(subnormal, denorm, normal);
+	o = sample_select_sse2(overflow, inf_nan, o);
+	return _mm_or_si128(o, _mm_srli_epi32(sign, 16));
+}
+
+// Four halves, one per 32-bit lane, to floats
+static inline __m128 sample_from_f16_sse2(__m128i h)
+{
+	const __m128i exp_mask = _mm_set1_epi32(0x7c00 << 13);
+	const __m128i sign = _mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(0x8000)), 16);
+	__m128i o = _mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(0x7fff)), 13);
+	const __m128i exp = _mm_and_si128(o, exp_mask);
+	o = _mm_add_epi32(o, _mm_set1_epi32((127 - 15) << 23));
+
+	// Infinity and NaN keep the maximum exponent
+	const __m128i inf_nan = _mm_cmpeq_epi32(exp, exp_mask);
+	o = _mm_add_epi32(o, _mm_and_si128(inf_nan, _mm_set1_epi32((128 - 16) << 23)));
+
+	// Zero and subnormals: mant * 2^-24 as (1 + mant / 1024) * 2^-14 - 2^-14, which is exact
+	const __m128i zero = _mm_cmpeq_epi32(exp, _mm_setzero_si128());
+	const __m128 magic = _mm_castsi128_ps(_mm_set1_epi32(113 << 23));
+	const __m128 denorm = _mm_sub_ps(_mm_castsi128_ps(_mm_add_epi32(o, _mm_set1_epi32(1 << 23))), magic);
+	o = sample_select_sse2(zero, _mm_castps_si128(denorm), o);
+	return _mm_castsi128_ps(_mm_or_si128(o, sign));
+}
+#endif
+
+// Converts `frames` floats into `format` at dst
+static inline void sample_encode(enum sample_format format, const float *src, void *dst, size_t frames)
+{
+	if (format == SAMPLE_FORMAT_F32) {
+		memcpy(dst, src, frames * sizeof(float));
+		return;
+	}
+
+	size_t i = 0;
+	if (format == SAMPLE_FORMAT_S16) {
+		int16_t *out = static_cast<int16_t *>(dst);
+#if defined(SAMPLE_FORMAT_SSE2)
+		// cvtps rounds to nearest and packs saturates, so only the scale is needed
+		const __m128 scale = _mm_set1_ps(SAMPLE_S16_SCALE);
+		for (; i + 8 <= frames; i += 8) {
+			const __m128i a = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(src + i), scale));
+			const __m128i b = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(src + i + 4), scale));
+			_mm_storeu_si128((__m128i *)(out + i), _mm_packs_epi32(a, b));
+		}
+#elif defined(SAMPLE_FORMAT_NEON)
+		const float32x4_t scale = vdupq_n_f32(SAMPLE_S16_SCALE);
+		for (; i + 8 <= frames; i += 8) {
+			const int32x4_t a = vcvtnq_s32_f32(vmulq_f32(vld1q_f32(src + i), scale));
+			const int32x4_t b = vcvtnq_s32_f32(vmulq_f32(vld1q_f32(src + i + 4), scale));
+			vst1q_s16(out + i, vcombine_s16(vqmovn_s32(a), vqmovn_s32(b)));
+		}
+#endif
+		for (; i < frames; ++i)
+			out[i] = sample_to_s16(src[i]);
+		return;
+	}
+
+	uint16_t *out = static_cast<uint16_t *>(dst);
+#if defined(SAMPLE_FORMAT_F16C)
+	for (; i + 8 <= frames; i += 8)
+		_mm_storeu_si128((__m128i *)(out + i),
+				 _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT));
+#elif defined(SAMPLE_FORMAT_SSE2)
+	for (; i + 8 <= frames; i += 8) {
+		// Sign-extend each half from the low 16 bits so the signed saturating pack keeps its bits
+		const __m128i a = _mm_srai_epi32(_mm_slli_epi32(sample_to_f16_sse2(_mm_loadu_ps(src + i)), 16), 16);
+		const __m128i b = _mm_srai_epi32(_mm_slli_epi32(sample_to_f16_sse2(_mm_loadu_ps(src + i + 4)), 16), 16);
+		_mm_storeu_si128((__m128i *)(out + i), _mm_packs_epi32(a, b));
+	}
+#elif defined(SAMPLE_FORMAT_NEON)
+	for (; i + 4 <= frames; i += 4)
+		vst1_u16(out + i, vreinterpret_u16_f16(vcvt_f16_f32(vld1q_f32(src + i))));
+#endif
+	for (; i < frames; ++i)
+		out[i] = sample_to_f16(src[i]);
+}
+
+// Expands `frames` samples stored as `format` into floats
+static inline void sample_decode(enum sample_format format, const void *src, float *dst, size_t frames)
+{
+	if (format == SAMPLE_FORMAT_F32) {
+		memcpy(dst, src, frames * sizeof(float));
+		return;
+	}
+
+	size_t i = 0;
+	if (format == SAMPLE_FORMAT_S16) {
+		const int16_t *in = static_cast<const int16_t *>(src);
+		const float scale = 1.0f / SAMPLE_S16_SCALE;
+#if defined(SAMPLE_FORMAT_SSE2)
+		const __m128 vscale = _mm_set1_ps(scale);
+		for (; i + 8 <= frames; i += 8) {
+			const __m128i v = _mm_loadu_si128((const __m128i *)(in + i));
+			// Sign-extend by placing each sample in the top half of a lane and shifting down
+			const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+			const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+			_mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), vscale));
+			_mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), vscale));
+		}
+#elif defined(SAMPLE_FORMAT_NEON)
+		const float32x4_t vscale = vdupq_n_f32(scale);
+		for (; i + 8 <= frames; i += 8) {
+			const int16x8_t v = vld1q_s16(in + i);
+			vst1q_f32(dst + i, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v))), vscale));
+			vst1q_f32(dst + i + 4, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v))), vscale));
+		}
+#endif
+		for (; i < frames; ++i)
+			dst[i] = (float)in[i] * scale;
+		return;
+	}
+
+	const uint16_t *in = static_cast<const uint16_t *>(src);
+#if defined(SAMPLE_FORMAT_F16C)
+	for (; i + 8 <= frames; i += 8)
+		_mm256_storeu_ps(dst + i, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *)(in + i))));
+#elif defined(SAMPLE_FORMAT_SSE2)
+	for (; i + 8 <= frames; i += 8) {
+		const __m128i v = _mm_loadu_si128((const __m128i *)(in + i));
+		_mm_storeu_ps(dst + i, sample_from_f16_sse2(_mm_unpacklo_epi16(v, _mm_setzero_si128())));
+		_mm_storeu_ps(dst + i + 4, sample_from_f16_sse2(_mm_unpackhi_epi16(v, _mm_setzero_si128())));
+	}
+#elif defined(SAMPLE_FORMAT_NEON)
+	for (; i + 4 <= frames; i += 4)
+		vst1q_f32(dst + i, vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(in + i))));
+#endif
+	for (; i < frames; ++i)
+		dst[i] = sample_from_f16(in[i]);
+}
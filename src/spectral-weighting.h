@@ -0,0 +1,207 @@
+/*
+Audio Sync Analyzer - Generalized cross-correlation weightings
+Copyright (C) 2025
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+// Frequency weighting applied to the cross spectrum before the inverse FFT.
+// Stored in settings by value; append new kinds at the end.
+enum spectral_weighting {
+	// Plain cross-correlation
+	WEIGHTING_NONE = 0,
+	// Phase transform: every bin in the band gets unit magnitude
+	WEIGHTING_PHAT = 1,
+	// Smoothed coherence transform: divide by the smoothed auto spectra
+	WEIGHTING_SCOT = 2,
+	// Hannan-Thomson style: weight each bin by its estimated coherence
+	WEIGHTING_COHERENCE = 3,
+	WEIGHTING_COUNT
+};
+
+// Width of the box used to estimate auto spectra and coherence from one window
+#define WEIGHTING_SMOOTH_Hz 40.0
+// Coherence is clamped below 1 so a perfect bin cannot take all the weight
+#define WEIGHTING_MAX_COHERENCE 0.99
+
+static inline const char *spectral_weighting_name(enum spectral_weighting kind)
+{
+	switch (kind) {
+	case WEIGHTING_PHAT:
+		return "PHAT";
+	case WEIGHTING_SCOT:
+		return "SCOT";
+	case WEIGHTING_COHERENCE:
+		return "Smoothed coherence";
+	default:
+		return "None";
+	}
+}
+
+static inline enum spectral_weighting spectral_weighting_from_int(long long value)
+{
+	return value > 0 && value < WEIGHTING_COUNT ? (enum spectral_weighting)value : WEIGHTING_NONE;
+}
+
+// Complex bins of a halfcomplex spectrum that carry the bandpassed content.
+// Bins outside the band hold little but noise, which whitening would amplify
+// to full weight, so every weighting zeroes them.
+struct spectral_band {
+	size_t first_bin;
+	size_t last_bin;
+	size_t smooth_radius;
+};
+
+static inline struct spectral_band spectral_band_for(size_t nfft, double sample_rate, double low_hz, double high_hz)
+{
+	struct spectral_band band;
+	const double bin_hz = sample_rate / (double)nfft;
+	const size_t top = nfft / 2 - 1;
+	band.first_bin = std::max<size_t>(1, (size_t)(low_hz / bin_hz));
+	band.last_bin = std::min(top, (size_t)std::ceil(high_hz / bin_hz));
+	band.first_bin = std::min(band.first_bin, band.last_bin);
+	band.smooth_radius = (size_t)(0.5 * WEIGHTING_SMOOTH_Hz / bin_hz);
+	return band;
+}
+
+// Reference-side auto spectrum, computed once per measurement and shared by every target
+struct spectral_reference {
+	std::vector<float> power;
+	std::vector<double> prefix;
+};
+
+// Per-target scratch
+struct spectral_scratch {
+	std::vector<float> power;
+	std::vector<double> prefix;
+	// |conj(R) * T| per bin and its prefix sums, for the coherence estimate
+	std::vector<float> magnitude;
+	std::vector<double> magnitude_prefix;
+};
+
+static inline float spectral_power(const float *spec, size_t k)
+{
+	const float re = spec[2 * k - 1];
+	const float im = spec[2 * k];
+	return re * re + im * im;
+}
+
+// Mean of prefix-summed values over [k - radius, k + radius], clipped to the band
+static inline double spectral_smoothed(const double *prefix, const struct spectral_band *band, size_t k)
+{
+	const size_t lo = k > band->first_bin + band->smooth_radius ? k - band->smooth_radius : band->first_bin;
+	const size_t hi = std::min(k + band->smooth_radius, band->last_bin);
+	return (prefix[hi + 1 - band->first_bin] - prefix[lo - band->first_bin]) / (double)(hi - lo + 1);
+}
+
+static inline void spectral_prefix(const float *values, const struct spectral_band *band, std::vector<double> *prefix)
+{
+	const size_t count = band->last_bin - band->first_bin + 1;
+	prefix->resize(count + 1);
+	(*prefix)[0] = 0.0;
+	for (size_t i = 0; i < count; ++i)
+		(*prefix)[i + 1] = (*prefix)[i] + (double)values[band->first_bin + i];
+}
+
+static inline void spectral_reference_prepare(const float *ref_spec, size_t nfft, const struct spectral_band *band,
+					      enum spectral_weighting kind, struct spectral_reference *ref)
+{
+	if (kind != WEIGHTING_SCOT && kind != WEIGHTING_COHERENCE)
+		return;
+
+	ref->power.resize(nfft / 2);
+	for (size_t k = band->first_bin; k <= band->last_bin; ++k)
+		ref->power[k] = spectral_power(ref_spec, k);
+	spectral_prefix(ref->power.data(), band, &ref->prefix);
+}
+
+// Replaces tgt_spec with the weighted cross spectrum conj(R) * T * w.  Returns
+// the value the inverse transform (scaled by 1 / nfft) would reach at a lag
+// where every bin lines up, sum over bins of 2 * w * |R| * |T| / nfft, so the
+// caller can turn the weighted peak into a score in [-1, 1].
+static inline double spectral_weighting_apply(enum spectral_weighting kind, const float *ref_spec,
+					      const struct spectral_reference *ref, float *tgt_spec, size_t nfft,
+					      const struct spectral_band *band, struct spectral_scratch *scratch)
+{
+	const bool smoothed = kind == WEIGHTING_SCOT || kind == WEIGHTING_COHERENCE;
+	if (smoothed) {
+		scratch->power.resize(nfft / 2);
+		for (size_t k = band->first_bin; k <= band->last_bin; ++k)
+			scratch->power[k] = spectral_power(tgt_spec, k);
+		spectral_prefix(scratch->power.data(), band, &scratch->prefix);
+	}
+
+	// Cross spectrum; the coherence weighting needs all of it before any bin is weighted
+	for (size_t k = band->first_bin; k <= band->last_bin; ++k) {
+		const float rr = ref_spec[2 * k - 1];
+		const float ri = ref_spec[2 * k];
+		const float tr = tgt_spec[2 * k - 1];
+		const float ti = tgt_spec[2 * k];
+		tgt_spec[2 * k - 1] = rr * tr + ri * ti;
+		tgt_spec[2 * k] = rr * ti - ri * tr;
+	}
+
+	// A single window has no segments to average, so coherence is estimated over
+	// neighbouring bins.  The cross spectrum's phase rotates across bins by the
+	// delay itself, so it is the magnitudes that are smoothed; this measures how
+	// consistently |T| follows |R| (high where the target is a filtered copy of
+	// the reference, low where uncorrelated noise dominates).
+	if (kind == WEIGHTING_COHERENCE) {
+		scratch->magnitude.resize(nfft / 2);
+		for (size_t k = band->first_bin; k <= band->last_bin; ++k)
+			scratch->magnitude[k] = sqrtf(spectral_power(tgt_spec, k));
+		spectral_prefix(scratch->magnitude.data(), band, &scratch->magnitude_prefix);
+	}
+
+	double aligned = 0.0;
+	for (size_t k = band->first_bin; k <= band->last_bin; ++k) {
+		const double re = tgt_spec[2 * k - 1];
+		const double im = tgt_spec[2 * k];
+		const double magnitude = sqrt(re * re + im * im);
+
+		double w = 0.0;
+		if (kind == WEIGHTING_PHAT) {
+			w = magnitude > 1e-30 ? 1.0 / magnitude : 0.0;
+		} else if (smoothed) {
+			const double auto_product = spectral_smoothed(ref->prefix.data(), band, k) *
+						    spectral_smoothed(scratch->prefix.data(), band, k);
+			if (auto_product > 1e-60) {
+				if (kind == WEIGHTING_SCOT) {
+					w = 1.0 / sqrt(auto_product);
+				} else {
+					const double cross_magnitude =
+						spectral_smoothed(scratch->magnitude_prefix.data(), band, k);
+					const double coherence = std::min(cross_magnitude * cross_magnitude / auto_product,
+									  WEIGHTING_MAX_COHERENCE);
+					if (cross_magnitude > 1e-30)
+						w = coherence / ((1.0 - coherence) * cross_magnitude);
+				}
+			}
+		} else {
+			w = 1.0;
+		}
+
+		tgt_spec[2 * k - 1] = (float)(re * w);
+		tgt_spec[2 * k] = (float)(im * w);
+		aligned += w * magnitude;
+	}
+
+	// Everything outside the band, including DC and Nyquist, is dropped
+	tgt_spec[0] = 0.0f;
+	for (size_t i = 1; i < 2 * band->first_bin - 1; ++i)
+		tgt_spec[i] = 0.0f;
+	for (size_t i = 2 * band->last_bin + 1; i < nfft; ++i)
+		tgt_spec[i] = 0.0f;
+
+	return 2.0 * aligned / (double)nfft;
+}
@@ -0,0 +1,571 @@
+/*
+Audio Sync Analyzer - Correlation engine
+Copyright (C) 2025
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+*/
+
+#include "sync-engine.h"
+
+#include <math.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdarg>
+
+#include "lag-search.h"
+#include "task-pool.h"
+
+void design_bandpass_filter(float low_freq, float high_freq, uint32_t sample_rate,
+			    struct bandpass_coeffs *coeffs)
+{
+	// Design a second-order bandpass filter using biquad structure
+	// This implements a bandpass filter with center frequency and Q
+
+	const float center_freq = sqrtf(low_freq * high_freq);
+	const float bandwidth = high_freq - low_freq;
+	const float Q = center_freq / bandwidth;
+
+	const float w0 = 2.0f * (float)M_PI * center_freq / (float)sample_rate;
+	const float cos_w0 = cosf(w0);
+	const float sin_w0 = sinf(w0);
+	const float alpha = sin_w0 / (2.0f * Q);
+
+	const float b0_val = alpha;
+	const float b1_val = 0.0f;
+	const float b2_val = -alpha;
+	const float a0_val = 1.0f + alpha;
+	const float a1_val = -2.0f * cos_w0;
+	const float a2_val = 1.0f - alpha;
+
+	// Normalize coefficients
+	coeffs->b0 = b0_val / a0_val;
+	coeffs->b1 = b1_val / a0_val;
+	coeffs->b2 = b2_val / a0_val;
+	coeffs->a1 = a1_val / a0_val;
+	coeffs->a2 = a2_val / a0_val;
+}
+
+void apply_bandpass_filter(const float *src, float *dst, size_t samples, const struct bandpass_coeffs *coeffs,
+			   struct bandpass_state *state)
+{
+	if (samples == 0)
+		return;
+
+	float x_prev1 = state->x1;
+	float x_prev2 = state->x2;
+	float y_prev1 = state->y1;
+	float y_prev2 = state->y2;
+
+	for (size_t i = 0; i < samples; ++i) {
+		const float x = src[i];
+
+		// Direct Form II transposed biquad filter
+		const float y = coeffs->b0 * x + coeffs->b1 * x_prev1 + coeffs->b2 * x_prev2 - coeffs->a1 * y_prev1 -
+				coeffs->a2 * y_prev2;
+
+		x_prev2 = x_prev1;
+		x_prev1 = x;
+		y_prev2 = y_prev1;
+		y_prev1 = y;
+
+		dst[i] = y;
+	}
+
+	state->x1 = x_prev1;
+	state->x2 = x_prev2;
+	state->y1 = y_prev1;
+	state->y2 = y_prev2;
+}
+
+void filter_ring_spans(const sync_ring_view *view, float *dst, const struct bandpass_coeffs *coeffs,
+		       struct bandpass_state *state)
+{
+	if (view->format == SAMPLE_FORMAT_F32) {
+		apply_bandpass_filter((const float *)view->data[0], dst, view->frames[0], coeffs, state);
+		apply_bandpass_filter((const float *)view->data[1], dst + view->frames[0], view->frames[1], coeffs,
+				      state);
+		return;
+	}
+
+	const size_t frames = view->frames[0] + view->frames[1];
+	sync_ring_view_read(view, dst);
+	apply_bandpass_filter(dst, dst, frames, coeffs, state);
+}
+
+void filter_ring_view(const sync_ring_view *view, float *dst, const struct bandpass_coeffs *coeffs,
+		      bool prefiltered)
+{
+	if (prefiltered) {
+		sync_ring_view_read(view, dst);
+		return;
+	}
+
+	// Filter state starts at zero for independent measurements
+	struct bandpass_state state = {};
+	filter_ring_spans(view, dst, coeffs, &state);
+}
+
+void prepare_workspace(struct correlation_workspace *ws, size_t frames, size_t decimation)
+{
+	const size_t coarse_frames = frames / decimation;
+	const size_t nfft = next_power_of_2(coarse_frames * 2);
+	if (ws->frames == frames && ws->decimation == decimation && ws->nfft == nfft)
+		return;
+
+	// resize() only reallocates when growing, so a shorter partial window reuses the arrays
+	ws->ref.resize(frames);
+	ws->ref_prefix.resize(frames + 1);
+	ws->ref_coarse.resize(coarse_frames);
+	ws->ref_coarse_prefix.resize(coarse_frames + 1);
+	if (ws->nfft != nfft) {
+		ws->plan.reset(new pocketfft::detail::pocketfft_r<float>(nfft));
+		ws->ref_spec.assign(nfft, 0.0f);
+		ws->scratch.assign(nfft, 0.0f);
+	}
+	ws->frames = frames;
+	ws->decimation = decimation;
+	ws->coarse_frames = coarse_frames;
+	ws->nfft = nfft;
+}
+
+void prepare_taper(struct correlation_workspace *ws, enum taper_kind kind)
+{
+	if (ws->taper_frames == ws->frames && ws->taper_kind == kind)
+		return;
+
+	ws->taper_efficiency = taper_build(kind, ws->frames, &ws->taper);
+	ws->taper_frames = ws->frames;
+	ws->taper_kind = kind;
+}
+
+void prepare_target_workspace(struct target_workspace *tw, const struct correlation_workspace *ws)
+{
+	const size_t nfft = ws->nfft;
+
+	tw->tgt.resize(ws->frames);
+	tw->tgt_prefix.resize(ws->frames + 1);
+	tw->tgt_coarse.resize(ws->coarse_frames);
+	tw->tgt_coarse_prefix.resize(ws->coarse_frames + 1);
+	if (tw->corr.size() != nfft) {
+		tw->corr.assign(nfft, 0.0f);
+		tw->scratch.assign(nfft, 0.0f);
+	}
+}
+
+void cross_spectrum_halfcomplex(const float *ref_spec, float *tgt_spec, size_t nfft)
+{
+	tgt_spec[0] *= ref_spec[0];
+	for (size_t i = 1; i + 1 < nfft; i += 2) {
+		const float rr = ref_spec[i];
+		const float ri = ref_spec[i + 1];
+		const float tr = tgt_spec[i];
+		const float ti = tgt_spec[i + 1];
+		tgt_spec[i] = rr * tr + ri * ti;
+		tgt_spec[i + 1] = rr * ti - ri * tr;
+	}
+	tgt_spec[nfft - 1] *= ref_spec[nfft - 1];
+}
+
+void condition_window(float *data, double *prefix, size_t frames, const float *taper, bool remove_mean)
+{
+	taper_apply(data, taper, frames);
+
+	if (!remove_mean) {
+		prefix[0] = 0.0;
+		for (size_t i = 0; i < frames; ++i)
+			prefix[i + 1] = prefix[i] + (double)data[i] * (double)data[i];
+		return;
+	}
+
+	double sum = 0.0;
+	for (size_t i = 0; i < frames; ++i)
+		sum += data[i];
+	const float mean = (float)(sum / (double)frames);
+
+	prefix[0] = 0.0;
+	for (size_t i = 0; i < frames; ++i) {
+		data[i] -= mean;
+		prefix[i + 1] = prefix[i] + (double)data[i] * (double)data[i];
+	}
+}
+
+void decimate_window(const float *src, size_t frames, size_t factor, float *dst, double *prefix)
+{
+	const size_t out_frames = frames / factor;
+	const float scale = 1.0f / (float)factor;
+
+	prefix[0] = 0.0;
+	for (size_t i = 0; i < out_frames; ++i) {
+		const float *block = src + i * factor;
+		float sum = 0.0f;
+		for (size_t k = 0; k < factor; ++k)
+			sum += block[k];
+		dst[i] = sum * scale;
+		prefix[i + 1] = prefix[i] + (double)dst[i] * (double)dst[i];
+	}
+}
+
+size_t coarse_decimation(uint32_t sample_rate, bool coarse_search)
+{
+	if (!coarse_search)
+		return 1;
+	return std::max<size_t>(1, sample_rate / COARSE_RATE_Hz);
+}
+
+double effective_samples(double frames, uint32_t sample_rate)
+{
+	const double enbw = 0.5 * M_PI * (double)(BANDPASS_HIGH_Hz - BANDPASS_LOW_Hz);
+	return frames * std::min(1.0, 2.0 * enbw / (double)sample_rate);
+}
+
+// Normalized correlations one lag either side of a full-rate peak
+static bool peak_neighbours(const struct correlation_workspace *ws, const struct target_workspace *tw, int lag,
+			    double *before, double *after)
+{
+	double values[2];
+	for (int i = 0; i < 2; ++i) {
+		const int l = i ? lag + 1 : lag - 1;
+		const size_t abs_l = (size_t)std::abs(l);
+		if (abs_l + LAG_SEARCH_MIN_OVERLAP > ws->frames)
+			return false;
+
+		// The coarse and weighted paths leave no full-rate plain correlation behind, so
+		// those neighbours are summed directly
+		const bool plain = ws->decimation == 1 && ws->weighting == WEIGHTING_NONE;
+		const float corr = plain ? tw->corr[l >= 0 ? abs_l : ws->nfft - abs_l]
+					 : lag_search_correlate(ws->ref.data(), tw->tgt.data(), ws->frames, l);
+		if (!lag_search_value(ws->ref_prefix.data(), tw->tgt_prefix.data(), ws->frames, l, corr,
+				      LAG_SEARCH_MIN_OVERLAP, &values[i]))
+			return false;
+	}
+
+	*before = values[0];
+	*after = values[1];
+	return true;
+}
+
+// Correlation the search left in target_workspace::corr, in the units the
+// threshold is compared against: normalized plain or decimated values, or the
+// whitened score
+struct curve_source {
+	const struct correlation_workspace *ws;
+	const float *corr;
+	const double *ref_prefix;
+	const double *tgt_prefix;
+	size_t frames;
+	size_t min_overlap;
+	double aligned;
+};
+
+static bool curve_value(const void *param, int lag, double *value)
+{
+	const struct curve_source *src = static_cast<const struct curve_source *>(param);
+	const size_t abs_l = (size_t)std::abs(lag);
+	const float corr = src->corr[lag >= 0 ? abs_l : src->ws->nfft - abs_l];
+	if (src->ws->weighting == WEIGHTING_NONE)
+		return lag_search_value(src->ref_prefix, src->tgt_prefix, src->frames, lag, corr, src->min_overlap,
+					value);
+
+	if (abs_l + src->min_overlap > src->frames || src->aligned <= 0.0)
+		return false;
+	*value = corr / src->aligned;
+	return true;
+}
+
+// Reduces the correlation around the peak to the curve the dock plots.  The
+// decimated searches leave a decimated correlation, which is plotted as it is.
+static void store_curve(const struct sync_engine *engine, const struct correlation_workspace *ws,
+			const struct target_workspace *tw, int best_lag, int max_lag, double aligned,
+			struct sync_curve *curve)
+{
+	const int decimation = (int)ws->decimation;
+	struct curve_source src;
+	src.ws = ws;
+	src.corr = tw->corr.data();
+	src.ref_prefix = decimation > 1 ? ws->ref_coarse_prefix.data() : ws->ref_prefix.data();
+	src.tgt_prefix = decimation > 1 ? tw->tgt_coarse_prefix.data() : tw->tgt_prefix.data();
+	src.frames = decimation > 1 ? ws->coarse_frames : ws->frames;
+	src.min_overlap = LAG_SEARCH_MIN_OVERLAP / ws->decimation;
+	src.aligned = aligned;
+	const double lag_ms = 1000.0 * (double)decimation / (double)engine->sample_rate;
+
+	int first;
+	int last;
+	sync_curve_range((int)std::lround((double)best_lag / decimation), max_lag / decimation, lag_ms, &first, &last);
+	sync_curve_build(curve, first, last, lag_ms, curve_value, &src);
+	curve->peak_ms = (double)best_lag * 1000.0 / (double)engine->sample_rate;
+}
+
+static void engine_log(const struct sync_engine *engine, const char *format, ...)
+{
+	if (!engine->log)
+		return;
+
+	va_list args;
+	va_start(args, format);
+	engine->log(SYNC_ENGINE_LOG_INFO, format, args);
+	va_end(args);
+}
+
+void correlate_window(const struct sync_engine *engine, const struct sync_engine_settings *settings,
+		      const struct correlation_workspace *ws, struct target_workspace *tw, int max_lag,
+		      bool prefiltered, const char *name, struct measurement_sample *out)
+{
+	const size_t frames = ws->frames;
+	const size_t nfft = ws->nfft;
+	const size_t decimation = ws->decimation;
+	float *tgt = tw->tgt.data();
+	float *corr_time = tw->corr.data();
+	struct sync_stats *stats = engine->stats;
+	uint64_t stage_ns = sync_stats_start(stats);
+
+	condition_window(tgt, tw->tgt_prefix.data(), frames, ws->taper.data(), !prefiltered);
+
+	// Stage 1: FFT correlation over the whole lag range, decimated unless the search is full-rate
+	const float *fft_in = tgt;
+	size_t fft_frames = frames;
+	if (decimation > 1) {
+		decimate_window(tgt, frames, decimation, tw->tgt_coarse.data(), tw->tgt_coarse_prefix.data());
+		fft_in = tw->tgt_coarse.data();
+		fft_frames = ws->coarse_frames;
+	}
+	stage_ns = sync_stats_since(stats, SYNC_STAT_CONDITION, stage_ns);
+
+	std::copy(fft_in, fft_in + fft_frames, corr_time);
+	std::fill(corr_time + fft_frames, corr_time + nfft, 0.0f);
+	ws->plan->exec(corr_time, tw->scratch.data(), 1.0f, true);
+	double aligned = 0.0;
+	if (ws->weighting == WEIGHTING_NONE) {
+		cross_spectrum_halfcomplex(ws->ref_spec.data(), corr_time, nfft);
+	} else {
+		aligned = spectral_weighting_apply(ws->weighting, ws->ref_spec.data(), &ws->spectral, corr_time, nfft,
+						   &ws->band, &tw->spectral);
+	}
+	ws->plan->exec(corr_time, tw->scratch.data(), 1.0f / (float)nfft, false);
+	sync_stats_fft(stats, nfft, 2);
+	stage_ns = sync_stats_since(stats, SYNC_STAT_FFT, stage_ns);
+
+	struct lag_search_result peak;
+	// Correlation compared against the threshold; the whitened score when weighting
+	double score = 0.0;
+	if (ws->weighting != WEIGHTING_NONE) {
+		// Whitened values are not energy-normalized, so the FFT stage only locates the
+		// peak and a full-rate time-domain pass rescoring a few lags around it gives
+		// the normalized correlation used for interpolation and the interval
+		const int fft_max_lag = (max_lag + (int)decimation - 1) / (int)decimation;
+		const struct lag_search_result located = lag_search_peak(corr_time, fft_frames, nfft, fft_max_lag,
+									  LAG_SEARCH_MIN_OVERLAP / decimation);
+		const int center = located.best_lag * (int)decimation;
+		const int radius = (int)decimation + 1;
+
+		peak = lag_search_refine(ws->ref.data(), tgt, ws->ref_prefix.data(), tw->tgt_prefix.data(), frames,
+					 std::max(center - radius, -max_lag), std::min(center + radius, max_lag),
+					 LAG_SEARCH_MIN_OVERLAP);
+		score = located.valid_count && aligned > 0.0 ? located.best_corr / aligned : 0.0;
+
+		if (settings->debug) {
+			engine_log(engine, "[ADM DEBUG] WEIGHTED '%s': %s score=%.4f located_lag=%d bins=%zu-%zu",
+				   name, spectral_weighting_name(ws->weighting), score, center, ws->band.first_bin,
+				   ws->band.last_bin);
+		}
+	} else if (decimation == 1) {
+		peak = lag_search(ws->ref_prefix.data(), tw->tgt_prefix.data(), corr_time, frames, nfft, max_lag,
+				  LAG_SEARCH_MIN_OVERLAP);
+	} else {
+		// Stage 2: full-rate time-domain correlation within one coarse sample of the coarse peak
+		const int coarse_max_lag = (max_lag + (int)decimation - 1) / (int)decimation;
+		const struct lag_search_result coarse =
+			lag_search(ws->ref_coarse_prefix.data(), tw->tgt_coarse_prefix.data(), corr_time,
+				   ws->coarse_frames, nfft, coarse_max_lag, LAG_SEARCH_MIN_OVERLAP / decimation);
+		const int center = coarse.best_lag * (int)decimation;
+		const int radius = (int)decimation + 1;
+
+		peak = coarse;
+		if (coarse.valid_count) {
+			peak = lag_search_refine(ws->ref.data(), tgt, ws->ref_prefix.data(), tw->tgt_prefix.data(),
+						 frames, std::max(center - radius, -max_lag),
+						 std::min(center + radius, max_lag), LAG_SEARCH_MIN_OVERLAP);
+		}
+
+		if (settings->debug) {
+			engine_log(engine, "[ADM DEBUG] COARSE '%s': decimation=%zu coarse_corr=%.4f coarse_lag=%d",
+				   name, decimation, coarse.best_corr, coarse.best_lag);
+		}
+	}
+	const double best_corr = peak.best_corr;
+	const int best_lag = peak.best_lag;
+	if (ws->weighting == WEIGHTING_NONE)
+		score = best_corr;
+	stage_ns = sync_stats_since(stats, SYNC_STAT_SEARCH, stage_ns);
+
+	if (settings->debug) {
+		engine_log(engine, "[ADM DEBUG] FINAL '%s': best_corr=%.4f best_lag=%d lag_count=%zu",
+			   name, best_corr, best_lag, peak.valid_count);
+	}
+	if (out->curve && peak.valid_count)
+		store_curve(engine, ws, tw, best_lag, max_lag, aligned, out->curve);
+
+	if (score < settings->corr_threshold || peak.valid_count == 0) {
+		engine_log(engine, "[ADM]  CORRELATION TOO LOW: %.4f < %.2f", score, settings->corr_threshold);
+		out->correlation = score;
+		out->status = "Insufficient correlation";
+		return;
+	}
+
+	// Sub-sample delay from a parabola through the peak and its neighbours
+	double offset = 0.0;
+	double interval = 0.5;
+	double before = 0.0;
+	double after = 0.0;
+	double curvature = 0.0;
+	if (peak_neighbours(ws, tw, best_lag, &before, &after) &&
+	    lag_search_parabolic(before, best_corr, after, &offset, &curvature)) {
+		// Both windows are tapered, which discounts the overlap by the taper's efficiency
+		const double overlap = ws->taper_efficiency * (double)(frames - (size_t)std::abs(best_lag));
+		interval = lag_search_interval(best_corr, curvature, effective_samples(overlap, engine->sample_rate));
+	}
+	sync_stats_since(stats, SYNC_STAT_PEAK, stage_ns);
+
+	if (settings->debug) {
+		engine_log(engine, "[ADM DEBUG] PEAK '%s': offset=%+.3f curvature=%.5f interval=%.3f samples",
+			   name, offset, curvature, interval);
+	}
+
+	out->delay_ms = (((double)best_lag + offset) * 1000.0) / (double)engine->sample_rate;
+	out->interval_ms = (interval * 1000.0) / (double)engine->sample_rate;
+	out->correlation = score;
+	out->success = true;
+	out->status.clear();
+}
+
+void prepare_reference(const struct sync_engine *engine, struct correlation_workspace *ws, bool prefiltered,
+		       enum spectral_weighting weighting)
+{
+	const uint64_t start_ns = sync_stats_start(engine->stats);
+	const size_t frames = ws->frames;
+	condition_window(ws->ref.data(), ws->ref_prefix.data(), frames, ws->taper.data(), !prefiltered);
+
+	const float *fft_in = ws->ref.data();
+	size_t fft_frames = frames;
+	if (ws->decimation > 1) {
+		decimate_window(ws->ref.data(), frames, ws->decimation, ws->ref_coarse.data(),
+				ws->ref_coarse_prefix.data());
+		fft_in = ws->ref_coarse.data();
+		fft_frames = ws->coarse_frames;
+	}
+
+	float *ref_spec = ws->ref_spec.data();
+	std::copy(fft_in, fft_in + fft_frames, ref_spec);
+	std::fill(ref_spec + fft_frames, ref_spec + ws->nfft, 0.0f);
+	ws->plan->exec(ref_spec, ws->scratch.data(), 1.0f, true);
+
+	ws->weighting = weighting;
+	if (weighting != WEIGHTING_NONE) {
+		const double fft_rate = (double)engine->sample_rate / (double)ws->decimation;
+		ws->band = spectral_band_for(ws->nfft, fft_rate, BANDPASS_LOW_Hz, BANDPASS_HIGH_Hz);
+		spectral_reference_prepare(ref_spec, ws->nfft, &ws->band, weighting, &ws->spectral);
+	}
+	sync_stats_fft(engine->stats, ws->nfft, 1);
+	sync_stats_since(engine->stats, SYNC_STAT_REFERENCE, start_ns);
+}
+
+void sync_engine_init(struct sync_engine *engine, uint32_t sample_rate, struct task_pool *pool, sync_engine_log_fn log)
+{
+	engine->pool = pool;
+	engine->log = log;
+	sync_engine_set_sample_rate(engine, sample_rate);
+}
+
+void sync_engine_set_sample_rate(struct sync_engine *engine, uint32_t sample_rate)
+{
+	engine->sample_rate = sample_rate;
+	design_bandpass_filter(BANDPASS_LOW_Hz, BANDPASS_HIGH_Hz, sample_rate, &engine->bp_coeffs);
+}
+
+int sync_engine_max_lag(const struct sync_engine *engine, uint32_t max_lag_ms, size_t frames)
+{
+	const int max_lag = (int)ms_to_samples(max_lag_ms, engine->sample_rate);
+	return std::min(max_lag, (int)frames - 1);
+}
+
+// One target of sync_engine_measure()
+struct engine_job {
+	const struct sync_engine *engine;
+	const struct sync_engine_settings *settings;
+	const struct correlation_workspace *ws;
+	struct target_workspace *tw;
+	const float *samples;
+	int max_lag;
+	struct measurement_sample *out;
+};
+
+static void engine_job_run(void *param)
+{
+	struct engine_job *job = static_cast<struct engine_job *>(param);
+	const uint64_t start_ns = sync_stats_start(job->engine->stats);
+	prepare_target_workspace(job->tw, job->ws);
+
+	// Filter state starts at zero for independent measurements
+	struct bandpass_state state = {};
+	apply_bandpass_filter(job->samples, job->tw->tgt.data(), job->ws->frames, &job->engine->bp_coeffs, &state);
+	sync_stats_since(job->engine->stats, SYNC_STAT_COPY, start_ns);
+	correlate_window(job->engine, job->settings, job->ws, job->tw, job->max_lag, false, "target", job->out);
+}
+
+bool sync_engine_measure(const struct sync_engine *engine, const struct sync_engine_settings *settings,
+			 struct correlation_workspace *ws, struct target_workspace *tws, const float *ref,
+			 const float *const *targets, size_t count, size_t frames, struct measurement_sample *outs)
+{
+	const uint64_t start_ns = sync_stats_start(engine->stats);
+	count = std::min<size_t>(count, MAX_TARGETS);
+	for (size_t i = 0; i < count; ++i) {
+		// Only the caller's curve storage survives from the previous result
+		struct sync_curve *curve = outs[i].curve;
+		outs[i] = measurement_sample();
+		outs[i].curve = curve;
+	}
+	if (count == 0)
+		return false;
+
+	frames = std::min(frames, ms_to_samples(settings->window_ms, engine->sample_rate));
+	if (frames < 1024) {
+		for (size_t i = 0; i < count; ++i)
+			outs[i].status = "Buffers too small";
+		return false;
+	}
+
+	prepare_workspace(ws, frames, coarse_decimation(engine->sample_rate, settings->coarse_search));
+	prepare_taper(ws, settings->taper);
+
+	const uint64_t copy_ns = sync_stats_start(engine->stats);
+	struct bandpass_state state = {};
+	apply_bandpass_filter(ref, ws->ref.data(), frames, &engine->bp_coeffs, &state);
+	sync_stats_since(engine->stats, SYNC_STAT_COPY, copy_ns);
+	prepare_reference(engine, ws, false, settings->weighting);
+
+	const int max_lag = sync_engine_max_lag(engine, settings->max_lag_ms, frames);
+	struct engine_job jobs[MAX_TARGETS];
+	void *params[MAX_TARGETS];
+	for (size_t i = 0; i < count; ++i) {
+		jobs[i] = {engine, settings, ws, &tws[i], targets[i], max_lag, &outs[i]};
+		params[i] = &jobs[i];
+	}
+
+	if (engine->pool) {
+		task_pool_parallel(engine->pool, &ws->tasks, engine_job_run, params, count);
+	} else {
+		for (size_t i = 0; i < count; ++i)
+			engine_job_run(params[i]);
+	}
+	sync_stats_since(engine->stats, SYNC_STAT_MEASURE, start_ns);
+
+	for (size_t i = 0; i < count; ++i) {
+		if (outs[i].success)
+			return true;
+	}
+	return false;
+}
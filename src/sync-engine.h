@@ -0,0 +1,222 @@
+/*
+Audio Sync Analyzer - Correlation engine
+Copyright (C) 2025
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+*/
+
+#pragma once
+
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "pocketfft_hdronly.h"
+#include "spectral-weighting.h"
+#include "sync-plot.h"
+#include "sync-ring.h"
+#include "sync-stats.h"
+#include "taper.h"
+#include "task-pool.h"
+
+// The DSP behind a measurement: bandpass, window conditioning, the FFT
+// cross-correlation with its coarse-to-fine and weighted searches, and the
+// sub-sample peak.  Nothing here depends on OBS, so the benchmarks and offline
+// tools run exactly the code the plugin does.
+
+#define MAX_TARGETS 16u
+#define BANDPASS_LOW_Hz 200.0f
+#define BANDPASS_HIGH_Hz 2000.0f
+#define COARSE_RATE_Hz 8000u
+
+// Same value as libobs' LOG_INFO, so blogva() can be the log sink
+#define SYNC_ENGINE_LOG_INFO 300
+
+typedef void (*sync_engine_log_fn)(int level, const char *format, va_list args);
+
+struct bandpass_coeffs {
+	float b0, b1, b2, a1, a2;
+};
+
+struct bandpass_state {
+	float x1, x2, y1, y2;
+};
+
+struct sync_engine {
+	uint32_t sample_rate = 0;
+	// Shared by per-measurement and streaming filtering
+	struct bandpass_coeffs bp_coeffs = {};
+	// Targets of a measurement are correlated in parallel here when set
+	struct task_pool *pool = nullptr;
+	// Diagnostics sink with blogva()'s signature; null drops them
+	sync_engine_log_fn log = nullptr;
+	// Stage timings and FFT sizes are recorded here when set
+	struct sync_stats *stats = nullptr;
+};
+
+// Settings a measurement reads once
+struct sync_engine_settings {
+	uint32_t window_ms;
+	uint32_t max_lag_ms;
+	float corr_threshold;
+	bool coarse_search;
+	enum taper_kind taper;
+	enum spectral_weighting weighting;
+	// Log every search stage through sync_engine::log
+	bool debug;
+};
+
+// Reference side of a measurement plus the FFT plan shared by every target.
+// Keyed on (frames, decimation); only rebuilt when window_ms, the sample rate or
+// the search mode changes.  With decimation > 1 the FFT runs on the decimated
+// (coarse) windows and the full-rate windows are kept for the refinement.
+struct correlation_workspace {
+	size_t frames = 0;
+	size_t decimation = 1;
+	size_t coarse_frames = 0;
+	size_t nfft = 0;
+	std::unique_ptr<pocketfft::detail::pocketfft_r<float>> plan;
+
+	std::vector<float> ref;
+	std::vector<double> ref_prefix;
+	std::vector<float> ref_coarse;
+	std::vector<double> ref_coarse_prefix;
+	// Halfcomplex reference spectrum, computed once and reused for every target
+	std::vector<float> ref_spec;
+	std::vector<float> scratch;
+
+	// Analysis taper for `taper_frames` samples, rebuilt only when the length or kind changes
+	std::vector<float> taper;
+	size_t taper_frames = 0;
+	enum taper_kind taper_kind = TAPER_HANN;
+	// Fraction of an overlap that counts as independent samples under this taper
+	double taper_efficiency = 0.5;
+
+	// Cross-spectrum weighting for the current measurement and the reference's share of it
+	enum spectral_weighting weighting = WEIGHTING_NONE;
+	struct spectral_band band = {};
+	struct spectral_reference spectral;
+
+	// Pool tasks for the targets correlated against this reference
+	struct task_batch tasks;
+};
+
+// Per-target scratch so targets can be correlated in parallel against one reference
+struct target_workspace {
+	std::vector<float> tgt;
+	std::vector<double> tgt_prefix;
+	std::vector<float> tgt_coarse;
+	std::vector<double> tgt_coarse_prefix;
+	// Holds the target spectrum, then the correlation
+	std::vector<float> corr;
+	std::vector<float> scratch;
+	struct spectral_scratch spectral;
+};
+
+struct measurement_sample {
+	double delay_ms = 0.0;
+	// Half-width of the ~95% confidence interval around delay_ms
+	double interval_ms = 0.0;
+	double correlation = 0.0;
+	bool success = false;
+	std::string status;
+	// When set, correlate_window() also stores the correlation around the peak here
+	struct sync_curve *curve = nullptr;
+};
+
+static inline size_t next_power_of_2(size_t n)
+{
+	size_t p = 1;
+	while (p < n)
+		p <<= 1;
+	return p;
+}
+
+static inline size_t ms_to_samples(uint32_t ms, uint32_t sample_rate)
+{
+	return (size_t)(((uint64_t)ms * sample_rate + 500) / 1000);
+}
+
+// Sets the rate and designs the bandpass for it
+void sync_engine_init(struct sync_engine *engine, uint32_t sample_rate, struct task_pool *pool, sync_engine_log_fn log);
+
+// Redesigns the bandpass for a new rate.  Workspaces need nothing: they are
+// keyed on window size and decimation and resize on their next prepare_workspace().
+void sync_engine_set_sample_rate(struct sync_engine *engine, uint32_t sample_rate);
+
+void design_bandpass_filter(float low_freq, float high_freq, uint32_t sample_rate,
+			    struct bandpass_coeffs *coeffs);
+
+// Filters src into dst (which may alias src), carrying the biquad state across calls
+void apply_bandpass_filter(const float *src, float *dst, size_t samples, const struct bandpass_coeffs *coeffs,
+			   struct bandpass_state *state);
+
+// Bandpasses both spans of a view into dst, continuing `state`.  Float rings are
+// filtered straight from the ring; narrower formats are expanded into dst first
+// and filtered in place.
+void filter_ring_spans(const sync_ring_view *view, float *dst, const struct bandpass_coeffs *coeffs,
+		       struct bandpass_state *state);
+
+// Filters a ring view straight into dst so a non-wrapping window is never copied separately.
+// Rings the capture callback already bandpassed are only copied.
+void filter_ring_view(const sync_ring_view *view, float *dst, const struct bandpass_coeffs *coeffs,
+		      bool prefiltered);
+
+void prepare_workspace(struct correlation_workspace *ws, size_t frames, size_t decimation);
+
+void prepare_taper(struct correlation_workspace *ws, enum taper_kind kind);
+
+void prepare_target_workspace(struct target_workspace *tw, const struct correlation_workspace *ws);
+
+// In-place on halfcomplex spectra (r0, r1, i1, ..., r(n/2)): tgt_spec becomes
+// conj(ref) * tgt, whose backward transform is corr[lag] = sum ref[n] * tgt[n + lag]
+void cross_spectrum_halfcomplex(const float *ref_spec, float *tgt_spec, size_t nfft);
+
+// Tapers a filtered window, removes its mean and fills the energy prefix sums.
+// Windows filtered per measurement carry the biquad's startup transient, so their
+// mean is removed; streamed windows skip that pass since the bandpass already has
+// a zero at DC and no transient.
+void condition_window(float *data, double *prefix, size_t frames, const float *taper, bool remove_mean);
+
+// Box-filters a conditioned window down by `factor` and fills the coarse prefix sums.
+// The input is already bandpassed below 2 kHz, so the box filter's nulls at
+// multiples of the coarse rate are enough to keep aliasing out of an 8 kHz pass.
+void decimate_window(const float *src, size_t frames, size_t factor, float *dst, double *prefix);
+
+// Full-rate samples per coarse sample; 1 disables the coarse-to-fine search
+size_t coarse_decimation(uint32_t sample_rate, bool coarse_search);
+
+// Independent samples in `frames` of bandpassed audio, for the confidence interval.
+// Noise through the bandpass decorrelates after about sample_rate / (2 * ENBW)
+// samples; a second-order section's ENBW is pi/2 times its -3 dB bandwidth.
+double effective_samples(double frames, uint32_t sample_rate);
+
+// Conditions the filtered reference window in ws->ref and computes the spectrum
+// every target is correlated against, plus the weighting's reference share
+void prepare_reference(const struct sync_engine *engine, struct correlation_workspace *ws, bool prefiltered,
+		       enum spectral_weighting weighting);
+
+// Correlates the filtered target window in tw->tgt (sized by
+// prepare_target_workspace) against the reference prepared in ws.  Windows the
+// capture callback already bandpassed are `prefiltered` and keep their mean.
+void correlate_window(const struct sync_engine *engine, const struct sync_engine_settings *settings,
+		      const struct correlation_workspace *ws, struct target_workspace *tw, int max_lag,
+		      bool prefiltered, const char *name, struct measurement_sample *out);
+
+// Largest lag searched in a window of `frames` samples
+int sync_engine_max_lag(const struct sync_engine *engine, uint32_t max_lag_ms, size_t frames);
+
+// One measurement on windows already in memory: ref and targets[i] each hold
+// `frames` unfiltered samples ending at the same moment, and outs[i] receives
+// target i's result, plus the curve around its peak when outs[i].curve is set.
+// At most MAX_TARGETS targets.  ws and tws[i] are reused across calls, so
+// repeated measurements of one size do not allocate, the pool's tasks included.
+bool sync_engine_measure(const struct sync_engine *engine, const struct sync_engine_settings *settings,
+			 struct correlation_workspace *ws, struct target_workspace *tws, const float *ref,
+			 const float *const *targets, size_t count, size_t frames, struct measurement_sample *outs);
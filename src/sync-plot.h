@@ -0,0 +1,162 @@
+/*
+Audio Sync Analyzer - Plot data for the dock
+Copyright (C) 2025
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+// What the dock plots, in fixed-size buffers so a show running for hours never
+// grows them.  The correlation curve is reduced to display resolution by the
+// worker that computed it and the history is binned as results arrive; the UI
+// thread only copies and draws.
+
+// Points in a correlation curve, about the plot's width in pixels
+#define SYNC_CURVE_POINTS 256u
+// The curve covers this far either side of the peak, clamped to the search range
+#define SYNC_CURVE_SPAN_MS 100.0
+// One history point per slot, as a ring: the last 30 minutes
+#define SYNC_HISTORY_SLOT_S 1.0
+#define SYNC_HISTORY_POINTS 1800u
+
+// Normalized correlation against lag.  Point i covers lags from
+// first_ms + i * step to first_ms + (i + 1) * step, step = (last_ms - first_ms) / count.
+struct sync_curve {
+	float values[SYNC_CURVE_POINTS];
+	size_t count = 0;
+	double first_ms = 0.0;
+	double last_ms = 0.0;
+	// Lag the search settled on
+	double peak_ms = 0.0;
+};
+
+// Normalized correlation at one lag; false when the lag has no usable overlap
+typedef bool (*sync_curve_value_fn)(const void *param, int lag, double *value);
+
+// Fills `curve` with value(param, lag) over lags [first, last], each lag_ms long.
+// A point takes the largest value among its lags, so the peak's height survives
+// the reduction; a point with no valid lag reads 0.
+static inline void sync_curve_build(struct sync_curve *curve, int first, int last, double lag_ms,
+				    sync_curve_value_fn value, const void *param)
+{
+	curve->count = 0;
+	if (last < first)
+		return;
+
+	const size_t lags = (size_t)(last - first + 1);
+	const size_t points = std::min<size_t>(lags, SYNC_CURVE_POINTS);
+	for (size_t i = 0; i < points; ++i) {
+		const int lo = first + (int)(i * lags / points);
+		const int hi = first + (int)((i + 1) * lags / points);
+		double best = -HUGE_VAL;
+		for (int lag = lo; lag < hi; ++lag) {
+			double v;
+			if (value(param, lag, &v))
+				best = std::max(best, v);
+		}
+		curve->values[i] = best > -HUGE_VAL ? (float)best : 0.0f;
+	}
+	curve->count = points;
+	curve->first_ms = (double)first * lag_ms;
+	curve->last_ms = (double)(last + 1) * lag_ms;
+}
+
+// Lags [*first, *last] the curve covers: SYNC_CURVE_SPAN_MS either side of
+// `center`, within +-max_lag.  All three are in lags of lag_ms.
+static inline void sync_curve_range(int center, int max_lag, double lag_ms, int *first, int *last)
+{
+	const int half = std::max(1, (int)(SYNC_CURVE_SPAN_MS / lag_ms));
+	*first = std::max(center - half, -max_lag);
+	*last = std::min(center + half, max_lag);
+}
+
+struct sync_history_point {
+	double time_s;
+	// Mean of the slot's successful results; NAN when it had none
+	float delay_ms;
+	// Mean over every result, successful or not
+	float correlation;
+};
+
+struct sync_history {
+	// Closed slots as a ring; the oldest is at (head + SYNC_HISTORY_POINTS - count) % SYNC_HISTORY_POINTS
+	struct sync_history_point points[SYNC_HISTORY_POINTS];
+	size_t head = 0;
+	size_t count = 0;
+
+	// Slot being filled
+	double slot_start_s = 0.0;
+	double sum_delay = 0.0;
+	double sum_corr = 0.0;
+	size_t delays = 0;
+	size_t results = 0;
+};
+
+static inline void sync_history_reset(struct sync_history *h)
+{
+	h->head = 0;
+	h->count = 0;
+	h->sum_delay = 0.0;
+	h->sum_corr = 0.0;
+	h->delays = 0;
+	h->results = 0;
+}
+
+static inline struct sync_history_point sync_history_open_point(const struct sync_history *h)
+{
+	const float delay = h->delays ? (float)(h->sum_delay / (double)h->delays) : NAN;
+	return {h->slot_start_s, delay, (float)(h->sum_corr / (double)h->results)};
+}
+
+static inline void sync_history_close(struct sync_history *h)
+{
+	if (!h->results)
+		return;
+
+	h->points[h->head] = sync_history_open_point(h);
+	h->head = (h->head + 1) % SYNC_HISTORY_POINTS;
+	if (h->count < SYNC_HISTORY_POINTS)
+		h->count++;
+	h->sum_delay = 0.0;
+	h->sum_corr = 0.0;
+	h->delays = 0;
+	h->results = 0;
+}
+
+// Adds one result taken at time_s (any monotonic clock, in seconds)
+static inline void sync_history_add(struct sync_history *h, double time_s, bool success, double delay_ms,
+				    double correlation)
+{
+	if (h->results && time_s - h->slot_start_s >= SYNC_HISTORY_SLOT_S)
+		sync_history_close(h);
+	if (!h->results)
+		h->slot_start_s = time_s;
+
+	h->sum_corr += correlation;
+	h->results++;
+	if (success) {
+		h->sum_delay += delay_ms;
+		h->delays++;
+	}
+}
+
+// Copies the history oldest first, including the slot being filled, into out
+// (room for SYNC_HISTORY_POINTS + 1).  Returns the number of points.
+static inline size_t sync_history_copy(const struct sync_history *h, struct sync_history_point *out)
+{
+	size_t n = 0;
+	for (size_t i = 0; i < h->count; ++i)
+		out[n++] = h->points[(h->head + SYNC_HISTORY_POINTS - h->count + i) % SYNC_HISTORY_POINTS];
+	if (h->results)
+		out[n++] = sync_history_open_point(h);
+	return n;
+}
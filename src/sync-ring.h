@@ -0,0 +1,300 @@
+/*
+Audio Sync Analyzer - Lock-free capture ring
+Copyright (C) 2025
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "sample-format.h"
+
+// origin_ns before the first timestamped write
+#define SYNC_RING_NO_ORIGIN INT64_MIN
+
+// Single-producer/single-consumer sample ring.
+//
+// The OBS audio thread is the only writer and never blocks.  Readers copy the
+// most recent frames and then check that the producer did not lap the region
+// they copied (seqlock style), retrying if it did.  Indices are monotonic frame
+// counters; capacity is a power of two so slot = index & mask.  Samples are
+// stored as `format` and converted on write and on read.
+struct sync_ring {
+	std::vector<uint8_t> buffer;
+	size_t capacity = 0;
+	size_t mask = 0;
+	enum sample_format format = SAMPLE_FORMAT_F32;
+	size_t sample_size = sizeof(float);
+
+	// Frames the producer has started writing (bumped before the copy)
+	std::atomic<uint64_t> claim_index{0};
+	// Frames fully written and visible to readers (bumped after the copy)
+	std::atomic<uint64_t> write_index{0};
+	// Oldest frame readers may use; advanced by sync_ring_reset()
+	std::atomic<uint64_t> read_index{0};
+	// os_gettime_ns() of the last write, 0 when no audio has arrived yet
+	std::atomic<uint64_t> last_write_ns{0};
+	// Capture time of frame index 0, so frame n was captured at origin_ns + n / rate.
+	// Kept as one value so readers never see a torn (index, time) pair.
+	std::atomic<int64_t> origin_ns{SYNC_RING_NO_ORIGIN};
+};
+
+// Zero-copy view of the newest frames: data[0] followed by data[1] (empty unless
+// the window wraps), both holding samples stored as `format`.
+struct sync_ring_view {
+	const void *data[2];
+	size_t frames[2];
+	uint64_t start;
+	enum sample_format format;
+};
+
+// Rounds min_capacity up to the next power of two.  Must not race the producer or readers.
+static inline void sync_ring_init(sync_ring *ring, size_t min_capacity, enum sample_format format = SAMPLE_FORMAT_F32)
+{
+	size_t capacity = 1;
+	while (capacity < min_capacity)
+		capacity <<= 1;
+
+	ring->format = format;
+	ring->sample_size = sample_format_size(format);
+	ring->buffer.assign(capacity * ring->sample_size, 0);
+	// Releases the old storage after a switch to a narrower format
+	ring->buffer.shrink_to_fit();
+	ring->capacity = capacity;
+	ring->mask = capacity - 1;
+	ring->claim_index.store(0, std::memory_order_relaxed);
+	ring->write_index.store(0, std::memory_order_relaxed);
+	ring->read_index.store(0, std::memory_order_relaxed);
+	ring->last_write_ns.store(0, std::memory_order_relaxed);
+	ring->origin_ns.store(SYNC_RING_NO_ORIGIN, std::memory_order_relaxed);
+}
+
+// Sizes the ring for a new sample rate.  Storage is only reallocated when the
+// power-of-two capacity changes; otherwise the buffered audio is dropped the way
+// sync_ring_reset() drops it, so indices stay monotonic for anything tagged with
+// them.  The timeline is cleared either way.  Returns true when it reallocated.
+// Must not race the producer or readers.
+static inline bool sync_ring_resize(sync_ring *ring, size_t min_capacity)
+{
+	size_t capacity = 1;
+	while (capacity < min_capacity)
+		capacity <<= 1;
+	if (capacity != ring->capacity) {
+		sync_ring_init(ring, capacity, ring->format);
+		return true;
+	}
+
+	ring->read_index.store(ring->write_index.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	ring->last_write_ns.store(0, std::memory_order_relaxed);
+	ring->origin_ns.store(SYNC_RING_NO_ORIGIN, std::memory_order_relaxed);
+	return false;
+}
+
+// Producer side; only ever called from the source's audio callback.  Converts
+// the packet into at most two contiguous spans.
+static inline void sync_ring_write(sync_ring *ring, const float *src, size_t frames, uint64_t now_ns)
+{
+	uint64_t pos = ring->write_index.load(std::memory_order_relaxed);
+
+	// A packet larger than the ring only leaves its tail behind
+	if (frames > ring->capacity) {
+		pos += frames - ring->capacity;
+		src += frames - ring->capacity;
+		frames = ring->capacity;
+	}
+
+	ring->claim_index.store(pos + frames, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	uint8_t *buffer = ring->buffer.data();
+	const size_t slot = (size_t)(pos & ring->mask);
+	const size_t first = std::min(frames, ring->capacity - slot);
+	sample_encode(ring->format, src, buffer + slot * ring->sample_size, first);
+	if (first < frames)
+		sample_encode(ring->format, src + first, buffer, frames - first);
+
+	ring->write_index.store(pos + frames, std::memory_order_release);
+	ring->last_write_ns.store(now_ns, std::memory_order_relaxed);
+}
+
+// Discards everything buffered so far without touching the producer's indices.
+static inline void sync_ring_reset(sync_ring *ring)
+{
+	ring->read_index.store(ring->write_index.load(std::memory_order_acquire), std::memory_order_release);
+	ring->last_write_ns.store(0, std::memory_order_relaxed);
+}
+
+static inline size_t sync_ring_available(const sync_ring *ring)
+{
+	const uint64_t end = ring->write_index.load(std::memory_order_acquire);
+	const uint64_t begin = ring->read_index.load(std::memory_order_acquire);
+	const uint64_t count = end > begin ? end - begin : 0;
+	return count < ring->capacity ? (size_t)count : ring->capacity;
+}
+
+// Bytes of sample storage held by the ring
+static inline size_t sync_ring_bytes(const sync_ring *ring)
+{
+	return ring->capacity * ring->sample_size;
+}
+
+static inline uint64_t sync_ring_last_write_ns(const sync_ring *ring)
+{
+	return ring->last_write_ns.load(std::memory_order_relaxed);
+}
+
+// Index one past the newest committed frame
+static inline uint64_t sync_ring_end(const sync_ring *ring)
+{
+	return ring->write_index.load(std::memory_order_acquire);
+}
+
+// Index of the oldest frame still held by the ring
+static inline uint64_t sync_ring_begin(const sync_ring *ring)
+{
+	const uint64_t end = ring->write_index.load(std::memory_order_acquire);
+	const uint64_t begin = ring->read_index.load(std::memory_order_acquire);
+	const uint64_t oldest = end > ring->capacity ? end - ring->capacity : 0;
+	return begin > oldest ? begin : oldest;
+}
+
+// Makes dst hold the frames src holds, at the same indices and on the same
+// timeline, so a new producer can carry on where src's left off.  The rings
+// must share capacity and format.  dst must not race its producer or readers;
+// src may be live, and frames its producer overwrote during the copy are left out.
+static inline void sync_ring_copy(sync_ring *dst, const sync_ring *src)
+{
+	const uint64_t end = sync_ring_end(src);
+	const uint64_t read = src->read_index.load(std::memory_order_acquire);
+	const uint64_t oldest = end > src->capacity ? end - src->capacity : 0;
+	uint64_t begin = std::max(read, oldest);
+	std::copy(src->buffer.begin(), src->buffer.end(), dst->buffer.begin());
+
+	std::atomic_thread_fence(std::memory_order_acquire);
+	const uint64_t claimed = src->claim_index.load(std::memory_order_relaxed);
+	if (claimed - begin > src->capacity)
+		begin = std::min(end, claimed - src->capacity);
+
+	dst->claim_index.store(end, std::memory_order_relaxed);
+	dst->write_index.store(end, std::memory_order_relaxed);
+	dst->read_index.store(begin, std::memory_order_relaxed);
+	dst->last_write_ns.store(src->last_write_ns.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	dst->origin_ns.store(src->origin_ns.load(std::memory_order_acquire), std::memory_order_relaxed);
+}
+
+// Exposes frames [start, start + frames) in place.  The view must be checked
+// with sync_ring_view_valid() after it has been consumed.
+static inline bool sync_ring_peek_at(const sync_ring *ring, uint64_t start, size_t frames, sync_ring_view *view)
+{
+	if (frames == 0 || frames > ring->capacity)
+		return false;
+	if (start < sync_ring_begin(ring) || start + frames > sync_ring_end(ring))
+		return false;
+
+	const uint8_t *buffer = ring->buffer.data();
+	view->start = start;
+	view->format = ring->format;
+	const size_t slot = (size_t)(start & ring->mask);
+	view->data[0] = buffer + slot * ring->sample_size;
+	view->frames[0] = std::min(frames, ring->capacity - slot);
+	view->data[1] = buffer;
+	view->frames[1] = frames - view->frames[0];
+	return true;
+}
+
+// Exposes the newest `frames` samples in place
+static inline bool sync_ring_peek(const sync_ring *ring, size_t frames, sync_ring_view *view)
+{
+	const uint64_t end = sync_ring_end(ring);
+	if (frames > end)
+		return false;
+	return sync_ring_peek_at(ring, end - frames, frames, view);
+}
+
+// True if the producer has not overwritten any part of the view since sync_ring_peek().
+static inline bool sync_ring_view_valid(const sync_ring *ring, const sync_ring_view *view)
+{
+	std::atomic_thread_fence(std::memory_order_acquire);
+	const uint64_t claimed = ring->claim_index.load(std::memory_order_relaxed);
+	return claimed - view->start <= ring->capacity;
+}
+
+// Expands both spans of a view into dst as floats
+static inline void sync_ring_view_read(const sync_ring_view *view, float *dst)
+{
+	sample_decode(view->format, view->data[0], dst, view->frames[0]);
+	sample_decode(view->format, view->data[1], dst + view->frames[0], view->frames[1]);
+}
+
+static inline int64_t sync_frames_to_ns(uint64_t frames, uint32_t rate)
+{
+	// Split so frames * 1e9 cannot overflow however long the ring has run
+	return (int64_t)((frames / rate) * 1000000000ULL + (frames % rate) * 1000000000ULL / rate);
+}
+
+static inline int64_t sync_ns_to_frames(int64_t ns, uint32_t rate)
+{
+	const int64_t sign = ns < 0 ? -1 : 1;
+	const uint64_t abs_ns = (uint64_t)(ns < 0 ? -ns : ns);
+	const uint64_t whole = abs_ns / 1000000000ULL;
+	const uint64_t rest = ((abs_ns % 1000000000ULL) * rate + 500000000ULL) / 1000000000ULL;
+	return sign * (int64_t)(whole * rate + rest);
+}
+
+// Producer only.  Records that frame `index` was captured at time_ns.  Packets
+// that land within smoothing_ns of where the current origin puts them are taken
+// as continuous, the way OBS smooths audio timestamps, so per-packet jitter does
+// not move the timeline; a larger jump (a gap or a restarted device) re-anchors it.
+static inline void sync_ring_stamp(sync_ring *ring, uint64_t index, int64_t time_ns, uint32_t rate,
+				   int64_t smoothing_ns)
+{
+	const int64_t origin = time_ns - sync_frames_to_ns(index, rate);
+	const int64_t current = ring->origin_ns.load(std::memory_order_relaxed);
+	if (current == SYNC_RING_NO_ORIGIN || origin - current > smoothing_ns || current - origin > smoothing_ns)
+		ring->origin_ns.store(origin, std::memory_order_release);
+}
+
+static inline bool sync_ring_has_time(const sync_ring *ring)
+{
+	return ring->origin_ns.load(std::memory_order_acquire) != SYNC_RING_NO_ORIGIN;
+}
+
+// Capture time of frame `index`; only meaningful once sync_ring_has_time()
+static inline int64_t sync_ring_time_at(const sync_ring *ring, uint64_t index, uint32_t rate)
+{
+	return ring->origin_ns.load(std::memory_order_acquire) + sync_frames_to_ns(index, rate);
+}
+
+// Index of the frame captured nearest to time_ns, clamped at 0
+static inline uint64_t sync_ring_index_at(const sync_ring *ring, int64_t time_ns, uint32_t rate)
+{
+	const int64_t frames = sync_ns_to_frames(time_ns - ring->origin_ns.load(std::memory_order_acquire), rate);
+	return frames > 0 ? (uint64_t)frames : 0;
+}
+
+// Copies the newest `frames` samples into dst.  Returns false if not enough
+// audio is buffered or the producer kept overwriting the region being read.
+static inline bool sync_ring_snapshot(const sync_ring *ring, float *dst, size_t frames)
+{
+	for (int attempt = 0; attempt < 4; ++attempt) {
+		sync_ring_view view;
+		if (!sync_ring_peek(ring, frames, &view))
+			return false;
+
+		sync_ring_view_read(&view, dst);
+
+		if (sync_ring_view_valid(ring, &view))
+			return true;
+	}
+	return false;
+}
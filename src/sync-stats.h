@@ -0,0 +1,266 @@
+/*
+Audio Sync Analyzer - Hot-path timing statistics
+Copyright (C) 2025
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+// Timed stages.  Recording is a handful of relaxed atomic adds, so it stays on
+// in the audio callbacks and in every measurement.
+enum sync_stat {
+	// Whole measurement, from reading settings to the last target's result
+	SYNC_STAT_MEASURE,
+	// Waiting for the workspace another measurement or average holds
+	SYNC_STAT_LOCK_WAIT,
+	// Reading a window out of a capture ring, including the bandpass
+	SYNC_STAT_COPY,
+	// Conditioning and transforming the reference, once per measurement
+	SYNC_STAT_REFERENCE,
+	// Per target from here on
+	SYNC_STAT_CONDITION,
+	SYNC_STAT_FFT,
+	SYNC_STAT_SEARCH,
+	SYNC_STAT_PEAK,
+	SYNC_STAT_MONITOR,
+	SYNC_STAT_CAPTURE_REF,
+	SYNC_STAT_CAPTURE_TARGET,
+	SYNC_STAT_COUNT
+};
+
+// Bucket i counts durations in [2^i, 2^(i+1)) ns; the last one also takes anything longer
+#define SYNC_STAT_BUCKETS 40
+// FFT sizes are counted per power of two up to 2^SYNC_STAT_FFT_BITS
+#define SYNC_STAT_FFT_BITS 32
+
+static inline const char *sync_stat_name(enum sync_stat stat)
+{
+	switch (stat) {
+	case SYNC_STAT_MEASURE:
+		return "Measurement";
+	case SYNC_STAT_LOCK_WAIT:
+		return "Workspace lock wait";
+	case SYNC_STAT_COPY:
+		return "Ring copy + filter";
+	case SYNC_STAT_REFERENCE:
+		return "Reference transform";
+	case SYNC_STAT_CONDITION:
+		return "Target condition";
+	case SYNC_STAT_FFT:
+		return "Target FFTs";
+	case SYNC_STAT_SEARCH:
+		return "Lag search";
+	case SYNC_STAT_PEAK:
+		return "Sub-sample peak";
+	case SYNC_STAT_MONITOR:
+		return "Monitor pass";
+	case SYNC_STAT_CAPTURE_REF:
+		return "Reference callback";
+	case SYNC_STAT_CAPTURE_TARGET:
+		return "Target callback";
+	default:
+		return "?";
+	}
+}
+
+// Identifier for machine-readable output
+static inline const char *sync_stat_key(enum sync_stat stat)
+{
+	switch (stat) {
+	case SYNC_STAT_MEASURE:
+		return "measure";
+	case SYNC_STAT_LOCK_WAIT:
+		return "lock_wait";
+	case SYNC_STAT_COPY:
+		return "copy";
+	case SYNC_STAT_REFERENCE:
+		return "reference";
+	case SYNC_STAT_CONDITION:
+		return "condition";
+	case SYNC_STAT_FFT:
+		return "fft";
+	case SYNC_STAT_SEARCH:
+		return "search";
+	case SYNC_STAT_PEAK:
+		return "peak";
+	case SYNC_STAT_MONITOR:
+		return "monitor";
+	case SYNC_STAT_CAPTURE_REF:
+		return "capture_ref";
+	case SYNC_STAT_CAPTURE_TARGET:
+		return "capture_target";
+	default:
+		return "unknown";
+	}
+}
+
+struct stat_histogram {
+	std::atomic<uint64_t> buckets[SYNC_STAT_BUCKETS] = {};
+	std::atomic<uint64_t> count{0};
+	std::atomic<uint64_t> total_ns{0};
+	std::atomic<uint64_t> max_ns{0};
+	// Most recent duration, so a caller can read how long the run it just waited for took
+	std::atomic<uint64_t> last_ns{0};
+};
+
+struct sync_stats {
+	struct stat_histogram stages[SYNC_STAT_COUNT];
+	// Transforms run, by log2 of their length
+	std::atomic<uint64_t> fft_sizes[SYNC_STAT_FFT_BITS] = {};
+};
+
+static inline uint64_t sync_stats_now_ns()
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+		       std::chrono::steady_clock::now().time_since_epoch())
+		.count();
+}
+
+static inline unsigned sync_stats_log2(uint64_t v)
+{
+	unsigned bit = 0;
+	while (v >>= 1)
+		++bit;
+	return bit;
+}
+
+// Safe from any thread, including the audio thread; never blocks or allocates
+static inline void sync_stats_record(struct sync_stats *stats, enum sync_stat stat, uint64_t ns)
+{
+	if (!stats)
+		return;
+
+	struct stat_histogram *h = &stats->stages[stat];
+	const unsigned bucket = std::min<unsigned>(sync_stats_log2(ns), SYNC_STAT_BUCKETS - 1);
+	h->buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+	h->count.fetch_add(1, std::memory_order_relaxed);
+	h->total_ns.fetch_add(ns, std::memory_order_relaxed);
+	h->last_ns.store(ns, std::memory_order_relaxed);
+	uint64_t prev = h->max_ns.load(std::memory_order_relaxed);
+	while (ns > prev && !h->max_ns.compare_exchange_weak(prev, ns, std::memory_order_relaxed))
+		;
+}
+
+// Start of a timed stage; reads no clock when statistics are off
+static inline uint64_t sync_stats_start(const struct sync_stats *stats)
+{
+	return stats ? sync_stats_now_ns() : 0;
+}
+
+// Records the time since start_ns and returns now, so consecutive stages can chain
+static inline uint64_t sync_stats_since(struct sync_stats *stats, enum sync_stat stat, uint64_t start_ns)
+{
+	if (!stats)
+		return 0;
+	const uint64_t now_ns = sync_stats_now_ns();
+	sync_stats_record(stats, stat, now_ns - start_ns);
+	return now_ns;
+}
+
+static inline void sync_stats_fft(struct sync_stats *stats, size_t nfft, uint64_t transforms)
+{
+	if (stats && nfft)
+		stats->fft_sizes[std::min<unsigned>(sync_stats_log2(nfft), SYNC_STAT_FFT_BITS - 1)].fetch_add(
+			transforms, std::memory_order_relaxed);
+}
+
+static inline void sync_stats_reset(struct sync_stats *stats)
+{
+	for (auto &h : stats->stages) {
+		for (auto &b : h.buckets)
+			b.store(0, std::memory_order_relaxed);
+		h.count.store(0, std::memory_order_relaxed);
+		h.total_ns.store(0, std::memory_order_relaxed);
+		h.max_ns.store(0, std::memory_order_relaxed);
+		h.last_ns.store(0, std::memory_order_relaxed);
+	}
+	for (auto &f : stats->fft_sizes)
+		f.store(0, std::memory_order_relaxed);
+}
+
+// Upper edge of the bucket holding the q-quantile, capped at the maximum; 0 when nothing was recorded
+static inline uint64_t stat_histogram_quantile(const struct stat_histogram *h, double q)
+{
+	uint64_t counts[SYNC_STAT_BUCKETS];
+	uint64_t total = 0;
+	for (int i = 0; i < SYNC_STAT_BUCKETS; ++i) {
+		counts[i] = h->buckets[i].load(std::memory_order_relaxed);
+		total += counts[i];
+	}
+	if (total == 0)
+		return 0;
+
+	const uint64_t rank = std::max<uint64_t>(1, (uint64_t)std::ceil(q * (double)total));
+	const uint64_t max_ns = h->max_ns.load(std::memory_order_relaxed);
+	uint64_t seen = 0;
+	for (int i = 0; i < SYNC_STAT_BUCKETS; ++i) {
+		seen += counts[i];
+		if (seen >= rank)
+			return std::min((uint64_t)1 << (i + 1), max_ns);
+	}
+	return max_ns;
+}
+
+static inline void sync_stats_append_ms(std::string *out, const char *label, uint64_t ns)
+{
+	char buffer[48];
+	snprintf(buffer, sizeof(buffer), " %s %.3f", label, (double)ns / 1e6);
+	*out += buffer;
+}
+
+// One line per stage that has run: count, mean, p50/p99 (bucket upper edges) and max in ms, then FFT sizes.
+// With `buckets` every non-empty histogram bucket follows its stage.
+static inline std::string sync_stats_format(const struct sync_stats *stats, bool buckets)
+{
+	std::string out = "Stage timings (ms):";
+	for (int s = 0; s < SYNC_STAT_COUNT; ++s) {
+		const struct stat_histogram *h = &stats->stages[s];
+		const uint64_t count = h->count.load(std::memory_order_relaxed);
+		if (count == 0)
+			continue;
+
+		char buffer[64];
+		snprintf(buffer, sizeof(buffer), "\n%s: n=%llu", sync_stat_name((enum sync_stat)s),
+			 (unsigned long long)count);
+		out += buffer;
+		sync_stats_append_ms(&out, "mean", h->total_ns.load(std::memory_order_relaxed) / count);
+		sync_stats_append_ms(&out, "p50<", stat_histogram_quantile(h, 0.5));
+		sync_stats_append_ms(&out, "p99<", stat_histogram_quantile(h, 0.99));
+		sync_stats_append_ms(&out, "max", h->max_ns.load(std::memory_order_relaxed));
+
+		for (int i = 0; buckets && i < SYNC_STAT_BUCKETS; ++i) {
+			const uint64_t n = h->buckets[i].load(std::memory_order_relaxed);
+			if (n == 0)
+				continue;
+			snprintf(buffer, sizeof(buffer), "\n  [%.6f, %.6f) %llu", (double)(1ull << i) / 1e6,
+				 (double)(1ull << (i + 1)) / 1e6, (unsigned long long)n);
+			out += buffer;
+		}
+	}
+
+	std::string sizes;
+	for (int bit = 0; bit < SYNC_STAT_FFT_BITS; ++bit) {
+		const uint64_t n = stats->fft_sizes[bit].load(std::memory_order_relaxed);
+		if (n == 0)
+			continue;
+		char buffer[48];
+		snprintf(buffer, sizeof(buffer), " %llu x%llu", 1ull << bit, (unsigned long long)n);
+		sizes += buffer;
+	}
+	if (!sizes.empty())
+		out += "\nFFT sizes:" + sizes;
+	return out;
+}
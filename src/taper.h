@@ -0,0 +1,121 @@
+/*
+Audio Sync Analyzer - Cached analysis window tapers
+Copyright (C) 2025
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+*/
+
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#if !defined(SYNC_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define TAPER_SSE2 1
+#elif !defined(SYNC_NO_SIMD) && (defined(__aarch64__) || defined(_M_ARM64))
+#include <arm_neon.h>
+#define TAPER_NEON 1
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// Stored in settings by value; append new kinds at the end
+enum taper_kind {
+	TAPER_HANN = 0,
+	// Flat top with cosine edges over TAPER_TUKEY_ALPHA of the window
+	TAPER_TUKEY = 1,
+	TAPER_BLACKMAN_HARRIS = 2,
+	TAPER_COUNT
+};
+
+#define TAPER_TUKEY_ALPHA 0.5
+
+static inline const char *taper_name(enum taper_kind kind)
+{
+	switch (kind) {
+	case TAPER_TUKEY:
+		return "Tukey";
+	case TAPER_BLACKMAN_HARRIS:
+		return "Blackman-Harris";
+	default:
+		return "Hann";
+	}
+}
+
+static inline enum taper_kind taper_from_int(long long value)
+{
+	return value > 0 && value < TAPER_COUNT ? (enum taper_kind)value : TAPER_HANN;
+}
+
+static inline double taper_value(enum taper_kind kind, size_t i, size_t frames)
+{
+	const double x = (double)i / ((double)frames - 1.0);
+
+	switch (kind) {
+	case TAPER_TUKEY: {
+		const double edge = 0.5 * TAPER_TUKEY_ALPHA;
+		const double d = x < 0.5 ? x : 1.0 - x;
+		if (d >= edge)
+			return 1.0;
+		return 0.5 * (1.0 - cos(M_PI * d / edge));
+	}
+	case TAPER_BLACKMAN_HARRIS:
+		return 0.35875 - 0.48829 * cos(2.0 * M_PI * x) + 0.14128 * cos(4.0 * M_PI * x) -
+		       0.01168 * cos(6.0 * M_PI * x);
+	default:
+		return 0.5 * (1.0 - cos(2.0 * M_PI * x));
+	}
+}
+
+// Fills `table` with the taper for `frames` samples.  Returns the fraction of the
+// window that counts as independent samples once both correlated windows carry
+// the taper: (sum w^2)^2 / (frames * sum w^4), about 0.51 for Hann.
+static inline double taper_build(enum taper_kind kind, size_t frames, std::vector<float> *table)
+{
+	table->resize(frames);
+	if (frames <= 1) {
+		table->assign(frames, 1.0f);
+		return 1.0;
+	}
+
+	double sum2 = 0.0;
+	double sum4 = 0.0;
+	for (size_t i = 0; i < frames; ++i) {
+		const float w = (float)taper_value(kind, i, frames);
+		(*table)[i] = w;
+		const double w2 = (double)w * (double)w;
+		sum2 += w2;
+		sum4 += w2 * w2;
+	}
+	return sum4 > 0.0 ? sum2 * sum2 / ((double)frames * sum4) : 1.0;
+}
+
+// data[i] *= table[i]
+static inline void taper_apply(float *data, const float *table, size_t frames)
+{
+	size_t i = 0;
+#if defined(TAPER_SSE2)
+	for (; i + 8 <= frames; i += 8) {
+		const __m128 a = _mm_mul_ps(_mm_loadu_ps(data + i), _mm_loadu_ps(table + i));
+		const __m128 b = _mm_mul_ps(_mm_loadu_ps(data + i + 4), _mm_loadu_ps(table + i + 4));
+		_mm_storeu_ps(data + i, a);
+		_mm_storeu_ps(data + i + 4, b);
+	}
+#elif defined(TAPER_NEON)
+	for (; i + 8 <= frames; i += 8) {
+		const float32x4_t a = vmulq_f32(vld1q_f32(data + i), vld1q_f32(table + i));
+		const float32x4_t b = vmulq_f32(vld1q_f32(data + i + 4), vld1q_f32(table + i + 4));
+		vst1q_f32(data + i, a);
+		vst1q_f32(data + i + 4, b);
+	}
+#endif
+	for (; i < frames; ++i)
+		data[i] *= table[i];
+}
@@ -0,0 +1,382 @@
+/*
+Audio Sync Analyzer - Persistent worker pool
+Copyright (C) 2025
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+*/
+
+#pragma once
+
+#include <pthread.h>
+#include <time.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Lower values are picked first
+enum task_priority {
+	// Interactive requests, and the pieces of a job a caller is blocked on
+	TASK_PRIORITY_HIGH = 0,
+	// Averages and monitor hops
+	TASK_PRIORITY_NORMAL = 1,
+	// Long background jobs
+	TASK_PRIORITY_LOW = 2,
+	TASK_PRIORITY_COUNT
+};
+
+enum task_state {
+	TASK_QUEUED,
+	TASK_RUNNING,
+	// Finished, or cancelled before it started
+	TASK_DONE,
+};
+
+typedef void (*task_fn)(void *param);
+
+struct task {
+	task_fn fn = nullptr;
+	void *param = nullptr;
+	enum task_priority priority = TASK_PRIORITY_NORMAL;
+	// Steady-clock time before which no worker starts the task
+	int64_t due_ns = 0;
+	std::atomic<int> state{TASK_QUEUED};
+	std::atomic<bool> cancelled{false};
+};
+
+typedef std::shared_ptr<struct task> task_handle;
+
+// FIFO on a vector, so a queue that has grown once does not allocate again.
+// Taken entries are dropped when the queue empties, or in one move once they
+// outnumber the live ones.
+struct task_queue {
+	std::vector<task_handle> items;
+	size_t head = 0;
+};
+
+// Caller-owned tasks for task_pool_parallel().  Its handles share one
+// allocation, so once a batch has held as many tasks as a call needs, later
+// calls with it allocate nothing.  One call at a time per batch.
+struct task_batch {
+	task_handle tasks;
+	size_t capacity = 0;
+};
+
+// Fixed set of worker threads pulling from one FIFO per priority, plus tasks
+// scheduled to start later.  Whoever claims a queued task first runs it: a
+// worker, or a thread waiting on it with task_pool_wait().  A task may therefore
+// wait on tasks it submitted itself without tying up the pool.
+struct task_pool {
+	pthread_mutex_t lock;
+	pthread_cond_t wake;
+	pthread_cond_t finished;
+	struct task_queue queues[TASK_PRIORITY_COUNT];
+	// Moved to their queue once due by whichever worker looks first
+	std::vector<task_handle> delayed;
+	std::vector<pthread_t> threads;
+	bool stop = false;
+};
+
+static inline int64_t task_pool_now_ns()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		       std::chrono::steady_clock::now().time_since_epoch())
+		.count();
+}
+
+static inline bool task_queue_empty(const struct task_queue *q)
+{
+	return q->head == q->items.size();
+}
+
+static inline void task_queue_push(struct task_queue *q, task_handle t)
+{
+	q->items.push_back(std::move(t));
+}
+
+static inline task_handle task_queue_pop(struct task_queue *q)
+{
+	task_handle t = std::move(q->items[q->head++]);
+	if (q->head == q->items.size()) {
+		q->items.clear();
+		q->head = 0;
+	} else if (q->head >= 64 && 2 * q->head >= q->items.size()) {
+		q->items.erase(q->items.begin(), q->items.begin() + (ptrdiff_t)q->head);
+		q->head = 0;
+	}
+	return t;
+}
+
+// Drops the entries for tasks [first, first + count), which must all be done
+static inline void task_queue_remove(struct task_queue *q, const struct task *first, size_t count)
+{
+	const auto end = std::remove_if(q->items.begin() + (ptrdiff_t)q->head, q->items.end(),
+					[first, count](const task_handle &t) {
+						return t.get() >= first && t.get() < first + count;
+					});
+	q->items.erase(end, q->items.end());
+	if (task_queue_empty(q)) {
+		q->items.clear();
+		q->head = 0;
+	}
+}
+
+// Moves the calling thread's claim on a queued task from QUEUED to RUNNING
+static inline bool task_claim(struct task *t)
+{
+	int expected = TASK_QUEUED;
+	return t->state.compare_exchange_strong(expected, TASK_RUNNING, std::memory_order_acq_rel);
+}
+
+static inline void task_finish(struct task_pool *pool, struct task *t)
+{
+	pthread_mutex_lock(&pool->lock);
+	t->state.store(TASK_DONE, std::memory_order_release);
+	pthread_cond_broadcast(&pool->finished);
+	pthread_mutex_unlock(&pool->lock);
+}
+
+static inline bool task_done(const task_handle &t)
+{
+	return !t || t->state.load(std::memory_order_acquire) == TASK_DONE;
+}
+
+static inline bool task_cancelled(const task_handle &t)
+{
+	return t && t->cancelled.load(std::memory_order_acquire);
+}
+
+// Queues due delayed tasks and returns the earliest remaining due time, 0 if
+// none are left.  Called with the pool lock held.
+static inline int64_t task_pool_promote(struct task_pool *pool, int64_t now_ns)
+{
+	int64_t next_ns = 0;
+	for (size_t i = 0; i < pool->delayed.size();) {
+		if (pool->delayed[i]->due_ns <= now_ns) {
+			task_handle t = std::move(pool->delayed[i]);
+			pool->delayed[i] = std::move(pool->delayed.back());
+			pool->delayed.pop_back();
+			task_queue_push(&pool->queues[t->priority], std::move(t));
+			continue;
+		}
+		if (!next_ns || pool->delayed[i]->due_ns < next_ns)
+			next_ns = pool->delayed[i]->due_ns;
+		++i;
+	}
+	return next_ns;
+}
+
+static inline void *task_pool_worker(void *param)
+{
+	struct task_pool *pool = static_cast<struct task_pool *>(param);
+
+	pthread_mutex_lock(&pool->lock);
+	while (!pool->stop) {
+		const int64_t now_ns = task_pool_now_ns();
+		const int64_t next_ns = task_pool_promote(pool, now_ns);
+
+		task_handle t;
+		for (int p = 0; p < TASK_PRIORITY_COUNT && !t; ++p) {
+			if (!task_queue_empty(&pool->queues[p]))
+				t = task_queue_pop(&pool->queues[p]);
+		}
+
+		if (!t) {
+			if (next_ns) {
+				// pthread timeouts are absolute wall-clock times
+				struct timespec ts;
+				timespec_get(&ts, TIME_UTC);
+				const int64_t wait_ns = next_ns - now_ns;
+				ts.tv_sec += (time_t)(wait_ns / 1000000000LL);
+				ts.tv_nsec += (long)(wait_ns % 1000000000LL);
+				if (ts.tv_nsec >= 1000000000L) {
+					ts.tv_sec++;
+					ts.tv_nsec -= 1000000000L;
+				}
+				pthread_cond_timedwait(&pool->wake, &pool->lock, &ts);
+			} else {
+				pthread_cond_wait(&pool->wake, &pool->lock);
+			}
+			continue;
+		}
+
+		// Already cancelled, or claimed by a thread waiting on it
+		if (!task_claim(t.get()))
+			continue;
+
+		pthread_mutex_unlock(&pool->lock);
+		t->fn(t->param);
+		task_finish(pool, t.get());
+		t.reset();
+		pthread_mutex_lock(&pool->lock);
+	}
+	pthread_mutex_unlock(&pool->lock);
+	return nullptr;
+}
+
+// Starts up to `threads` workers.  Returns false if none could be started; the
+// pool then only runs tasks that are waited on.
+static inline bool task_pool_init(struct task_pool *pool, size_t threads)
+{
+	pthread_mutex_init(&pool->lock, nullptr);
+	pthread_cond_init(&pool->wake, nullptr);
+	pthread_cond_init(&pool->finished, nullptr);
+	pool->stop = false;
+
+	pool->threads.reserve(threads);
+	for (size_t i = 0; i < threads; ++i) {
+		pthread_t thread;
+		if (pthread_create(&thread, nullptr, task_pool_worker, pool) == 0)
+			pool->threads.push_back(thread);
+	}
+	return !pool->threads.empty();
+}
+
+// Queues a filled-in task to start no sooner than delay_ms from now, or marks
+// it cancelled after shutdown
+static inline void task_pool_enqueue(struct task_pool *pool, const task_handle &t, uint32_t delay_ms)
+{
+	pthread_mutex_lock(&pool->lock);
+	if (pool->stop) {
+		t->cancelled.store(true, std::memory_order_relaxed);
+		t->state.store(TASK_DONE, std::memory_order_relaxed);
+	} else if (delay_ms) {
+		t->due_ns = task_pool_now_ns() + (int64_t)delay_ms * 1000000LL;
+		pool->delayed.push_back(t);
+		// A sleeping worker may be waiting for a later deadline
+		pthread_cond_broadcast(&pool->wake);
+	} else {
+		task_queue_push(&pool->queues[t->priority], t);
+		pthread_cond_signal(&pool->wake);
+	}
+	pthread_mutex_unlock(&pool->lock);
+}
+
+// Queues fn(param) to start no sooner than delay_ms from now.  After shutdown
+// the returned task is already cancelled.
+static inline task_handle task_pool_submit(struct task_pool *pool, task_fn fn, void *param,
+					   enum task_priority priority, uint32_t delay_ms = 0)
+{
+	task_handle t = std::make_shared<struct task>();
+	t->fn = fn;
+	t->param = param;
+	t->priority = priority;
+	task_pool_enqueue(pool, t, delay_ms);
+	return t;
+}
+
+// Keeps a task that has not started from ever running and returns true.  A task
+// that is already running keeps going; it can poll task_cancelled().
+static inline bool task_pool_cancel(struct task_pool *pool, const task_handle &t)
+{
+	if (!t)
+		return false;
+
+	t->cancelled.store(true, std::memory_order_release);
+	if (!task_claim(t.get()))
+		return false;
+	task_finish(pool, t.get());
+	return true;
+}
+
+// Returns once the task has finished or was cancelled.  A task nobody has
+// started yet, even a delayed one, runs on the calling thread right away.
+static inline void task_pool_wait(struct task_pool *pool, const task_handle &t)
+{
+	if (!t)
+		return;
+
+	if (task_claim(t.get())) {
+		t->fn(t->param);
+		task_finish(pool, t.get());
+		return;
+	}
+
+	pthread_mutex_lock(&pool->lock);
+	while (t->state.load(std::memory_order_acquire) != TASK_DONE)
+		pthread_cond_wait(&pool->finished, &pool->lock);
+	pthread_mutex_unlock(&pool->lock);
+}
+
+// Runs fn(params[i]) for every i and returns when all have finished.  The first
+// runs on the calling thread and the rest are queued from `batch`, by default
+// at high priority since the caller is blocked on them.  Long background jobs
+// pass a lower priority so interactive work is not queued behind them.
+static inline void task_pool_parallel(struct task_pool *pool, struct task_batch *batch, task_fn fn,
+				      void *const *params, size_t count,
+				      enum task_priority priority = TASK_PRIORITY_HIGH)
+{
+	if (count == 0)
+		return;
+
+	if (batch->capacity < count - 1) {
+		batch->tasks = task_handle(new struct task[count - 1], std::default_delete<struct task[]>());
+		batch->capacity = count - 1;
+	}
+	struct task *tasks = batch->tasks.get();
+	for (size_t i = 1; i < count; ++i) {
+		// Nothing else refers to the batch's tasks between calls, so they are reset in place
+		struct task *t = &tasks[i - 1];
+		t->fn = fn;
+		t->param = params[i];
+		t->priority = priority;
+		t->due_ns = 0;
+		t->state.store(TASK_QUEUED, std::memory_order_relaxed);
+		t->cancelled.store(false, std::memory_order_relaxed);
+		// Shares the batch's reference count instead of allocating one
+		task_pool_enqueue(pool, task_handle(batch->tasks, t), 0);
+	}
+	fn(params[0]);
+	for (size_t i = 1; i < count; ++i) {
+		const task_handle t(batch->tasks, &tasks[i - 1]);
+		// Submitting after shutdown cancels; the work still has to happen
+		if (task_cancelled(t) && task_done(t))
+			fn(params[i]);
+		else
+			task_pool_wait(pool, t);
+	}
+
+	if (count == 1)
+		return;
+	// Tasks this thread ran itself are still queued; workers would find them
+	// already claimed, but by then the batch may have been reset for another call
+	pthread_mutex_lock(&pool->lock);
+	task_queue_remove(&pool->queues[priority], tasks, count - 1);
+	pthread_mutex_unlock(&pool->lock);
+}
+
+// Drops everything still queued and joins the workers once their current task
+// returns.  Long-running tasks must have been asked to stop first.
+static inline void task_pool_shutdown(struct task_pool *pool)
+{
+	pthread_mutex_lock(&pool->lock);
+	pool->stop = true;
+	std::vector<task_handle> pending;
+	for (auto &queue : pool->queues) {
+		pending.insert(pending.end(), queue.items.begin() + (ptrdiff_t)queue.head, queue.items.end());
+		queue.items.clear();
+		queue.head = 0;
+	}
+	pending.insert(pending.end(), pool->delayed.begin(), pool->delayed.end());
+	pool->delayed.clear();
+	pthread_cond_broadcast(&pool->wake);
+	pthread_mutex_unlock(&pool->lock);
+
+	for (auto &t : pending)
+		task_pool_cancel(pool, t);
+
+	for (pthread_t thread : pool->threads)
+		pthread_join(thread, nullptr);
+	pool->threads.clear();
+
+	pthread_cond_destroy(&pool->finished);
+	pthread_cond_destroy(&pool->wake);
+	pthread_mutex_destroy(&pool->lock);
+}
@@ -0,0 +1,288 @@
+/*
+Audio Sync Analyzer - Voice activity flags for the capture rings
+Copyright (C) 2025
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#if !defined(SYNC_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define VOICE_ACTIVITY_SSE2 1
+#elif !defined(SYNC_NO_SIMD) && (defined(__aarch64__) || defined(_M_ARM64))
+#include <arm_neon.h>
+#define VOICE_ACTIVITY_NEON 1
+#endif
+
+// A cheap detector run by the capture callback on every block it writes to a
+// ring, so measurements can skip windows that could never correlate.  A block
+// is active when its level stands out from the source's noise floor and its
+// spectrum is not flat.  Both come from the lag 0-2 autocorrelation of the
+// first difference: the difference removes DC and hum, and the error of a
+// second-order linear predictor relative to r0 is a coarse spectral flatness
+// (near 1 for noise and applause, well below it for voiced speech).
+//
+// Blocks are counted on the ring's frame indices, block b covering frames
+// [b * VAD_BLOCK_FRAMES, (b + 1) * VAD_BLOCK_FRAMES), and each flag is tagged
+// with its block so a reader never takes a flag from an earlier lap.
+
+#define VAD_BLOCK_FRAMES 512u
+// Level above the noise floor and absolute level (both of the differenced signal, dBFS)
+#define VAD_SNR_DB 9.0
+#define VAD_MIN_LEVEL_DB -60.0
+// The floor drops at once to a quieter block and otherwise rises this fast
+#define VAD_FLOOR_RISE_DB_PER_S 2.0
+#define VAD_MAX_FLATNESS 0.5
+// A window is worth correlating when at least this share of its blocks is active
+#define VAD_MIN_ACTIVE 0.25
+
+struct voice_activity {
+	// One flag per block the ring holds: voice_activity_tag(block) | active
+	std::vector<std::atomic<uint32_t>> flags;
+	size_t mask = 0;
+
+	// Producer state, used only by the audio callback
+	uint64_t next_index = 0;
+	size_t block_frames = 0;
+	float prev = 0.0f;
+	float d1 = 0.0f;
+	float d2 = 0.0f;
+	float r0 = 0.0f;
+	float r1 = 0.0f;
+	float r2 = 0.0f;
+	double floor_db = 0.0;
+	bool floor_set = false;
+	// False until the producer reaches a block boundary after a jump in the ring's index
+	bool synced = false;
+};
+
+// Sizes the flags for a ring of `capacity` frames.  Must not race the producer or readers.
+static inline void voice_activity_init(struct voice_activity *vad, size_t capacity)
+{
+	size_t blocks = 1;
+	while (blocks * VAD_BLOCK_FRAMES < capacity)
+		blocks <<= 1;
+	vad->flags = std::vector<std::atomic<uint32_t>>(blocks);
+	vad->mask = blocks - 1;
+	vad->next_index = 0;
+	vad->block_frames = 0;
+	vad->floor_set = false;
+	vad->synced = false;
+}
+
+// Takes over src's flags for a ring that now holds src's ring's frames (see
+// sync_ring_copy()).  Both must be sized for the same capacity.  src may be
+// live, so its producer state is not read: dst starts over at the next block
+// boundary and learns its noise floor again.
+static inline void voice_activity_copy(struct voice_activity *dst, const struct voice_activity *src)
+{
+	for (size_t i = 0; i < dst->flags.size() && i < src->flags.size(); ++i)
+		dst->flags[i].store(src->flags[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+	dst->next_index = 0;
+	dst->block_frames = 0;
+	dst->floor_set = false;
+	dst->synced = false;
+}
+
+// Adds the lag 0, 1 and 2 products of the first difference of src[begin, end).
+// The samples before src[begin] come from src itself once begin >= 3, and from
+// the carried state before that.
+static inline void voice_activity_accumulate(struct voice_activity *vad, const float *src, size_t begin, size_t end)
+{
+	size_t i = begin;
+	float r0 = 0.0f;
+	float r1 = 0.0f;
+	float r2 = 0.0f;
+	for (; i < end && i < 3; ++i) {
+		const float d = src[i] - vad->prev;
+		r0 += d * d;
+		r1 += d * vad->d1;
+		r2 += d * vad->d2;
+		vad->d2 = vad->d1;
+		vad->d1 = d;
+		vad->prev = src[i];
+	}
+
+	if (i + 4 <= end) {
+#if defined(VOICE_ACTIVITY_SSE2)
+		__m128 s0 = _mm_setzero_ps();
+		__m128 s1 = _mm_setzero_ps();
+		__m128 s2 = _mm_setzero_ps();
+		for (; i + 4 <= end; i += 4) {
+			const __m128 x0 = _mm_loadu_ps(src + i);
+			const __m128 x1 = _mm_loadu_ps(src + i - 1);
+			const __m128 x2 = _mm_loadu_ps(src + i - 2);
+			const __m128 x3 = _mm_loadu_ps(src + i - 3);
+			const __m128 d = _mm_sub_ps(x0, x1);
+			s0 = _mm_add_ps(s0, _mm_mul_ps(d, d));
+			s1 = _mm_add_ps(s1, _mm_mul_ps(d, _mm_sub_ps(x1, x2)));
+			s2 = _mm_add_ps(s2, _mm_mul_ps(d, _mm_sub_ps(x2, x3)));
+		}
+		float lanes[3][4];
+		_mm_storeu_ps(lanes[0], s0);
+		_mm_storeu_ps(lanes[1], s1);
+		_mm_storeu_ps(lanes[2], s2);
+		r0 += lanes[0][0] + lanes[0][1] + lanes[0][2] + lanes[0][3];
+		r1 += lanes[1][0] + lanes[1][1] + lanes[1][2] + lanes[1][3];
+		r2 += lanes[2][0] + lanes[2][1] + lanes[2][2] + lanes[2][3];
+#elif defined(VOICE_ACTIVITY_NEON)
+		float32x4_t s0 = vdupq_n_f32(0.0f);
+		float32x4_t s1 = vdupq_n_f32(0.0f);
+		float32x4_t s2 = vdupq_n_f32(0.0f);
+		for (; i + 4 <= end; i += 4) {
+			const float32x4_t x0 = vld1q_f32(src + i);
+			const float32x4_t x1 = vld1q_f32(src + i - 1);
+			const float32x4_t x2 = vld1q_f32(src + i - 2);
+			const float32x4_t x3 = vld1q_f32(src + i - 3);
+			const float32x4_t d = vsubq_f32(x0, x1);
+			s0 = vmlaq_f32(s0, d, d);
+			s1 = vmlaq_f32(s1, d, vsubq_f32(x1, x2));
+			s2 = vmlaq_f32(s2, d, vsubq_f32(x2, x3));
+		}
+		r0 += vaddvq_f32(s0);
+		r1 += vaddvq_f32(s1);
+		r2 += vaddvq_f32(s2);
+#endif
+		if (i > begin) {
+			vad->prev = src[i - 1];
+			vad->d1 = src[i - 1] - src[i - 2];
+			vad->d2 = src[i - 2] - src[i - 3];
+		}
+	}
+
+	for (; i < end; ++i) {
+		const float d = src[i] - vad->prev;
+		r0 += d * d;
+		r1 += d * vad->d1;
+		r2 += d * vad->d2;
+		vad->d2 = vad->d1;
+		vad->d1 = d;
+		vad->prev = src[i];
+	}
+
+	vad->r0 += r0;
+	vad->r1 += r1;
+	vad->r2 += r2;
+}
+
+// Level and flatness of the finished block, then the floor update
+static inline bool voice_activity_classify(struct voice_activity *vad, uint32_t sample_rate)
+{
+	const double r0 = vad->r0;
+	const double level_db = 10.0 * std::log10(r0 / (double)VAD_BLOCK_FRAMES + 1e-20);
+
+	// Levinson recursion to order 2 gives the prediction error relative to r0
+	double flatness = 1.0;
+	if (r0 > 1e-20) {
+		const double k1 = vad->r1 / r0;
+		const double e1 = r0 * (1.0 - k1 * k1);
+		if (e1 > 1e-20) {
+			const double k2 = (vad->r2 - k1 * vad->r1) / e1;
+			flatness = e1 * (1.0 - k2 * k2) / r0;
+		}
+	}
+
+	if (!vad->floor_set || level_db < vad->floor_db) {
+		vad->floor_db = level_db;
+		vad->floor_set = true;
+	} else {
+		vad->floor_db += VAD_FLOOR_RISE_DB_PER_S * (double)VAD_BLOCK_FRAMES / (double)sample_rate;
+	}
+
+	return level_db > VAD_MIN_LEVEL_DB && level_db > vad->floor_db + VAD_SNR_DB && flatness < VAD_MAX_FLATNESS;
+}
+
+static inline uint32_t voice_activity_tag(uint64_t block)
+{
+	return (uint32_t)((block + 1) & 0x7fffffffu) << 1;
+}
+
+static inline void voice_activity_restart(struct voice_activity *vad, float first)
+{
+	vad->block_frames = 0;
+	vad->r0 = 0.0f;
+	vad->r1 = 0.0f;
+	vad->r2 = 0.0f;
+	vad->prev = first;
+	vad->d1 = 0.0f;
+	vad->d2 = 0.0f;
+	vad->synced = true;
+}
+
+// Producer side: classifies `frames` samples that are about to be written to
+// the ring at frame index `pos`.  Call before sync_ring_write(), so a reader
+// that sees the frames also sees their flags.
+static inline void voice_activity_write(struct voice_activity *vad, const float *src, size_t frames, uint64_t pos,
+					uint32_t sample_rate)
+{
+	if (vad->flags.empty())
+		return;
+
+	// After a ring reset or a packet the ring could not hold, the partial block
+	// is dropped and counting resumes at the next block boundary
+	if (pos != vad->next_index)
+		vad->synced = false;
+	vad->next_index = pos + frames;
+	if (!vad->synced) {
+		const uint64_t to_boundary = (VAD_BLOCK_FRAMES - pos % VAD_BLOCK_FRAMES) % VAD_BLOCK_FRAMES;
+		const size_t skip = (size_t)std::min<uint64_t>(to_boundary, frames);
+		src += skip;
+		frames -= skip;
+		pos += skip;
+		if (!frames)
+			return;
+		voice_activity_restart(vad, src[0]);
+	}
+
+	for (size_t done = 0; done < frames;) {
+		const size_t n = std::min<size_t>(frames - done, VAD_BLOCK_FRAMES - vad->block_frames);
+		voice_activity_accumulate(vad, src, done, done + n);
+		done += n;
+		vad->block_frames += n;
+		if (vad->block_frames < VAD_BLOCK_FRAMES)
+			break;
+
+		const uint64_t block = (pos + done) / VAD_BLOCK_FRAMES - 1;
+		const bool active = voice_activity_classify(vad, sample_rate);
+		vad->flags[(size_t)(block & vad->mask)].store(voice_activity_tag(block) | (active ? 1u : 0u),
+							       std::memory_order_relaxed);
+		vad->block_frames = 0;
+		vad->r0 = 0.0f;
+		vad->r1 = 0.0f;
+		vad->r2 = 0.0f;
+	}
+}
+
+// Share of the blocks wholly inside frames [start, start + frames) that were
+// active.  Blocks the detector never saw are left out, and a window without a
+// single classified block counts as fully active, so a gap in the flags never
+// holds a measurement back.
+static inline double voice_activity_share(const struct voice_activity *vad, uint64_t start, size_t frames)
+{
+	if (vad->flags.empty())
+		return 1.0;
+
+	const uint64_t first = (start + VAD_BLOCK_FRAMES - 1) / VAD_BLOCK_FRAMES;
+	const uint64_t last = (start + frames) / VAD_BLOCK_FRAMES;
+	size_t known = 0;
+	size_t active = 0;
+	for (uint64_t block = first; block < last && block - first <= vad->mask; ++block) {
+		const uint32_t flag = vad->flags[(size_t)(block & vad->mask)].load(std::memory_order_relaxed);
+		if ((flag & ~1u) != voice_activity_tag(block))
+			continue;
+		known++;
+		active += flag & 1u;
+	}
+	return known ? (double)active / (double)known : 1.0;
+}
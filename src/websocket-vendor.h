@@ -0,0 +1,96 @@
+/*
+Audio Sync Analyzer - obs-websocket vendor requests
+Copyright (C) 2025
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+*/
+
+#pragma once
+
+#include <obs-module.h>
+
+// obs-websocket offers its vendor API as procedures on a proc handler of its
+// own, which the global proc handler hands out.  These make the same calls as
+// its obs-websocket-api.h, so the plugin neither builds against nor links to
+// obs-websocket and loads unchanged where it is not installed.
+
+// Fills `response` for one request; runs on obs-websocket's thread
+typedef void (*websocket_request_fn)(obs_data_t *request, obs_data_t *response, void *param);
+
+// Layout obs-websocket reads for "vendor_request_register"; it keeps a copy
+struct websocket_request_callback {
+	websocket_request_fn callback;
+	void *param;
+};
+
+struct websocket_vendor {
+	proc_handler_t *ph = nullptr;
+	void *vendor = nullptr;
+};
+
+// Call from obs_module_post_load(), when obs-websocket has loaded.  False when it is not installed.
+static inline bool websocket_vendor_register(struct websocket_vendor *v, const char *name)
+{
+	calldata_t cd = {};
+	if (proc_handler_call(obs_get_proc_handler(), "obs_websocket_api_get_ph", &cd))
+		v->ph = (proc_handler_t *)calldata_ptr(&cd, "ph");
+	calldata_free(&cd);
+	if (!v->ph)
+		return false;
+
+	cd = {};
+	calldata_set_string(&cd, "name", name);
+	proc_handler_call(v->ph, "vendor_register", &cd);
+	v->vendor = calldata_ptr(&cd, "vendor");
+	calldata_free(&cd);
+	return v->vendor != nullptr;
+}
+
+static inline bool websocket_vendor_add_request(const struct websocket_vendor *v, const char *type,
+						websocket_request_fn fn, void *param)
+{
+	if (!v->vendor)
+		return false;
+
+	struct websocket_request_callback cb = {fn, param};
+	calldata_t cd = {};
+	calldata_set_string(&cd, "type", type);
+	calldata_set_ptr(&cd, "callback", &cb);
+	calldata_set_ptr(&cd, "vendor", v->vendor);
+	proc_handler_call(v->ph, "vendor_request_register", &cd);
+	const bool ok = calldata_bool(&cd, "success");
+	calldata_free(&cd);
+	return ok;
+}
+
+// Call before obs-websocket unloads, e.g. on OBS_FRONTEND_EVENT_EXIT; it keeps the vendor itself until then
+static inline bool websocket_vendor_remove_request(const struct websocket_vendor *v, const char *type)
+{
+	if (!v->vendor)
+		return false;
+
+	calldata_t cd = {};
+	calldata_set_string(&cd, "type", type);
+	calldata_set_ptr(&cd, "vendor", v->vendor);
+	proc_handler_call(v->ph, "vendor_request_unregister", &cd);
+	const bool ok = calldata_bool(&cd, "success");
+	calldata_free(&cd);
+	return ok;
+}
+
+// Broadcasts a vendor event to every client subscribed to vendor events; safe from any thread
+static inline void websocket_vendor_emit(const struct websocket_vendor *v, const char *type, obs_data_t *data)
+{
+	if (!v->vendor)
+		return;
+
+	calldata_t cd = {};
+	calldata_set_string(&cd, "type", type);
+	calldata_set_ptr(&cd, "data", data);
+	calldata_set_ptr(&cd, "vendor", v->vendor);
+	proc_handler_call(v->ph, "vendor_event_emit", &cd);
+	calldata_free(&cd);
+}
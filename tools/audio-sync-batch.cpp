@@ -0,0 +1,164 @@
+/*
+Audio Sync Analyzer - Batch analysis of recordings
+Copyright (C) 2025
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+*/
+
+// Measures the delay of every track of a recording against a reference track
+// over the whole file and writes the delay-vs-time curve as CSV.
+//
+// With one file, channel 0 is the reference and every other channel a target.
+// With several, the first file (downmixed) is the reference and each further
+// file (downmixed) a target.  Extract the tracks of an OBS multi-track
+// recording with e.g. `ffmpeg -i rec.mkv -map 0:a:0 ref.wav -map 0:a:1 mic.wav`.
+//
+//   audio-sync-batch [--window 1000] [--lag 1000] [--hop 1000] [--threshold 0.3]
+//                    [--coarse 0|1] [--weighting 0-3] [--taper 0-2] [--out file.csv]
+//                    file.wav [target.wav ...]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "offline-analysis.h"
+#include "task-pool.h"
+
+struct batch_options {
+	struct offline_settings settings;
+	std::string out_path;
+	std::vector<std::string> files;
+};
+
+static bool parse_options(int argc, char **argv, struct batch_options *opt)
+{
+	struct sync_engine_settings *engine = &opt->settings.engine;
+	engine->window_ms = 1000;
+	engine->max_lag_ms = 1000;
+	engine->corr_threshold = 0.3f;
+	engine->coarse_search = true;
+	engine->taper = TAPER_HANN;
+	engine->weighting = WEIGHTING_NONE;
+	engine->debug = false;
+
+	for (int i = 1; i < argc; ++i) {
+		const char *key = argv[i];
+		if (strncmp(key, "--", 2)) {
+			opt->files.push_back(key);
+			continue;
+		}
+		if (i + 1 >= argc)
+			return false;
+		const char *value = argv[++i];
+		if (!strcmp(key, "--window"))
+			engine->window_ms = (uint32_t)strtoul(value, nullptr, 10);
+		else if (!strcmp(key, "--lag"))
+			engine->max_lag_ms = (uint32_t)strtoul(value, nullptr, 10);
+		else if (!strcmp(key, "--hop"))
+			opt->settings.hop_ms = std::max(1u, (uint32_t)strtoul(value, nullptr, 10));
+		else if (!strcmp(key, "--threshold"))
+			engine->corr_threshold = (float)atof(value);
+		else if (!strcmp(key, "--coarse"))
+			engine->coarse_search = atoi(value) != 0;
+		else if (!strcmp(key, "--weighting"))
+			engine->weighting = spectral_weighting_from_int(atoll(value));
+		else if (!strcmp(key, "--taper"))
+			engine->taper = taper_from_int(atoll(value));
+		else if (!strcmp(key, "--out"))
+			opt->out_path = value;
+		else
+			return false;
+	}
+	return !opt->files.empty();
+}
+
+static void log_stderr(int, const char *format, va_list args)
+{
+	vfprintf(stderr, format, args);
+	fputc('\n', stderr);
+}
+
+static bool print_progress(void *, uint64_t done, uint64_t total)
+{
+	if (done == total || done % 64 == 0)
+		fprintf(stderr, "\r%llu/%llu windows", (unsigned long long)done, (unsigned long long)total);
+	if (done == total)
+		fputc('\n', stderr);
+	return true;
+}
+
+int main(int argc, char **argv)
+{
+	struct batch_options opt;
+	if (!parse_options(argc, argv, &opt)) {
+		fprintf(stderr,
+			"usage: %s [--window ms] [--lag ms] [--hop ms] [--threshold r] [--coarse 0|1]\n"
+			"       [--weighting 0-3] [--taper 0-2] [--out file.csv] file.wav [target.wav ...]\n",
+			argv[0]);
+		return 1;
+	}
+
+	std::vector<struct wav_file> files(opt.files.size());
+	for (size_t i = 0; i < files.size(); ++i) {
+		std::string error;
+		if (!wav_open(&files[i], opt.files[i].c_str(), &error)) {
+			fprintf(stderr, "%s: %s\n", opt.files[i].c_str(), error.c_str());
+			return 1;
+		}
+	}
+
+	struct offline_track ref;
+	std::vector<struct offline_track> targets;
+	if (files.size() == 1) {
+		ref = {&files[0], 0, "channel 0"};
+		for (uint32_t c = 1; c < files[0].channels; ++c)
+			targets.push_back({&files[0], (int)c, "channel " + std::to_string(c)});
+	} else {
+		ref = {&files[0], CAPTURE_CHANNEL_MIX, opt.files[0]};
+		for (size_t i = 1; i < files.size(); ++i)
+			targets.push_back({&files[i], CAPTURE_CHANNEL_MIX, opt.files[i]});
+	}
+
+	// The calling thread measures too, so one core fewer than the machine has
+	struct task_pool pool;
+	const unsigned cores = std::max(std::thread::hardware_concurrency(), 2u);
+	task_pool_init(&pool, cores - 1);
+
+	struct sync_engine engine;
+	sync_engine_init(&engine, files[0].sample_rate, pool.threads.empty() ? nullptr : &pool, log_stderr);
+
+	const auto start = std::chrono::steady_clock::now();
+	std::vector<struct offline_window> windows;
+	std::string error;
+	const bool ok = offline_analyze(&engine, &opt.settings, &ref, targets.data(), targets.size(), print_progress,
+					nullptr, &windows, &error);
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	task_pool_shutdown(&pool);
+
+	int status = 0;
+	if (!ok) {
+		fprintf(stderr, "%s\n", error.c_str());
+		status = 1;
+	} else {
+		fprintf(stderr, "%zu windows in %.2f s\n%s\n", windows.size(), seconds,
+			offline_summary(targets.data(), targets.size(), windows).c_str());
+		if (!offline_write_csv(opt.out_path.empty() ? nullptr : opt.out_path.c_str(), targets.data(),
+				       targets.size(), windows)) {
+			fprintf(stderr, "Could not write %s\n", opt.out_path.c_str());
+			status = 1;
+		}
+	}
+
+	for (auto &wav : files)
+		wav_close(&wav);
+	return status;
+}